@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "BackgroundJob.h"
+#include <QtConcurrentRun>
+#include <algorithm>
+#include <functional>
+
+
+
+// ----------------------------------------------------------------------------------
+// BackgroundJob
+// ----------------------------------------------------------------------------------
+
+BackgroundJob::BackgroundJob( QObject* parent )
+    : QObject( parent )
+    , canceledFlag( 0 )
+    , lastStep( -1 )
+{
+    connect( &worker, SIGNAL( finished() ), this, SLOT( processed() ) );
+}
+
+
+BackgroundJob::~BackgroundJob()
+{
+    cancelAndWait();
+}
+
+
+void BackgroundJob::start()
+{
+    std::function< void() > work = [this]()
+    {
+        process();
+    };
+    worker.setFuture( QtConcurrent::run( work ) );
+}
+
+
+bool BackgroundJob::isCanceled() const
+{
+    return canceledFlag != 0;
+}
+
+
+void BackgroundJob::cancelAndWait()
+{
+    if( worker.isRunning() )
+    {
+        cancel();
+        worker.waitForFinished();
+    }
+}
+
+
+void BackgroundJob::cancel()
+{
+    canceledFlag.fetchAndStoreOrdered( 1 );
+}
+
+
+void BackgroundJob::reportProgress( double fraction )
+{
+    const int step = static_cast< int >( ( PROGRESS_STEPS - 1 ) * std::min( std::max( fraction, 0. ), 1. ) );
+
+    /* Only changed steps are reported, so that the receiver is not flooded.
+     */
+    const int previousStep = lastStep.fetchAndStoreOrdered( step );
+    if( step != previousStep )
+    {
+        emit progressed( step );
+    }
+}
+
+
+void BackgroundJob::processed()
+{
+    finish();
+    deleteLater();
+}
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <QObject>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+
+
+
+// ----------------------------------------------------------------------------------
+// BackgroundJob
+// ----------------------------------------------------------------------------------
+
+/** \brief  Runs some work on a worker thread, reports its progress and deletes itself
+  *         once it is done.
+  *
+  * \ref process is invoked on a worker thread once \ref start is called. When it
+  * returns, \ref finish is invoked on the thread which the job belongs to, i.e. the
+  * GUI thread, after which the job deletes itself.
+  */
+class BackgroundJob : public QObject
+{
+
+    Q_OBJECT
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Holds the number of steps \ref progressed reports.
+      */
+    const static int PROGRESS_STEPS = 1000;
+
+
+    /** \brief  Instantiates a job which has not been started yet.
+      */
+    explicit BackgroundJob( QObject* parent = nullptr );
+
+    /** \brief  Waits until the worker has finished.
+      *
+      * The worker runs \ref process of the derived class, whose members are gone by
+      * the time this destructor runs. Hence derived classes stop a running job
+      * through \ref cancelAndWait in their own destructors.
+      */
+    virtual ~BackgroundJob();
+
+
+    /** \brief  Invokes \ref process on a worker thread.
+      */
+    void start();
+
+    /** \brief  Tells whether \ref cancel was invoked.
+      */
+    bool isCanceled() const;
+
+    /** \brief  Cancels the job and blocks until the worker has returned from
+      *         \ref process.
+      */
+    void cancelAndWait();
+
+
+public slots:
+
+    /** \brief  Requests the job to stop, which \ref process checks through
+      *         \ref isCanceled.
+      */
+    void cancel();
+
+
+signals:
+
+    /** \brief  Tells that \a step out of \ref PROGRESS_STEPS were completed.
+      */
+    void progressed( int step );
+
+
+protected:
+
+    /** \brief  Does the work. Invoked on a worker thread.
+      */
+    virtual void process() = 0;
+
+    /** \brief  Notifies about the outcome of \ref process. Invoked on the thread which
+      *         the job belongs to.
+      */
+    virtual void finish() = 0;
+
+    /** \brief  Reports that \a fraction of the work was done.
+      *
+      * May be invoked on any thread.
+      */
+    void reportProgress( double fraction );
+
+
+private:
+
+    QAtomicInt canceledFlag;
+
+    QAtomicInt lastStep;
+
+    QFutureWatcher< void > worker;
+
+
+private slots:
+
+    /** \brief  Invokes \ref finish and deletes the job once the worker has finished.
+      */
+    void processed();
+
+}; // BackgroundJob
@@ -14,49 +14,273 @@
 #include "BinaryDumpImportDialog.h"
 #include "Exporter.h"
 #include "Importer.h"
+#include "ImportJob.h"
 #include "DataSize.h"
 #include "CarnaContextClient.h"
 #include "OptimizedVolumeDecorator.h"
+#include "Slabs.h"
+#include "Simd.h"
+#include "VolumeRows.h"
 #include <Carna/base/model/Scene.h>
 #include <Carna/base/model/SceneFactory.h>
 #include <Carna/base/model/UInt16Volume.h>
 #include <QDialog>
 #include <QProgressDialog>
+#include <QtConcurrentRun>
+#include <QFuture>
+#include <algorithm>
 #include <functional>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 
 
 // ----------------------------------------------------------------------------------
-// dumpSlice
+// encodeDumpVoxels
 // ----------------------------------------------------------------------------------
 
-template< typename VoxelType >
-static void dumpSlice( QDataStream& out, const Carna::base::model::Volume& volume, unsigned int z )
+/** \brief  Converts \a count voxels from the \c UInt16Volume encoding to big-endian
+  *         signed HUVs of \a bytesPerVoxel bytes each.
+  */
+static void encodeDumpVoxels
+    ( const Carna::base::model::UInt16Volume::VoxelType* in
+    , unsigned int bytesPerVoxel
+    , char* out
+    , unsigned int count )
 {
-    for( unsigned int y = 0; y < volume.size.y; ++y )
-    for( unsigned int x = 0; x < volume.size.x; ++x )
+    unsigned char* const bytes = reinterpret_cast< unsigned char* >( out );
+    unsigned int i = 0;
+
+#ifdef DICOMVIEWER_SSE2
+
+    const __m128i offset = _mm_set1_epi16( 1024 );
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m128i huv = _mm_sub_epi16( _mm_srli_epi16( _mm_loadu_si128( reinterpret_cast< const __m128i* >( in + i ) ), 4 ), offset );
+        const __m128i swapped = _mm_or_si128( _mm_slli_epi16( huv, 8 ), _mm_srli_epi16( huv, 8 ) );
+        if( bytesPerVoxel == 2 )
+        {
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( bytes + 2 * i ), swapped );
+        }
+        else
+        {
+            /* The upper 16 bits of each voxel are the sign extension.
+             */
+            const __m128i sign = _mm_srai_epi16( huv, 15 );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( bytes + 4 * i      ), _mm_unpacklo_epi16( sign, swapped ) );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( bytes + 4 * i + 16 ), _mm_unpackhi_epi16( sign, swapped ) );
+        }
+    }
+
+#endif
+
+    for( ; i < count; ++i )
     {
-        const auto huv = volume( x, y, z );
-        out << static_cast< VoxelType >( huv );
+        const uint32_t huv = static_cast< uint32_t >( static_cast< int32_t >( VolumeRows::decode( in[ i ] ) ) );
+        unsigned char* const voxel = bytes + bytesPerVoxel * i;
+        for( unsigned int k = 0; k < bytesPerVoxel; ++k )
+        {
+            voxel[ k ] = static_cast< unsigned char >( huv >> ( 8 * ( bytesPerVoxel - 1 - k ) ) );
+        }
     }
 }
 
 
 
 // ----------------------------------------------------------------------------------
-// createVoxelReader
+// decodeDumpVoxels
 // ----------------------------------------------------------------------------------
 
-template< typename VoxelType >
-static std::function< Carna::base::model::UInt16Volume::VoxelType( QDataStream& ) > createVoxelReader()
+/** \brief  Converts \a count big-endian voxels of \a bytesPerVoxel bytes each to the
+  *         \c UInt16Volume encoding.
+  *
+  * Only the lower 16 bits of each voxel are regarded, like the former per-voxel
+  * conversion \f$((\mathrm{huv} + 1024) \bmod 2^{16}) \cdot 2^4\f$ did.
+  */
+static void decodeDumpVoxels
+    ( const char* in
+    , unsigned int bytesPerVoxel
+    , Carna::base::model::UInt16Volume::VoxelType* out
+    , unsigned int count )
 {
-    return []( QDataStream& in )->Carna::base::model::UInt16Volume::VoxelType
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+    const unsigned char* const bytes = reinterpret_cast< const unsigned char* >( in );
+    unsigned int i = 0;
+
+#ifdef DICOMVIEWER_SSE2
+
+    const __m128i offset = _mm_set1_epi16( 1024 );
+    if( bytesPerVoxel == 2 )
+    {
+        for( ; i + 8 <= count; i += 8 )
+        {
+            __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i* >( bytes + 2 * i ) );
+            v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+            v = _mm_slli_epi16( _mm_add_epi16( v, offset ), 4 );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( out + i ), v );
+        }
+    }
+    else
     {
-        VoxelType huv;
-        in >> huv;
-        return static_cast< Carna::base::model::UInt16Volume::VoxelType >( huv + 1024 ) << 4;
-    };
+        for( ; i + 8 <= count; i += 8 )
+        {
+            /* The lower 16 bits are the last two bytes of each voxel, which the
+             * arithmetic shift moves down, so that packing is exact.
+             */
+            const __m128i v0 = _mm_srai_epi32( _mm_loadu_si128( reinterpret_cast< const __m128i* >( bytes + 4 * i      ) ), 16 );
+            const __m128i v1 = _mm_srai_epi32( _mm_loadu_si128( reinterpret_cast< const __m128i* >( bytes + 4 * i + 16 ) ), 16 );
+            __m128i v = _mm_packs_epi32( v0, v1 );
+            v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+            v = _mm_slli_epi16( _mm_add_epi16( v, offset ), 4 );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( out + i ), v );
+        }
+    }
+
+#endif
+
+    for( ; i < count; ++i )
+    {
+        const unsigned char* const voxel = bytes + bytesPerVoxel * ( i + 1 ) - 2;
+        const Voxel huv = static_cast< Voxel >( ( voxel[ 0 ] << 8 ) | voxel[ 1 ] );
+        out[ i ] = static_cast< Voxel >( static_cast< Voxel >( huv + 1024 ) << 4 );
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// BinaryDumpImportJob
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads blocks of some binary dump, while the previous block is decoded by
+  *         the thread pool.
+  */
+class BinaryDumpImportJob : public ImportJob
+{
+
+public:
+
+    BinaryDumpImportJob
+        ( QFile& file
+        , qint64 dataOffset
+        , const Carna::base::Vector3ui& size
+        , unsigned int bytesPerVoxel
+        , const QString& description
+        , double spacingX
+        , double spacingY
+        , double spacingZ )
+        : ImportJob( description, spacingX, spacingY, spacingZ )
+        , file( file )
+        , dataOffset( dataOffset )
+        , size( size )
+        , bytesPerVoxel( bytesPerVoxel )
+    {
+    }
+
+
+protected:
+
+    virtual Carna::base::model::Volume* load() override;
+
+
+private:
+
+    QFile& file;
+
+    const qint64 dataOffset;
+
+    const Carna::base::Vector3ui size;
+
+    const unsigned int bytesPerVoxel;
+
+}; // BinaryDumpImportJob
+
+
+Carna::base::model::Volume* BinaryDumpImportJob::load()
+{
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+    Carna::base::model::UInt16Volume::BufferType* const buffer = new Carna::base::model::UInt16Volume::BufferType( size.x * size.y * size.z );
+
+    std::unique_ptr< Carna::base::model::UInt16Volume > loadedVolume( new Carna::base::model::UInt16Volume( size, new Carna::base::Composition< Carna::base::model::UInt16Volume::BufferType >( buffer ) ) );
+
+    /* Each block is read into one of two buffers, while the other one is decoded
+     * by the thread pool.
+     */
+    const static unsigned int BLOCK_VOXELS = 1 << 22;
+    std::vector< char > blocks[ 2 ];
+    blocks[ 0 ].resize( BLOCK_VOXELS * bytesPerVoxel );
+    blocks[ 1 ].resize( BLOCK_VOXELS * bytesPerVoxel );
+
+    QFuture< void > pendingDecode;
+    bool decoding = false;
+
+    file.seek( dataOffset );
+
+    const unsigned long voxels_count = buffer->size();
+    unsigned int block = 0;
+    for( unsigned long first = 0; first < voxels_count; first += BLOCK_VOXELS, ++block )
+    {
+        if( isCanceled() )
+        {
+            break;
+        }
+
+        const unsigned int count = static_cast< unsigned int >( std::min< unsigned long >( BLOCK_VOXELS, voxels_count - first ) );
+        char* const in = &blocks[ block % 2 ].front();
+        const bool complete = file.read( in, count * bytesPerVoxel ) == static_cast< qint64 >( count * bytesPerVoxel );
+
+     // wait for the previous block before this one is handed out
+
+        if( decoding )
+        {
+            pendingDecode.waitForFinished();
+            decoding = false;
+        }
+        if( !complete )
+        {
+            throw std::runtime_error( "Binary dump smaller than expected." );
+        }
+
+        Voxel* const out = &( *buffer )[ first ];
+        std::function< void() > decode = [this, in, out, count]()
+        {
+            const Slabs chunks( count, 1 << 16 );
+            chunks.process( [&]( unsigned int, unsigned int begin, unsigned int end )
+                {
+                    decodeDumpVoxels( in + begin * bytesPerVoxel, bytesPerVoxel, out + begin, end - begin );
+                }
+            );
+        };
+        pendingDecode = QtConcurrent::run( decode );
+        decoding = true;
+
+        reportProgress( static_cast< double >( first + count ) / voxels_count );
+    }
+
+    if( decoding )
+    {
+        pendingDecode.waitForFinished();
+    }
+
+    file.close();
+
+    if( isCanceled() )
+    {
+        return nullptr;
+    }
+
+    /*
+    OptimizedVolumeDecorator* optimizedVolume = new OptimizedVolumeDecorator
+        ( new Carna::base::Composition< const Carna::base::model::Volume >( volume )
+        , spacingX
+        , spacingY
+        , spacingZ );
+        */
+
+    return loadedVolume.release();
 }
 
 
@@ -141,6 +365,21 @@ void BinaryDumpProcessor::doExport( Exporter& exporter )
     progress.setWindowModality( Qt::WindowModal );
     progress.show();
 
+    const unsigned int bytesPerVoxel = static_cast< unsigned int >( dump_size_in_bytes / ( volume.size.x * volume.size.y * volume.size.z ) );
+    const qint64 sliceBytes = static_cast< qint64 >( volume.size.x ) * volume.size.y * bytesPerVoxel;
+
+    /* Each slice is converted into one of two buffers, while the other one is
+     * written by a worker thread.
+     */
+    const VolumeRows rows( volume );
+    std::vector< char > buffers[ 2 ];
+    buffers[ 0 ].resize( static_cast< std::size_t >( sliceBytes ) );
+    buffers[ 1 ].resize( static_cast< std::size_t >( sliceBytes ) );
+
+    QFuture< bool > pendingWrite;
+    bool writing = false;
+    bool failed = false;
+
     for( unsigned int z = 0; z < volume.size.z; ++z )
     {
         if( progress.wasCanceled() )
@@ -148,36 +387,58 @@ void BinaryDumpProcessor::doExport( Exporter& exporter )
             break;
         }
 
-     // write line-wise
-
-        switch( export_settings.voxelFormat.value() )
-        {
+     // convert the slice row-wise
 
-            case IntegerFormatChooser::native16bit:
+        char* const slice = &buffers[ z % 2 ].front();
+        const Slabs slabs( volume.size.y, 16 );
+        slabs.process( [&]( unsigned int, unsigned int y0, unsigned int y1 )
             {
-                dumpSlice< uint16_t >( out, volume, z );
-                break;
+                std::vector< VolumeRows::Voxel > scratch;
+                for( unsigned int y = y0; y < y1; ++y )
+                {
+                    encodeDumpVoxels( rows.row( y, z, scratch ), bytesPerVoxel, slice + y * volume.size.x * bytesPerVoxel, volume.size.x );
+                }
             }
+        );
 
-            case IntegerFormatChooser::native32bit:
+     // write the slice once the previous one is written
+
+        if( writing )
+        {
+            if( !pendingWrite.result() )
             {
-                dumpSlice< uint32_t >( out, volume, z );
+                writing = false;
+                failed = true;
                 break;
             }
-
-            default:
-                throw std::logic_error( "Unsupported integer format." );
-
         }
 
+        std::function< bool() > write = [&file, slice, sliceBytes]()->bool
+        {
+            return file.write( slice, sliceBytes ) == sliceBytes;
+        };
+        pendingWrite = QtConcurrent::run( write );
+        writing = true;
+
         progress.setValue( z );
     }
 
+    if( writing && !pendingWrite.result() )
+    {
+        failed = true;
+    }
+
+ // the header declares the full depth, hence a partial dump is dropped
+
     file.close();
+    if( failed || progress.wasCanceled() )
+    {
+        file.remove();
+    }
 }
 
 
-Carna::base::model::Scene* BinaryDumpProcessor::doImport( Importer& importer )
+ImportJob* BinaryDumpProcessor::doImport( Importer& importer )
 {
     ImportDialog import_settings( importer.parent );
     if( import_settings.exec() != QDialog::Accepted )
@@ -256,83 +517,38 @@ Carna::base::model::Scene* BinaryDumpProcessor::doImport( Importer& importer )
         throw std::runtime_error( "Binary dump smaller than expected." );
     }
 
- // read data
-
-    const static unsigned int PROGRESS_STEPS = 1000;
-    QProgressDialog status( "Reading " + DataSize( data_size_in_bytes ) + "...", "Abort", 0, PROGRESS_STEPS - 1, importer.parent );
-    status.setWindowTitle( "Import Volume" );
-    status.setWindowModality( Qt::WindowModal );
-    status.show();
+ // read data in the background
 
     const Carna::base::Vector3ui size( width, height, depth );
 
-    Carna::base::model::UInt16Volume::BufferType* const buffer = new Carna::base::model::UInt16Volume::BufferType( size.x * size.y * size.z );
-
-    Carna::base::model::UInt16Volume* const volume = new Carna::base::model::UInt16Volume( size, new Carna::base::Composition< Carna::base::model::UInt16Volume::BufferType >( buffer ) );
-
-    std::function< Carna::base::model::UInt16Volume::VoxelType( QDataStream& ) > readVoxel;
-    switch( import_settings.voxelFormat.value() )
+    const unsigned int bytesPerVoxel = [&]()->unsigned int
     {
-
-        case IntegerFormatChooser::native16bit:
-        {
-            readVoxel = createVoxelReader< uint16_t >();
-            break;
-        }
-
-        case IntegerFormatChooser::native32bit:
+        switch( import_settings.voxelFormat.value() )
         {
-            readVoxel = createVoxelReader< uint32_t >();
-            break;
-        }
 
-        default:
-            throw std::logic_error( "Unsupported integer format." );
-
-    }
-
-    unsigned int progress = 0;
-    unsigned int progress_step = buffer->size() / PROGRESS_STEPS;
-    for( unsigned long i = 0; i < buffer->size(); ++i )
-    {
-        if( status.wasCanceled() )
-        {
-            break;
-        }
+            case IntegerFormatChooser::native16bit:
+            {
+                return 2;
+            }
 
-        const Carna::base::model::UInt16Volume::VoxelType voxel = readVoxel( in );
+            case IntegerFormatChooser::native32bit:
+            {
+                return 4;
+            }
 
-        ( *buffer )[ i ] = voxel;
+            default:
+                throw std::logic_error( "Unsupported integer format." );
 
-        if( ( i + 1 ) % progress_step == 0 )
-        {
-            status.setValue( ++progress );
         }
-    }
-
-    /*
-    OptimizedVolumeDecorator* optimizedVolume = new OptimizedVolumeDecorator
-        ( new Carna::base::Composition< const Carna::base::model::Volume >( volume )
-        , spacingX
-        , spacingY
-        , spacingZ );
-        
-    Carna::base::model::Scene* const model = new Carna::base::model::Scene
-        ( new Carna::base::Composition< Carna::base::model::Volume >( optimizedVolume )
-        , spacingX
-        , spacingY
-        , spacingZ );
-        */
+    }();
 
-    Carna::base::model::Scene* const model = new Carna::base::model::Scene
-        ( new Carna::base::Composition< Carna::base::model::Volume >( volume )
+    return new BinaryDumpImportJob
+        ( file
+        , data_offset
+        , size
+        , bytesPerVoxel
+        , "Reading " + DataSize( data_size_in_bytes ) + "..."
         , spacingX
         , spacingY
         , spacingZ );
-
-    model->setRecommendedVoidThreshold( Carna::base::model::SceneFactory::computeVoidThreshold( *volume ) );
-
-    file.close();
-
-    return model;
 }
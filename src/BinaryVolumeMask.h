@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include "HuvRangeMask.h"
 #include <Carna/base/model/Volume.h>
 
 
@@ -19,6 +20,11 @@
 // BinaryVolumeMask
 // ----------------------------------------------------------------------------------
 
+/** \brief  Tells whether voxels lie within some HUV range.
+  *
+  * Looks the voxels up from the \ref HuvRangeMask which is shared among all masks of
+  * the same volume and range.
+  */
 class BinaryVolumeMask
 {
 
@@ -28,6 +34,7 @@ public:
         : min( min )
         , max( max )
         , volume( &volume )
+        , bits( HuvRangeMask::acquire( volume, min, max ) )
     {
     }
 
@@ -61,14 +68,7 @@ public:
 
     virtual bool test( unsigned int x, unsigned int y, unsigned int z ) const
     {
-        const signed short huv = ( *volume )( x, y, z );
-
-        CARNA_ASSERT( huv >= -1024 );
-        CARNA_ASSERT( huv <=  3071 );
-
-        const bool result = min <= huv && huv <= max;
-
-        return result;
+        return bits->test( x, y, z );
     }
 
     BinaryVolumeMask& operator=( const BinaryVolumeMask& cp )
@@ -78,6 +78,8 @@ public:
         min = cp.min;
         max = cp.max;
 
+        bits = cp.bits;
+
         return *this;
     }
 
@@ -90,4 +92,6 @@ private:
 
     int max;
 
+    std::shared_ptr< const HuvRangeMask > bits;
+
 }; // BinaryVolumeMask
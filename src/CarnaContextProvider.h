@@ -36,7 +36,8 @@ public:
       */
     CarnaContextProvider( Record::Server& server, Carna::base::model::Scene* model )
         : Provider( server )
-        , myModel( model )
+        , myModel( *model )
+        , ownedModel( model )
         , myScene( new Carna::base::view::SceneProvider( *model ) )
     {
     }
@@ -53,13 +54,24 @@ public:
 
     virtual Carna::base::model::Scene& model() const override
     {
-        return *myModel;
+        return myModel;
+    }
+
+    /** \brief  Transfers the ownership of the Carna model to the caller.
+      *
+      * The model stays accessible through \ref model until this provider is released.
+      */
+    Carna::base::model::Scene* releaseModel()
+    {
+        return ownedModel.release();
     }
 
 
 private:
 
-    const std::unique_ptr< Carna::base::model::Scene > myModel;
+    Carna::base::model::Scene& myModel;
+
+    std::unique_ptr< Carna::base::model::Scene > ownedModel;
 
     const std::unique_ptr< Carna::base::view::SceneProvider > myScene;
 
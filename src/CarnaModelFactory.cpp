@@ -12,12 +12,38 @@
 #include "CarnaModelFactory.h"
 #include "FileChooser.h"
 #include "Importer.h"
+#include "ImportJob.h"
 #include "BinaryDumpProcessor.h"
+#include "CompressedDumpProcessor.h"
+#include "NativeDumpProcessor.h"
+#include "VolumeCache.h"
+#include "VolumeCacheJob.h"
 #include <Carna/dicom/DicomController.h>
 #include <Carna/dicom/DicomSceneFactory.h>
+#include <Carna/dicom/Series.h>
+#include <Carna/dicom/SeriesElement.h>
 #include <QTabWidget>
 #include <QVBoxLayout>
 #include <QMetaType>
+#include <QMessageBox>
+#include <QProgressDialog>
+
+
+
+/** \brief  Tells the \ref VolumeCache key of the volume \a request is converted to.
+  */
+static QString seriesVolumeCacheKey( const Carna::dicom::SeriesLoadingRequest& request )
+{
+    const auto& elements = request.getSeries().getElements();
+
+    QStringList fileNames;
+    for( auto element = elements.begin(); element != elements.end(); ++element )
+    {
+        fileNames << QString::fromStdString( ( *element )->fileName );
+    }
+
+    return VolumeCache::key( fileNames, request.getSpacingZ() );
+}
 
 
 
@@ -30,6 +56,8 @@ CarnaModelFactory::CarnaModelFactory( Record::Server& server, QWidget* parent )
     , tabs( new QTabWidget() )
     , importer( new Importer( server, this ) )
     , importFileChooser( new FileChooser() )
+    , importJob( nullptr )
+    , cacheJob( nullptr )
 {
     this->setLayout( new QVBoxLayout() );
     this->layout()->setContentsMargins( 0, 0, 0, 0 );
@@ -50,7 +78,11 @@ CarnaModelFactory::CarnaModelFactory( Record::Server& server, QWidget* parent )
 
  // ----------------------------------------------------------------------------------
 
+    qRegisterMetaType< Carna::base::model::Scene* >( "Carna::base::model::Scene*" );
+
     importer->install( new BinaryDumpProcessor() );
+    importer->install( new NativeDumpProcessor() );
+    importer->install( new CompressedDumpProcessor() );
 
     importFileChooser->setAcceptMode( QFileDialog::AcceptOpen );
     importFileChooser->setFileMode( QFileDialog::ExistingFile );
@@ -64,15 +96,87 @@ CarnaModelFactory::CarnaModelFactory( Record::Server& server, QWidget* parent )
 }
 
 
+CarnaModelFactory::~CarnaModelFactory()
+{
+    /* The job reads from the importer's file, hence it must finish first. The
+     * worker is joined before the job is deleted, since it uses derived members.
+     */
+    if( importJob != nullptr )
+    {
+        importJob->cancelAndWait();
+        delete importJob;
+    }
+
+    /* The job writes from a copy of the volume, which is deleted along with it.
+     */
+    delete cacheJob;
+}
+
+
 void CarnaModelFactory::dispatch( const Carna::dicom::SeriesLoadingRequest& request )
 {
-    Carna::dicom::DicomSceneFactory factory( this );
-    Carna::base::model::Scene* const model = factory.createFromRequest( request );
+    if( importJob != nullptr || cacheJob != nullptr )
+    {
+        QMessageBox::information( this, "Load Series", "Another volume is being loaded or cached. Wait until it is done or abort it." );
+        return;
+    }
+
+    VolumeCache cache;
+    const QString key = seriesVolumeCacheKey( request );
 
+ // reopened series are mapped from the cache
+
+    Carna::base::model::Scene* model = cache.load( key );
     if( model != nullptr )
     {
         emit created( model );
+        return;
+    }
+
+ // others are converted and cached for the next time
+
+    Carna::dicom::DicomSceneFactory factory( this );
+    model = factory.createFromRequest( request );
+
+    if( model == nullptr )
+    {
+        return;
+    }
+    else
+    if( !cache.isEnabled() )
+    {
+        emit created( model );
+        return;
     }
+
+ // the cache is written in the background from a copy, while the scene is handed out
+
+    VolumeCacheJob* job;
+    try
+    {
+        job = new VolumeCacheJob( key, *model );
+    }
+    catch( const std::bad_alloc& )
+    {
+        /* The cache is optional, hence the scene is handed out uncached.
+         */
+        emit created( model );
+        return;
+    }
+
+    QProgressDialog* const progress = new QProgressDialog( "Caching volume...", "Skip", 0, VolumeCacheJob::PROGRESS_STEPS - 1, this );
+    progress->setWindowTitle( "Load Series" );
+
+    connect( job, SIGNAL( progressed( int ) ), progress, SLOT( setValue( int ) ) );
+    connect( progress, SIGNAL( canceled() ), job, SLOT( cancel() ) );
+    connect( job, SIGNAL( destroyed() ), progress, SLOT( deleteLater() ) );
+    connect( job, SIGNAL( destroyed() ), this, SLOT( cacheDone() ) );
+
+    cacheJob = job;
+    job->start();
+    progress->show();
+
+    emit created( model );
 }
 
 
@@ -92,10 +196,62 @@ void CarnaModelFactory::import()
 
     const QString& fileName = fileNames[ 0 ];
     importer->setFile( new QFile( fileName ) );
-    Carna::base::model::Scene* const model = importer->run();
 
-    if( model != nullptr )
+    ImportJob* job;
+    try
     {
-        emit created( model );
+        job = importer->run();
+    }
+    catch( const std::exception& ex )
+    {
+        QMessageBox::critical( this, "Import Volume", QString::fromStdString( ex.what() ) );
+        return;
+    }
+
+    if( job == nullptr )
+    {
+        return;
     }
+
+ // the job owns the progress, while the GUI stays responsive
+
+    QProgressDialog* const progress = new QProgressDialog( job->description, "Abort", 0, ImportJob::PROGRESS_STEPS - 1, this );
+    progress->setWindowTitle( "Import Volume" );
+
+    connect( job, SIGNAL( progressed( int ) ), progress, SLOT( setValue( int ) ) );
+    connect( progress, SIGNAL( canceled() ), job, SLOT( cancel() ) );
+    connect( job, SIGNAL( destroyed() ), progress, SLOT( deleteLater() ) );
+    connect( job, SIGNAL( destroyed() ), this, SLOT( importDone() ) );
+    connect( job, SIGNAL( failed( const QString& ) ), this, SLOT( importFailed( const QString& ) ) );
+
+    /* The scene is handed out once the job has returned from its notification.
+     */
+    connect( job, SIGNAL( finished( Carna::base::model::Scene* ) ), this, SIGNAL( created( Carna::base::model::Scene* ) ), Qt::QueuedConnection );
+
+    importJob = job;
+    /* Neither the DICOM controller nor the importer may create another scene
+     * while the job is pending.
+     */
+    tabs->setEnabled( false );
+    job->start();
+    progress->show();
+}
+
+
+void CarnaModelFactory::importDone()
+{
+    importJob = nullptr;
+    tabs->setEnabled( true );
+}
+
+
+void CarnaModelFactory::cacheDone()
+{
+    cacheJob = nullptr;
+}
+
+
+void CarnaModelFactory::importFailed( const QString& message )
+{
+    QMessageBox::critical( this, "Import Volume", message );
 }
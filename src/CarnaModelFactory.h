@@ -17,6 +17,8 @@
 #include <QWidget>
 
 class Importer;
+class ImportJob;
+class VolumeCacheJob;
 class FileChooser;
 
 class QTabWidget;
@@ -36,6 +38,10 @@ public:
 
     CarnaModelFactory( Record::Server& server, QWidget* parent = nullptr );
 
+    /** \brief  Waits for the running import and cache jobs, if there are any.
+      */
+    virtual ~CarnaModelFactory();
+
 
 signals:
 
@@ -50,11 +56,33 @@ private:
 
     FileChooser* const importFileChooser;
 
+    /** \brief  References the running import job or is \c nullptr.
+      */
+    ImportJob* importJob;
+
+    /** \brief  References the job which writes the converted series to the
+      *         \ref VolumeCache or is \c nullptr.
+      */
+    VolumeCacheJob* cacheJob;
+
 
 private slots:
 
     void dispatch( const Carna::dicom::SeriesLoadingRequest& );
     void closeImporter();
     void import();
+
+    /** \brief  Enables the DICOM controller and the import again once the running
+      *         job is gone.
+      */
+    void importDone();
+
+    /** \brief  Accepts further series once the running cache job is gone.
+      */
+    void cacheDone();
+
+    /** \brief  Reports that the running import job failed.
+      */
+    void importFailed( const QString& message );
     
 }; // CarnaModelFactory
@@ -100,7 +100,9 @@ ClippedVolumeMask& ClippedVolumeMask::operator=( const ClippedVolumeMask& other
 
 bool ClippedVolumeMask::test( unsigned int x, unsigned int y, unsigned int z ) const
 {
-    if( !accept( Carna::base::Vector3ui( x, y, z ) ) )
+    /* The bit test is by far the cheapest, hence it is done first.
+     */
+    if( !BinaryVolumeMask::test( x, y, z ) || !accept( Carna::base::Vector3ui( x, y, z ) ) )
     {
         return false;
     }
@@ -174,6 +176,6 @@ bool ClippedVolumeMask::test( unsigned int x, unsigned int y, unsigned int z ) c
     }
     else
     {
-        return distance_to_closest_line < closest_line->radius && BinaryVolumeMask::test( x, y, z );
+        return distance_to_closest_line < closest_line->radius;
     }
 }
@@ -0,0 +1,205 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "CompressedDump.h"
+#include "VolumeRows.h"
+#include <QDataStream>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+
+// ----------------------------------------------------------------------------------
+// CompressedDump
+// ----------------------------------------------------------------------------------
+
+const char CompressedDump::MAGIC[ 4 ] = { 'C', 'V', 'D', '1' };
+
+
+CompressedDump::CompressedDump( const QString& fileName )
+    : file( fileName )
+{
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        throw std::runtime_error( "Failed to open \"" + fileName.toStdString() + "\"." );
+    }
+    QDataStream in( &file );
+
+ // read header
+
+    char magic[ sizeof( MAGIC ) ];
+    if( in.readRawData( magic, sizeof( magic ) ) != sizeof( magic ) || std::memcmp( magic, MAGIC, sizeof( magic ) ) != 0 )
+    {
+        throw std::runtime_error( "Not a compressed volume dump." );
+    }
+
+    quint32 width, height, depth;
+    quint64 indexOffset;
+    in >> edgeLength;
+    in >> width >> height >> depth;
+    in >> spacing[ 0 ] >> spacing[ 1 ] >> spacing[ 2 ];
+    in >> recommendedVoidThreshold >> indexOffset;
+
+    if( in.status() != QDataStream::Ok )
+    {
+        throw std::runtime_error( "Compressed volume dump header is incomplete." );
+    }
+    if( edgeLength == 0 || width == 0 || height == 0 || depth == 0 )
+    {
+        throw std::runtime_error( "Dataset dimensions are invalid." );
+    }
+    if( spacing[ 0 ] <= 0 || spacing[ 1 ] <= 0 || spacing[ 2 ] <= 0 )
+    {
+        throw std::runtime_error( "Spacings are invalid." );
+    }
+
+    volumeSize = Carna::base::Vector3ui( width, height, depth );
+    brickCounts = Carna::base::Vector3ui
+        ( ( width  + edgeLength - 1 ) / edgeLength
+        , ( height + edgeLength - 1 ) / edgeLength
+        , ( depth  + edgeLength - 1 ) / edgeLength );
+
+ // read index table
+
+    file.seek( static_cast< qint64 >( indexOffset ) );
+
+    brickOffsets.resize( bricksCount() );
+    brickLengths.resize( bricksCount() );
+    for( unsigned int brick = 0; brick < bricksCount(); ++brick )
+    {
+        in >> brickOffsets[ brick ] >> brickLengths[ brick ];
+    }
+
+    if( in.status() != QDataStream::Ok )
+    {
+        throw std::runtime_error( "Compressed volume dump index is incomplete." );
+    }
+}
+
+
+unsigned int CompressedDump::brickAt( unsigned int x, unsigned int y, unsigned int z ) const
+{
+    return x / edgeLength + brickCounts.x * ( y / edgeLength + brickCounts.y * ( z / edgeLength ) );
+}
+
+
+Carna::base::Vector3ui CompressedDump::brickBegin( unsigned int brick ) const
+{
+    return Carna::base::Vector3ui
+        ( ( brick % brickCounts.x ) * edgeLength
+        , ( brick / brickCounts.x % brickCounts.y ) * edgeLength
+        , ( brick / brickCounts.x / brickCounts.y ) * edgeLength );
+}
+
+
+Carna::base::Vector3ui CompressedDump::brickExtent( unsigned int brick ) const
+{
+    const Carna::base::Vector3ui begin = brickBegin( brick );
+    return Carna::base::Vector3ui
+        ( std::min( edgeLength, volumeSize.x - begin.x )
+        , std::min( edgeLength, volumeSize.y - begin.y )
+        , std::min( edgeLength, volumeSize.z - begin.z ) );
+}
+
+
+void CompressedDump::decodeBrick( unsigned int brick, std::vector< Voxel >& out ) const
+{
+    const Carna::base::Vector3ui extent = brickExtent( brick );
+    const unsigned int count = extent.x * extent.y * extent.z;
+
+ // read the compressed brick
+
+    QByteArray compressed;
+    {
+        QMutexLocker lock( &fileLock );
+
+        file.seek( static_cast< qint64 >( brickOffsets[ brick ] ) );
+        compressed = file.read( brickLengths[ brick ] );
+    }
+    if( compressed.size() != static_cast< int >( brickLengths[ brick ] ) )
+    {
+        throw std::runtime_error( "Compressed volume dump smaller than expected." );
+    }
+
+    const QByteArray planes = qUncompress( compressed );
+    if( planes.size() != static_cast< int >( count * sizeof( Voxel ) ) )
+    {
+        throw std::runtime_error( "Compressed brick is corrupt." );
+    }
+
+ // join the byte planes and undo the prediction row-wise
+
+    const unsigned char* const low  = reinterpret_cast< const unsigned char* >( planes.constData() );
+    const unsigned char* const high = low + count;
+
+    out.resize( count );
+    for( unsigned int row = 0; row < count; row += extent.x )
+    {
+        Voxel previous = 0;
+        for( unsigned int i = row; i < row + extent.x; ++i )
+        {
+            previous = static_cast< Voxel >( previous + ( low[ i ] | ( high[ i ] << 8 ) ) );
+            out[ i ] = previous;
+        }
+    }
+}
+
+
+void CompressedDump::decodeBrick( unsigned int brick, Carna::base::model::UInt16Volume& volume ) const
+{
+    std::vector< Voxel > voxels;
+    decodeBrick( brick, voxels );
+
+    const Carna::base::Vector3ui begin  = brickBegin( brick );
+    const Carna::base::Vector3ui extent = brickExtent( brick );
+
+    Voxel* const buffer = &volume.getBuffer().front();
+    for( unsigned int z = 0; z < extent.z; ++z )
+    for( unsigned int y = 0; y < extent.y; ++y )
+    {
+        const std::size_t target = begin.x + volumeSize.x * ( begin.y + y + static_cast< std::size_t >( volumeSize.y ) * ( begin.z + z ) );
+        std::memcpy( buffer + target, &voxels[ extent.x * ( y + extent.y * z ) ], extent.x * sizeof( Voxel ) );
+    }
+}
+
+
+QByteArray CompressedDump::encodeBrick
+    ( const VolumeRows& rows
+    , const Carna::base::Vector3ui& begin
+    , const Carna::base::Vector3ui& extent )
+{
+    const unsigned int count = extent.x * extent.y * extent.z;
+
+ // predict each voxel from its left neighbor and split the byte planes
+
+    QByteArray planes( static_cast< int >( count * sizeof( Voxel ) ), '\0' );
+    unsigned char* const low  = reinterpret_cast< unsigned char* >( planes.data() );
+    unsigned char* const high = low + count;
+
+    std::vector< Voxel > scratch;
+    unsigned int i = 0;
+    for( unsigned int z = 0; z < extent.z; ++z )
+    for( unsigned int y = 0; y < extent.y; ++y )
+    {
+        const Voxel* const row = rows.row( begin.y + y, begin.z + z, scratch ) + begin.x;
+        Voxel previous = 0;
+        for( unsigned int x = 0; x < extent.x; ++x, ++i )
+        {
+            const Voxel delta = static_cast< Voxel >( row[ x ] - previous );
+            low [ i ] = static_cast< unsigned char >( delta );
+            high[ i ] = static_cast< unsigned char >( delta >> 8 );
+            previous = row[ x ];
+        }
+    }
+
+    return qCompress( planes );
+}
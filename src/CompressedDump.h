@@ -0,0 +1,196 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <QFile>
+#include <QMutex>
+#include <QByteArray>
+#include <cstdint>
+#include <vector>
+
+class VolumeRows;
+
+
+
+// ----------------------------------------------------------------------------------
+// CompressedDump
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads \c *.cvd files, which store a volume as independently compressed
+  *         bricks.
+  *
+  * The file starts with a big-endian header:
+  *
+  * | Field            | Type          | Value                                 |
+  * |------------------|---------------|---------------------------------------|
+  * | magic            | 4 bytes       | \c CVD1                               |
+  * | brick size       | \c uint32_t   | edge length of a brick in voxels      |
+  * | size             | 3 \c uint32_t | width, height, depth                  |
+  * | spacing          | 3 \c double   | millimeters per voxel                 |
+  * | void threshold   | \c int32_t    | recommended void threshold in HUV     |
+  * | index offset     | \c uint64_t   | position of the index table           |
+  *
+  * The index table holds the offset as \c uint64_t and the length as \c uint32_t of
+  * each brick, x-major like the voxels. Bricks at the upper borders of the volume
+  * are smaller.
+  *
+  * Each row of a brick is stored as its first voxel, followed by the differences of
+  * all subsequent voxels to their left neighbors, modulo \f$2^{16}\f$. The low bytes
+  * of all voxels are stored before the high bytes, and the result is compressed
+  * with \c qCompress.
+  *
+  * Since bricks are decoded independently, \ref decodeBrick may be invoked
+  * concurrently.
+  */
+class CompressedDump
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Holds the encoded voxel type.
+      */
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+    /** \brief  Holds the first four bytes of each dump.
+      */
+    const static char MAGIC[ 4 ];
+
+    /** \brief  Holds the brick edge length which new dumps are written with.
+      */
+    const static unsigned int DEFAULT_BRICK_SIZE = 32;
+
+
+    /** \brief  Reads the header and the index table of the file \a fileName.
+      *
+      * \throws std::runtime_error  if the file cannot be read or is malformed.
+      */
+    explicit CompressedDump( const QString& fileName );
+
+
+    /** \brief  Tells the volume size.
+      */
+    const Carna::base::Vector3ui& size() const
+    {
+        return volumeSize;
+    }
+
+    /** \brief  Tells the voxel width in millimeters.
+      */
+    double spacingX() const
+    {
+        return spacing[ 0 ];
+    }
+
+    /** \brief  Tells the voxel height in millimeters.
+      */
+    double spacingY() const
+    {
+        return spacing[ 1 ];
+    }
+
+    /** \brief  Tells the voxel depth in millimeters.
+      */
+    double spacingZ() const
+    {
+        return spacing[ 2 ];
+    }
+
+    /** \brief  Tells the recommended void threshold.
+      */
+    int voidThreshold() const
+    {
+        return recommendedVoidThreshold;
+    }
+
+    /** \brief  Tells the edge length of a brick in voxels.
+      */
+    unsigned int brickSize() const
+    {
+        return edgeLength;
+    }
+
+    /** \brief  Tells the number of bricks along each axis.
+      */
+    const Carna::base::Vector3ui& bricks() const
+    {
+        return brickCounts;
+    }
+
+    /** \brief  Tells the number of bricks.
+      */
+    unsigned int bricksCount() const
+    {
+        return brickCounts.x * brickCounts.y * brickCounts.z;
+    }
+
+    /** \brief  Tells the index of the brick which contains the voxel at \a x, \a y,
+      *         \a z.
+      */
+    unsigned int brickAt( unsigned int x, unsigned int y, unsigned int z ) const;
+
+    /** \brief  Tells the first voxel of \a brick.
+      */
+    Carna::base::Vector3ui brickBegin( unsigned int brick ) const;
+
+    /** \brief  Tells the size of \a brick in voxels.
+      */
+    Carna::base::Vector3ui brickExtent( unsigned int brick ) const;
+
+
+    /** \brief  Decodes \a brick into \a out, x-major with the \ref brickExtent of
+      *         \a brick.
+      *
+      * \throws std::runtime_error  if the brick cannot be read.
+      */
+    void decodeBrick( unsigned int brick, std::vector< Voxel >& out ) const;
+
+    /** \brief  Decodes \a brick to its location within \a volume.
+      */
+    void decodeBrick( unsigned int brick, Carna::base::model::UInt16Volume& volume ) const;
+
+
+    /** \brief  Encodes the brick of \a rows which starts at \a begin and has the
+      *         size \a extent.
+      */
+    static QByteArray encodeBrick
+        ( const VolumeRows& rows
+        , const Carna::base::Vector3ui& begin
+        , const Carna::base::Vector3ui& extent );
+
+
+private:
+
+    mutable QFile file;
+
+    mutable QMutex fileLock;
+
+    Carna::base::Vector3ui volumeSize;
+
+    Carna::base::Vector3ui brickCounts;
+
+    uint32_t edgeLength;
+
+    double spacing[ 3 ];
+
+    int32_t recommendedVoidThreshold;
+
+    std::vector< quint64 > brickOffsets;
+
+    std::vector< quint32 > brickLengths;
+
+}; // CompressedDump
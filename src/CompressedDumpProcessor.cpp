@@ -0,0 +1,241 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "CompressedDumpProcessor.h"
+#include "CompressedDump.h"
+#include "Exporter.h"
+#include "Importer.h"
+#include "ImportJob.h"
+#include "CarnaContextClient.h"
+#include "Slabs.h"
+#include "VolumeRows.h"
+#include <Carna/base/model/Scene.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <QDataStream>
+#include <QProgressDialog>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+
+// ----------------------------------------------------------------------------------
+// CompressedDumpImportJob
+// ----------------------------------------------------------------------------------
+
+/** \brief  Decompresses one layer of bricks at a time, in parallel.
+  */
+class CompressedDumpImportJob : public ImportJob
+{
+
+public:
+
+    explicit CompressedDumpImportJob( const CompressedDump* dump )
+        : ImportJob( "Decompressing...", dump->spacingX(), dump->spacingY(), dump->spacingZ() )
+        , dump( dump )
+    {
+        setVoidThreshold( dump->voidThreshold() );
+    }
+
+
+protected:
+
+    virtual Carna::base::model::Volume* load() override;
+
+
+private:
+
+    const std::unique_ptr< const CompressedDump > dump;
+
+}; // CompressedDumpImportJob
+
+
+Carna::base::model::Volume* CompressedDumpImportJob::load()
+{
+    const Carna::base::Vector3ui& size = dump->size();
+    const Carna::base::Vector3ui& bricks = dump->bricks();
+
+    Carna::base::model::UInt16Volume::BufferType* const buffer = new Carna::base::model::UInt16Volume::BufferType( size.x * size.y * size.z );
+
+    std::unique_ptr< Carna::base::model::UInt16Volume > loadedVolume( new Carna::base::model::UInt16Volume( size, new Carna::base::Composition< Carna::base::model::UInt16Volume::BufferType >( buffer ) ) );
+
+    const unsigned int layerBricks = bricks.x * bricks.y;
+    for( unsigned int bz = 0; bz < bricks.z; ++bz )
+    {
+        if( isCanceled() )
+        {
+            return nullptr;
+        }
+
+        const Slabs slabs( layerBricks );
+        slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+            {
+                for( unsigned int brick = first; brick < last; ++brick )
+                {
+                    dump->decodeBrick( bz * layerBricks + brick, *loadedVolume );
+                }
+            }
+        );
+
+        reportProgress( static_cast< double >( bz + 1 ) / bricks.z );
+    }
+
+    return loadedVolume.release();
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// CompressedDumpProcessor
+// ----------------------------------------------------------------------------------
+
+const std::string& CompressedDumpProcessor::description()
+{
+    const static std::string description = "Compressed volume dump";
+    return description;
+}
+
+
+const std::string& CompressedDumpProcessor::pattern()
+{
+    const static std::string pattern = "*.cvd";
+    return pattern;
+}
+
+
+void CompressedDumpProcessor::doExport( Exporter& exporter )
+{
+ // prepare
+
+    QFile& file = exporter.file();
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        throw std::runtime_error( "Failed opening file for writing." );
+    }
+    QDataStream out( &file );
+
+    /* A partial dump cannot be imported, hence it is dropped if writing fails.
+     */
+    const std::function< void() > discard = [&]()
+    {
+        file.close();
+        file.remove();
+        throw std::runtime_error( "Failed writing the compressed dump." );
+    };
+    const std::function< void() > checkWritten = [&]()
+    {
+        if( out.status() != QDataStream::Ok || file.error() != QFile::NoError )
+        {
+            discard();
+        }
+    };
+
+    const Carna::base::model::Scene& model = CarnaContextClient( exporter.server ).model();
+    const Carna::base::model::Volume& volume = model.volume();
+
+    const unsigned int brickSize = CompressedDump::DEFAULT_BRICK_SIZE;
+    const Carna::base::Vector3ui bricks
+        ( ( volume.size.x + brickSize - 1 ) / brickSize
+        , ( volume.size.y + brickSize - 1 ) / brickSize
+        , ( volume.size.z + brickSize - 1 ) / brickSize );
+
+ // write header, with the index offset patched later
+
+    out.writeRawData( CompressedDump::MAGIC, sizeof( CompressedDump::MAGIC ) );
+    out << static_cast< quint32 >( brickSize );
+    out << static_cast< quint32 >( volume.size.x )
+        << static_cast< quint32 >( volume.size.y )
+        << static_cast< quint32 >( volume.size.z );
+    out << static_cast< double >( model.spacingX() )
+        << static_cast< double >( model.spacingY() )
+        << static_cast< double >( model.spacingZ() );
+    out << static_cast< qint32 >( model.recommendedVoidThreshold() );
+
+    const qint64 indexOffsetPosition = file.pos();
+    out << static_cast< quint64 >( 0 );
+
+ // compress one layer of bricks at a time, in parallel
+
+    QProgressDialog progress( "Compressing...", "Abort", 0, bricks.z, exporter.parent );
+    progress.setWindowTitle( "Export Volume" );
+    progress.setWindowModality( Qt::WindowModal );
+    progress.show();
+
+    const VolumeRows rows( volume );
+    const unsigned int layerBricks = bricks.x * bricks.y;
+
+    std::vector< quint64 > offsets;
+    std::vector< quint32 > lengths;
+    std::vector< QByteArray > layer( layerBricks );
+
+    for( unsigned int bz = 0; bz < bricks.z; ++bz )
+    {
+        if( progress.wasCanceled() )
+        {
+            file.close();
+            file.remove();
+            return;
+        }
+
+        const Slabs slabs( layerBricks );
+        slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+            {
+                for( unsigned int brick = first; brick < last; ++brick )
+                {
+                    const Carna::base::Vector3ui begin( brick % bricks.x * brickSize, brick / bricks.x * brickSize, bz * brickSize );
+                    const Carna::base::Vector3ui extent
+                        ( std::min( brickSize, volume.size.x - begin.x )
+                        , std::min( brickSize, volume.size.y - begin.y )
+                        , std::min( brickSize, volume.size.z - begin.z ) );
+
+                    layer[ brick ] = CompressedDump::encodeBrick( rows, begin, extent );
+                }
+            }
+        );
+
+        for( unsigned int brick = 0; brick < layerBricks; ++brick )
+        {
+            offsets.push_back( static_cast< quint64 >( file.pos() ) );
+            lengths.push_back( static_cast< quint32 >( layer[ brick ].size() ) );
+            out.writeRawData( layer[ brick ].constData(), layer[ brick ].size() );
+        }
+        checkWritten();
+
+        progress.setValue( bz + 1 );
+    }
+
+ // write index table
+
+    const quint64 indexOffset = static_cast< quint64 >( file.pos() );
+    for( std::size_t brick = 0; brick < offsets.size(); ++brick )
+    {
+        out << offsets[ brick ] << lengths[ brick ];
+    }
+    checkWritten();
+
+    if( !file.seek( indexOffsetPosition ) )
+    {
+        discard();
+    }
+    out << indexOffset;
+    file.flush();
+    checkWritten();
+
+    file.close();
+}
+
+
+ImportJob* CompressedDumpProcessor::doImport( Importer& importer )
+{
+    std::unique_ptr< const CompressedDump > dump( new CompressedDump( importer.file().fileName() ) );
+    return new CompressedDumpImportJob( dump.release() );
+}
@@ -0,0 +1,43 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "ExportProcessor.h"
+#include "ImportProcessor.h"
+
+
+
+// ----------------------------------------------------------------------------------
+// CompressedDumpProcessor
+// ----------------------------------------------------------------------------------
+
+/** \brief  Processes \c *.cvd exports and imports, which store the volume as
+  *         independently compressed bricks.
+  *
+  * The bricks are compressed and decompressed in parallel. The file format is
+  * described by \ref CompressedDump.
+  */
+class CompressedDumpProcessor : public ExportProcessor, public ImportProcessor
+{
+
+public:
+
+    virtual const std::string& description() override;
+
+    virtual const std::string& pattern() override;
+
+
+    virtual void doExport( Exporter& ) override;
+
+    virtual ImportJob* doImport( Importer& ) override;
+    
+}; // CompressedDumpProcessor
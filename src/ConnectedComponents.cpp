@@ -0,0 +1,518 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "ConnectedComponents.h"
+#include "HuvRangeMask.h"
+#include "PackedMask.h"
+#include "Slabs.h"
+#include <Carna/base/model/Volume.h>
+#include <Carna/base/CarnaException.h>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <memory>
+
+
+
+// ----------------------------------------------------------------------------------
+// ConnectedComponentsNeighborRow
+// ----------------------------------------------------------------------------------
+
+/** \brief  Describes a previously visited row whose runs may connect to the runs of
+  *         the current row.
+  *
+  * Two runs connect if they are at most \c widen voxels apart along the x-axis.
+  */
+struct ConnectedComponentsNeighborRow
+{
+    int dy, dz, widen;
+};
+
+
+static const ConnectedComponentsNeighborRow CONNECTED_COMPONENTS_FACES[] =
+    { { -1,  0, 0 }
+    , {  0, -1, 0 } };
+
+static const ConnectedComponentsNeighborRow CONNECTED_COMPONENTS_EDGES[] =
+    { { -1,  0, 1 }
+    , {  0, -1, 1 }
+    , { -1, -1, 0 }
+    , { +1, -1, 0 } };
+
+static const ConnectedComponentsNeighborRow CONNECTED_COMPONENTS_VERTICES[] =
+    { { -1,  0, 1 }
+    , {  0, -1, 1 }
+    , { -1, -1, 1 }
+    , { +1, -1, 1 } };
+
+
+static std::vector< ConnectedComponentsNeighborRow > getConnectedComponentsNeighborRows( FloodFill::Connectivity connectivity )
+{
+    switch( connectivity )
+    {
+
+        case FloodFill::faces:
+            return std::vector< ConnectedComponentsNeighborRow >( CONNECTED_COMPONENTS_FACES, CONNECTED_COMPONENTS_FACES + 2 );
+
+        case FloodFill::edges:
+            return std::vector< ConnectedComponentsNeighborRow >( CONNECTED_COMPONENTS_EDGES, CONNECTED_COMPONENTS_EDGES + 4 );
+
+        case FloodFill::vertices:
+            return std::vector< ConnectedComponentsNeighborRow >( CONNECTED_COMPONENTS_VERTICES, CONNECTED_COMPONENTS_VERTICES + 4 );
+
+        default:
+            throw std::logic_error( "Unsupported connectivity." );
+
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// Union-Find
+// ----------------------------------------------------------------------------------
+
+/* The larger root is always linked to the smaller one, hence 'parent[ i ] <= i'
+ * holds for all 'i'. This allows flattening all trees by a single forward pass.
+ */
+
+static unsigned int findConnectedComponentsRoot( std::vector< unsigned int >& parent, unsigned int i )
+{
+    while( parent[ i ] != i )
+    {
+        parent[ i ] = parent[ parent[ i ] ];
+        i = parent[ i ];
+    }
+    return i;
+}
+
+
+static void uniteConnectedComponentsRuns( std::vector< unsigned int >& parent, unsigned int i, unsigned int j )
+{
+    i = findConnectedComponentsRoot( parent, i );
+    j = findConnectedComponentsRoot( parent, j );
+    if( i < j )
+    {
+        parent[ j ] = i;
+    }
+    else
+    if( j < i )
+    {
+        parent[ i ] = j;
+    }
+}
+
+
+/** \brief  Unites all runs from \f$[a_0, a_1)\f$ with the runs from \f$[b_0, b_1)\f$
+  *         they connect to.
+  */
+static void uniteConnectedComponentsRows
+    ( std::vector< unsigned int >& parent
+    , const std::vector< ConnectedComponents::Run >& runs
+    , unsigned int a0, unsigned int a1
+    , unsigned int b0, unsigned int b1
+    , int widen )
+{
+    unsigned int b = b0;
+    for( unsigned int a = a0; a < a1; ++a )
+    {
+        const int ax0 = runs[ a ].x0;
+        const int ax1 = runs[ a ].x1;
+
+        while( b < b1 && static_cast< int >( runs[ b ].x1 ) + widen <= ax0 )
+        {
+            ++b;
+        }
+
+        for( unsigned int k = b; k < b1 && static_cast< int >( runs[ k ].x0 ) < ax1 + widen; ++k )
+        {
+            uniteConnectedComponentsRuns( parent, a, k );
+        }
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// ConnectedComponentsSlab
+// ----------------------------------------------------------------------------------
+
+struct ConnectedComponentsSlab
+{
+    /** \brief  Holds the runs of all rows within the slab in memory order.
+      */
+    std::vector< ConnectedComponents::Run > runs;
+
+    /** \brief  Maps the row \f$(y, z)\f$ to its first run at \f$(z - z_0) \cdot h + y\f$.
+      */
+    std::vector< unsigned int > rowOffsets;
+
+    /** \brief  Holds the union-find forest of this slab's runs, indexed locally.
+      */
+    std::vector< unsigned int > parent;
+};
+
+
+
+// ----------------------------------------------------------------------------------
+// ConnectedComponentsAccumulator
+// ----------------------------------------------------------------------------------
+
+struct ConnectedComponentsAccumulator
+{
+    unsigned long voxels;
+    unsigned int min[ 3 ];
+    unsigned int max[ 3 ];
+    double sum[ 3 ];
+
+    ConnectedComponentsAccumulator()
+        : voxels( 0 )
+    {
+        sum[ 0 ] = sum[ 1 ] = sum[ 2 ] = 0;
+    }
+
+    void add( unsigned int x0, unsigned int x1, unsigned int y, unsigned int z )
+    {
+        const unsigned int n = x1 - x0;
+        if( voxels == 0 )
+        {
+            min[ 0 ] = x0;
+            min[ 1 ] = y;
+            min[ 2 ] = z;
+            max[ 0 ] = x1 - 1;
+            max[ 1 ] = y;
+            max[ 2 ] = z;
+        }
+        else
+        {
+            min[ 0 ] = std::min( min[ 0 ], x0 );
+            min[ 1 ] = std::min( min[ 1 ], y );
+            min[ 2 ] = std::min( min[ 2 ], z );
+            max[ 0 ] = std::max( max[ 0 ], x1 - 1 );
+            max[ 1 ] = std::max( max[ 1 ], y );
+            max[ 2 ] = std::max( max[ 2 ], z );
+        }
+        voxels += n;
+
+        sum[ 0 ] += ( static_cast< double >( x0 ) + x1 - 1 ) * n / 2;
+        sum[ 1 ] += static_cast< double >( y ) * n;
+        sum[ 2 ] += static_cast< double >( z ) * n;
+    }
+};
+
+
+
+// ----------------------------------------------------------------------------------
+// ConnectedComponents
+// ----------------------------------------------------------------------------------
+
+ConnectedComponents::ConnectedComponents( const PackedMask& mask, FloodFill::Connectivity connectivity )
+    : size( mask.size )
+    , connectivity( connectivity )
+{
+    compute( mask );
+}
+
+
+ConnectedComponents::ConnectedComponents( const Carna::base::model::Volume& volume, int huv0, int huv1
+                                        , FloodFill::Connectivity connectivity )
+    : size( volume.size )
+    , connectivity( connectivity )
+{
+    compute( *HuvRangeMask::acquire( volume, huv0, huv1 ) );
+}
+
+
+ConnectedComponents::~ConnectedComponents()
+{
+}
+
+
+template< typename Mask >
+void ConnectedComponents::compute( const Mask& mask )
+{
+    CARNA_ASSERT( size.x <= std::numeric_limits< uint16_t >::max() );
+
+    const std::vector< ConnectedComponentsNeighborRow > neighborRows = getConnectedComponentsNeighborRows( connectivity );
+    const Slabs slabs( size.z );
+    std::vector< ConnectedComponentsSlab > slabData( slabs.count() );
+
+ // first pass: collect runs and unite them within each slab
+
+    slabs.process( [&]( unsigned int slab, unsigned int z0, unsigned int z1 )
+        {
+            ConnectedComponentsSlab& data = slabData[ slab ];
+            data.rowOffsets.reserve( ( z1 - z0 ) * size.y + 1 );
+
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                const unsigned int firstRun = data.runs.size();
+                data.rowOffsets.push_back( firstRun );
+
+                mask.visitSpans( y, z, [&]( unsigned int x0, unsigned int x1 )
+                    {
+                        ConnectedComponents::Run run;
+                        run.x0 = static_cast< uint16_t >( x0 );
+                        run.x1 = static_cast< uint16_t >( x1 );
+
+                        data.runs.push_back( run );
+                        data.parent.push_back( data.parent.size() );
+                    }
+                );
+
+                const unsigned int lastRun = data.runs.size();
+
+             // unite with the runs of already visited rows
+
+                for( auto neighbor = neighborRows.begin(); neighbor != neighborRows.end(); ++neighbor )
+                {
+                    const int ny = static_cast< int >( y ) + neighbor->dy;
+                    const int nz = static_cast< int >( z ) + neighbor->dz;
+                    if( ny < 0 || ny >= static_cast< int >( size.y ) || nz < static_cast< int >( z0 ) )
+                    {
+                        continue;
+                    }
+
+                    const unsigned int neighborRow = ( nz - z0 ) * size.y + ny;
+                    uniteConnectedComponentsRows
+                        ( data.parent, data.runs
+                        , firstRun, lastRun
+                        , data.rowOffsets[ neighborRow ], data.rowOffsets[ neighborRow + 1 ]
+                        , neighbor->widen );
+                }
+            }
+        }
+    );
+
+ // concatenate the slabs
+
+    std::size_t runsCount = 0;
+    for( unsigned int slab = 0; slab < slabs.count(); ++slab )
+    {
+        runsCount += slabData[ slab ].runs.size();
+    }
+
+    runs.reserve( runsCount );
+    rowOffsets.reserve( static_cast< std::size_t >( size.y ) * size.z + 1 );
+    std::vector< unsigned int >& parent = runLabels;
+    parent.reserve( runsCount );
+
+    for( unsigned int slab = 0; slab < slabs.count(); ++slab )
+    {
+        ConnectedComponentsSlab& data = slabData[ slab ];
+        const unsigned int offset = runs.size();
+
+        for( auto row = data.rowOffsets.begin(); row != data.rowOffsets.end(); ++row )
+        {
+            rowOffsets.push_back( offset + *row );
+        }
+        for( auto root = data.parent.begin(); root != data.parent.end(); ++root )
+        {
+            parent.push_back( offset + *root );
+        }
+        runs.insert( runs.end(), data.runs.begin(), data.runs.end() );
+
+        std::vector< ConnectedComponents::Run >().swap( data.runs );
+        std::vector< unsigned int >().swap( data.parent );
+    }
+    rowOffsets.push_back( runs.size() );
+
+ // second pass: unite runs across slab boundaries
+
+    for( unsigned int slab = 1; slab < slabs.count(); ++slab )
+    {
+        const unsigned int z = slabs.begin( slab );
+        for( unsigned int y = 0; y < size.y; ++y )
+        for( auto neighbor = neighborRows.begin(); neighbor != neighborRows.end(); ++neighbor )
+        {
+            const int ny = static_cast< int >( y ) + neighbor->dy;
+            if( neighbor->dz == 0 || ny < 0 || ny >= static_cast< int >( size.y ) )
+            {
+                continue;
+            }
+
+            const std::size_t row = static_cast< std::size_t >( z ) * size.y + y;
+            const std::size_t neighborRow = static_cast< std::size_t >( z - 1 ) * size.y + ny;
+            uniteConnectedComponentsRows
+                ( parent, runs
+                , rowOffsets[ row ], rowOffsets[ row + 1 ]
+                , rowOffsets[ neighborRow ], rowOffsets[ neighborRow + 1 ]
+                , neighbor->widen );
+        }
+    }
+
+ // replace the forest by provisional labels in place
+
+    /* Since 'parent[ i ] <= i', the parent of each run has already been replaced by
+     * its label when the run is processed.
+     */
+    unsigned int provisionalLabels = 0;
+    for( std::size_t i = 0; i < parent.size(); ++i )
+    {
+        parent[ i ] = parent[ i ] == i ? provisionalLabels++ : parent[ parent[ i ] ];
+    }
+    std::vector< ConnectedComponentsAccumulator > accumulators( provisionalLabels );
+
+ // gather the components' properties
+
+    for( unsigned int z = 0; z < size.z; ++z )
+    for( unsigned int y = 0; y < size.y; ++y )
+    {
+        const std::size_t row = static_cast< std::size_t >( z ) * size.y + y;
+        for( unsigned int i = rowOffsets[ row ]; i < rowOffsets[ row + 1 ]; ++i )
+        {
+            accumulators[ runLabels[ i ] ].add( runs[ i ].x0, runs[ i ].x1, y, z );
+        }
+    }
+
+ // order the components by decreasing size
+
+    std::vector< unsigned int > order( accumulators.size() );
+    for( unsigned int i = 0; i < order.size(); ++i )
+    {
+        order[ i ] = i;
+    }
+    std::stable_sort( order.begin(), order.end(),
+        [&accumulators]( unsigned int a, unsigned int b )->bool
+        {
+            return accumulators[ a ].voxels > accumulators[ b ].voxels;
+        }
+    );
+
+    std::vector< unsigned int > labels( accumulators.size() );
+    components.resize( accumulators.size() );
+    for( unsigned int rank = 0; rank < order.size(); ++rank )
+    {
+        const ConnectedComponentsAccumulator& accumulator = accumulators[ order[ rank ] ];
+        Component& component = components[ rank ];
+
+        component.voxels = accumulator.voxels;
+        component.min = Carna::base::Vector3ui( accumulator.min[ 0 ], accumulator.min[ 1 ], accumulator.min[ 2 ] );
+        component.max = Carna::base::Vector3ui( accumulator.max[ 0 ], accumulator.max[ 1 ], accumulator.max[ 2 ] );
+        component.centroid = Carna::base::Vector
+            ( accumulator.sum[ 0 ] / accumulator.voxels
+            , accumulator.sum[ 1 ] / accumulator.voxels
+            , accumulator.sum[ 2 ] / accumulator.voxels );
+
+        labels[ order[ rank ] ] = rank + 1;
+    }
+
+    const Slabs runSlabs( runLabels.size(), 1 << 16 );
+    runSlabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+        {
+            for( unsigned int i = first; i < last; ++i )
+            {
+                runLabels[ i ] = labels[ runLabels[ i ] ];
+            }
+        }
+    );
+}
+
+
+unsigned int ConnectedComponents::labelAt( unsigned int x, unsigned int y, unsigned int z ) const
+{
+    const std::size_t row = static_cast< std::size_t >( z ) * size.y + y;
+    const ConnectedComponents::Run* const first = runs.empty() ? nullptr : &runs.front() + rowOffsets[ row ];
+    const ConnectedComponents::Run* const last  = runs.empty() ? nullptr : &runs.front() + rowOffsets[ row + 1 ];
+
+    const ConnectedComponents::Run* const next = std::upper_bound( first, last, x,
+        []( unsigned int value, const ConnectedComponents::Run& run )->bool
+        {
+            return value < run.x0;
+        }
+    );
+
+    if( next != first && x < ( next - 1 )->x1 )
+    {
+        return runLabels[ next - 1 - &runs.front() ];
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+
+void ConnectedComponents::extract( unsigned int label, PackedMask& mask ) const
+{
+    CARNA_ASSERT( mask.size.x == size.x && mask.size.y == size.y && mask.size.z == size.z );
+
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                visitRuns( y, z, [&]( unsigned int x0, unsigned int x1, unsigned int runLabel )
+                    {
+                        if( runLabel == label )
+                        {
+                            mask.fill( y, z, x0, x1 );
+                        }
+                    }
+                );
+            }
+        }
+    );
+}
+
+
+PackedMask* ConnectedComponents::keepLargest( unsigned int n ) const
+{
+    std::unique_ptr< PackedMask > mask( new PackedMask( size ) );
+
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            PackedMask& out = *mask;
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                visitRuns( y, z, [&]( unsigned int x0, unsigned int x1, unsigned int label )
+                    {
+                        if( label <= n )
+                        {
+                            out.fill( y, z, x0, x1 );
+                        }
+                    }
+                );
+            }
+        }
+    );
+
+    return mask.release();
+}
+
+
+ScalarField3ui< unsigned int >* ConnectedComponents::createLabelVolume() const
+{
+    std::unique_ptr< ScalarField3ui< unsigned int > > labels( new ScalarField3ui< unsigned int >( size ) );
+
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            std::vector< unsigned int >& data = labels->getData();
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                const std::size_t row = ( static_cast< std::size_t >( z ) * size.y + y ) * size.x;
+                visitRuns( y, z, [&]( unsigned int x0, unsigned int x1, unsigned int label )
+                    {
+                        std::fill( data.begin() + ( row + x0 ), data.begin() + ( row + x1 ), label );
+                    }
+                );
+            }
+        }
+    );
+
+    return labels.release();
+}
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "FloodFill.h"
+#include "ScalarField3ui.h"
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/Transformation.h>
+#include <vector>
+#include <cstdint>
+
+class PackedMask;
+
+
+
+// ----------------------------------------------------------------------------------
+// ConnectedComponents
+// ----------------------------------------------------------------------------------
+
+/** \brief  Labels the connected components of some binary mask.
+  *
+  * Each row is decomposed into runs of set voxels. The volume is split into z-slabs
+  * which are processed concurrently: Runs are merged with the runs of neighboring
+  * rows within the same slab by union-find, afterwards the runs which touch across
+  * slab boundaries are merged.
+  *
+  * Labels are assigned in the order of decreasing component size, starting at 1. The
+  * label 0 denotes the background.
+  */
+class ConnectedComponents
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Describes a single component.
+      */
+    struct Component
+    {
+        /** \brief  Holds the number of voxels.
+          */
+        unsigned long voxels;
+
+        /** \brief  Holds the lower corner of the bounding box.
+          */
+        Carna::base::Vector3ui min;
+
+        /** \brief  Holds the upper corner of the bounding box, which is inclusive.
+          */
+        Carna::base::Vector3ui max;
+
+        /** \brief  Holds the centroid in voxel coordinates.
+          */
+        Carna::base::Vector centroid;
+    };
+
+
+    /** \brief  Defines the run of set voxels \f$[x_0, x_1)\f$ within some row.
+      */
+    struct Run
+    {
+        uint16_t x0, x1;
+    };
+
+
+    /** \brief  Labels the components of \a mask.
+      */
+    ConnectedComponents( const PackedMask& mask, FloodFill::Connectivity = FloodFill::vertices );
+
+    /** \brief  Labels the components of the voxels within \f$[\mathrm{huv}_0, \mathrm{huv}_1]\f$.
+      */
+    ConnectedComponents( const Carna::base::model::Volume& volume, int huv0, int huv1
+                       , FloodFill::Connectivity = FloodFill::vertices );
+
+    ~ConnectedComponents();
+
+
+    /** \brief  Holds the size of the labelled mask.
+      */
+    const Carna::base::Vector3ui size;
+
+    /** \brief  Holds the voxel neighborhood.
+      */
+    const FloodFill::Connectivity connectivity;
+
+
+    /** \brief  Tells the number of components.
+      */
+    unsigned int count() const
+    {
+        return components.size();
+    }
+
+    /** \brief  References the component with \a label.
+      */
+    const Component& component( unsigned int label ) const
+    {
+        return components[ label - 1 ];
+    }
+
+    /** \brief  Tells the label of the voxel \f$(x, y, z)\f$.
+      */
+    unsigned int labelAt( unsigned int x, unsigned int y, unsigned int z ) const;
+
+    /** \brief  Invokes \a visit with \f$(x_0, x_1, \mathrm{label})\f$ for each run of set
+      *         voxels within the row \f$(y, z)\f$, in ascending order.
+      */
+    template< typename RunVisitor >
+    void visitRuns( unsigned int y, unsigned int z, RunVisitor visit ) const
+    {
+        const std::size_t row = static_cast< std::size_t >( z ) * size.y + y;
+        for( unsigned int i = rowOffsets[ row ]; i < rowOffsets[ row + 1 ]; ++i )
+        {
+            visit( runs[ i ].x0, runs[ i ].x1, runLabels[ i ] );
+        }
+    }
+
+    /** \brief  Sets all voxels of the component with \a label within \a mask.
+      */
+    void extract( unsigned int label, PackedMask& mask ) const;
+
+    /** \brief  Creates a mask of the \a n largest components.
+      */
+    PackedMask* keepLargest( unsigned int n ) const;
+
+    /** \brief  Creates a volume which holds the label of each voxel.
+      */
+    ScalarField3ui< unsigned int >* createLabelVolume() const;
+
+
+private:
+
+    std::vector< Run > runs;
+
+    /** \brief  Maps the row \f$(y, z)\f$ to its first run at \f$z \cdot h + y\f$.
+      *
+      * Holds one additional element which marks the end of the last row.
+      */
+    std::vector< unsigned int > rowOffsets;
+
+    std::vector< unsigned int > runLabels;
+
+    std::vector< Component > components;
+
+    template< typename Mask >
+    void compute( const Mask& mask );
+
+}; // ConnectedComponents
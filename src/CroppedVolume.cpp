@@ -0,0 +1,118 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "glew.h"
+#include "CroppedVolume.h"
+#include "VolumeRows.h"
+#include "Slabs.h"
+#include <Carna/base/CarnaException.h>
+#include <cstring>
+
+
+
+// ----------------------------------------------------------------------------------
+// CroppedVolume
+// ----------------------------------------------------------------------------------
+
+CroppedVolume::CroppedVolume
+    ( Carna::base::Association< const Carna::base::model::Volume >* sourcePtr
+    , const Carna::base::Vector3ui& begin
+    , const Carna::base::Vector3ui& size )
+
+    : Volume( size )
+    , begin( begin )
+    , sourcePtr( sourcePtr )
+    , sourceRows( new VolumeRows( *sourcePtr->get() ) )
+{
+    CARNA_ASSERT( begin.x + size.x <= source().size.x );
+    CARNA_ASSERT( begin.y + size.y <= source().size.y );
+    CARNA_ASSERT( begin.z + size.z <= source().size.z );
+}
+
+
+CroppedVolume::~CroppedVolume()
+{
+}
+
+
+const Carna::base::model::Volume& CroppedVolume::source() const
+{
+    return *sourcePtr->get();
+}
+
+
+Carna::base::model::UInt16Volume* CroppedVolume::copy() const
+{
+    Carna::base::model::UInt16Volume* const result = new Carna::base::model::UInt16Volume( size );
+    if( size.x * size.y * size.z == 0 )
+    {
+        return result;
+    }
+
+    const VolumeRows rows( *this );
+    VolumeRows::Voxel* const target = &result->getBuffer().front();
+
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            std::vector< VolumeRows::Voxel > scratch;
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                std::memcpy
+                    ( target + ( y + static_cast< unsigned long >( z ) * size.y ) * size.x
+                    , rows.row( y, z, scratch )
+                    , size.x * sizeof( VolumeRows::Voxel ) );
+            }
+        }
+    );
+
+    return result;
+}
+
+
+void CroppedVolume::uploadTexture() const
+{
+    const VolumeRows rows( *this );
+    if( !rows.isRaw() || size.x * size.y * size.z == 0 )
+    {
+        const std::unique_ptr< Carna::base::model::UInt16Volume > buffer( copy() );
+        buffer->uploadTexture();
+        return;
+    }
+
+    /* Let OpenGL pick the rows from the source buffer.
+     */
+    std::vector< VolumeRows::Voxel > scratch;
+    glPushClientAttrib( GL_CLIENT_PIXEL_STORE_BIT );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 2 );
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, static_cast< GLint >( rows.rowDistance() ) );
+    glPixelStorei( GL_UNPACK_IMAGE_HEIGHT, static_cast< GLint >( rows.sliceDistance() / rows.rowDistance() ) );
+
+    glTexImage3D( GL_TEXTURE_3D, 0, GL_INTENSITY16, size.x, size.y, size.z, 0, GL_LUMINANCE, GL_UNSIGNED_SHORT, rows.row( 0, 0, scratch ) );
+
+    glPopClientAttrib();
+}
+
+
+signed short CroppedVolume::operator()( const Carna::base::Vector3ui& at ) const
+{
+    return ( *this )( at.x, at.y, at.z );
+}
+
+
+signed short CroppedVolume::operator()
+    ( unsigned int x
+    , unsigned int y
+    , unsigned int z ) const
+{
+    return VolumeRows::decode( sourceRows->voxel( begin.x + x, begin.y + y, begin.z + z ) );
+}
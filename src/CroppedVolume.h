@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/base/model/Volume.h>
+#include <Carna/Carna.h>
+#include <Carna/base/Association.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <memory>
+
+class VolumeRows;
+
+
+
+// ----------------------------------------------------------------------------------
+// CroppedVolume
+// ----------------------------------------------------------------------------------
+
+/** \brief  Exposes a box within some other volume without copying its voxels.
+  *
+  * If the source volume keeps its voxels in a \c UInt16Volume buffer, \ref VolumeRows
+  * references the rows of this volume within that buffer, using the strides of the
+  * source volume. The texture is uploaded from that buffer directly, too.
+  *
+  * The source volume is kept alive for as long as this volume exists, including
+  * the voxels outside of the box. If the association owns the whole model of the
+  * source volume, like the one which \ref VolumeNormalizer::getResult creates does,
+  * that model is kept alive, too. Use \ref copy to obtain a volume which does not
+  * depend on the source, so that the source can be released.
+  */
+class CroppedVolume : public Carna::base::model::Volume
+{
+
+public:
+
+    /** \brief  Exposes the box of \a size voxels, that starts at \a begin within the
+      *         volume referenced by \a source.
+      */
+    CroppedVolume
+        ( Carna::base::Association< const Carna::base::model::Volume >* source
+        , const Carna::base::Vector3ui& begin
+        , const Carna::base::Vector3ui& size );
+
+    virtual ~CroppedVolume();
+
+
+    /** \brief  References the source volume.
+      */
+    const Carna::base::model::Volume& source() const;
+
+    /** \brief  Holds the position of the first voxel within the source volume.
+      */
+    const Carna::base::Vector3ui begin;
+
+
+    /** \brief  Copies the exposed voxels to a new volume, one row at a time in parallel.
+      *
+      * The copy holds only the voxels within the box and does not reference the
+      * source volume, hence this volume and its source may be deleted afterwards.
+      * The caller takes the ownership of the copy.
+      */
+    Carna::base::model::UInt16Volume* copy() const;
+
+
+    virtual void uploadTexture() const override;
+
+    virtual signed short operator()
+        ( unsigned int x
+        , unsigned int y
+        , unsigned int z ) const override;
+
+    virtual signed short operator()( const Carna::base::Vector3ui& at ) const override;
+
+
+private:
+
+    const std::unique_ptr< Carna::base::Association< const Carna::base::model::Volume > > sourcePtr;
+
+    const std::unique_ptr< const VolumeRows > sourceRows;
+
+}; // CroppedVolume
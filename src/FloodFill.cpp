@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "FloodFill.h"
+#include "ConnectedComponents.h"
+#include "HuvRangeMask.h"
+#include "Slabs.h"
+#include <Carna/base/model/Volume.h>
+#include <algorithm>
+
+
+
+// ----------------------------------------------------------------------------------
+// FloodFill
+// ----------------------------------------------------------------------------------
+
+FloodFill::FloodFill( const Carna::base::model::Volume& volume, int huv0, int huv1, Connectivity connectivity )
+    : volume( volume )
+    , huv0( std::max( -1024, huv0 ) )
+    , huv1( std::min(  3071, huv1 ) )
+    , connectivity( connectivity )
+{
+}
+
+
+FloodFill::~FloodFill()
+{
+}
+
+
+unsigned long FloodFill::compute( const Carna::base::Vector3ui& seed, const SpanConsumer& consume ) const
+{
+    const Carna::base::Vector3ui& size = volume.size;
+    if( huv1 < huv0 || seed.x >= size.x || seed.y >= size.y || seed.z >= size.z )
+    {
+        return 0;
+    }
+
+    const std::shared_ptr< const HuvRangeMask > mask = HuvRangeMask::acquire( volume, huv0, huv1 );
+    if( !mask->test( seed.x, seed.y, seed.z ) )
+    {
+        return 0;
+    }
+
+    const ConnectedComponents components( *mask, connectivity );
+    const unsigned int label = components.labelAt( seed.x, seed.y, seed.z );
+
+ // report the region
+
+    const Slabs slabs( size.z );
+    std::vector< unsigned long > voxelCounts( slabs.count(), 0 );
+
+    slabs.process( [&]( unsigned int slab, unsigned int z0, unsigned int z1 )
+        {
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                components.visitRuns( y, z, [&]( unsigned int x0, unsigned int x1, unsigned int runLabel )
+                    {
+                        if( runLabel == label )
+                        {
+                            consume( y, z, x0, x1 );
+                            voxelCounts[ slab ] += x1 - x0;
+                        }
+                    }
+                );
+            }
+        }
+    );
+
+    unsigned long voxelCount = 0;
+    for( unsigned int slab = 0; slab < slabs.count(); ++slab )
+    {
+        voxelCount += voxelCounts[ slab ];
+    }
+    return voxelCount;
+}
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <functional>
+
+
+
+// ----------------------------------------------------------------------------------
+// FloodFill
+// ----------------------------------------------------------------------------------
+
+/** \brief  Computes the region of voxels within an HUV range which is connected to
+  *         some seed voxel.
+  *
+  * Labels the \ref ConnectedComponents of the shared \ref HuvRangeMask and reports the
+  * runs of the seed's component.
+  */
+class FloodFill
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Lists supported voxel neighborhoods.
+      */
+    enum Connectivity
+    {
+        faces = 6,          ///< \brief  Voxels which share a face are connected.
+        edges = 18,         ///< \brief  Voxels which share a face or an edge are connected.
+        vertices = 26       ///< \brief  Voxels which share a face, an edge or a vertex are connected.
+    };
+
+    /** \brief  Receives the span \f$[x_0, x_1)\f$ of the row \f$(y, z)\f$.
+      *
+      * Invoked concurrently, but never twice for the same row from different threads.
+      */
+    typedef std::function< void( unsigned int y, unsigned int z, unsigned int x0, unsigned int x1 ) > SpanConsumer;
+
+
+    /** \brief  Instantiates.
+      */
+    FloodFill( const Carna::base::model::Volume&, int huv0, int huv1, Connectivity = vertices );
+
+    ~FloodFill();
+
+
+    const Carna::base::model::Volume& volume;
+
+    const int huv0;
+
+    const int huv1;
+
+    const Connectivity connectivity;
+
+
+    /** \brief  Reports all spans which are connected to \a seed to \a consume.
+      *
+      * Reports nothing if the \a seed is not within the HUV range.
+      *
+      * \returns the number of voxels within the region.
+      */
+    unsigned long compute( const Carna::base::Vector3ui& seed, const SpanConsumer& consume ) const;
+
+}; // FloodFill
@@ -21,6 +21,7 @@
 #include <QComboBox>
 #include <QCheckBox>
 #include <QThread>
+#include <QApplication>
 #include <QFileDialog>
 #include <QFile>
 #include <QDataStream>
@@ -68,6 +69,8 @@ GulsunController::GulsunController
     , seedChooser( new Carna::base::qt::Object3DChooser( CarnaContextClient( server ).model() ) )
     , laSeedHUV( new QLabel() )
     , cbEdgeEvaluation( new QComboBox() )
+    , cbSampling( new QComboBox() )
+    , cbBrickCache( new QCheckBox( "Cache volume bricks" ) )
     , sbMinScale( new QDoubleSpinBox() )
     , sbMaxScale( new QDoubleSpinBox() )
     , sbScaleSamples( new QSpinBox() )
@@ -104,9 +107,11 @@ GulsunController::GulsunController
     , sbRadiusMultiplier( new QDoubleSpinBox() )
     , cbSmoothedRadiuses( new QCheckBox( "Smoothed Radiuses" ) )
     , selectedSeed( nullptr )
-    , graph( acceleration == nullptr
+    , sampler( new PyramidIntensitySampler( CarnaContextClient( server ).model(), acceleration == nullptr
                 ? static_cast< Differential::Sampler* >( new IntensitySampler( CarnaContextClient( server ).model() ) )
-                : static_cast< Differential::Sampler* >( new GpuIntensitySampler( *acceleration, CarnaContextClient( server ).scene() ) )
+                : static_cast< Differential::Sampler* >( new GpuIntensitySampler( *acceleration, CarnaContextClient( server ).scene() ) ) ) )
+    , bricks( nullptr )
+    , graph( sampler
             , CarnaContextClient( server ).model()
             , MedialnessGraph::Setup
                 ( 0.1       /* minimum scale */
@@ -249,6 +254,8 @@ GulsunController::GulsunController
     graphControl->addRow( "Seed HUV:", laSeedHUV );
     */
     graphControl->addRow( "Edge Evaluation:", cbEdgeEvaluation );
+    graphControl->addRow( "Sampling:", cbSampling );
+    graphControl->addRow( cbBrickCache );
     graphControl->addRow( "Minimum Medialness:", sbMinimumMedialness );
     graphControl->addRow( cbAllowMedialnessEarlyOut );
 
@@ -262,6 +269,19 @@ GulsunController::GulsunController
     cbEdgeEvaluation->addItems( edgeEvaluators );
     cbEdgeEvaluation->setCurrentIndex( graph.setup().edgeEvaluator );
 
+    QStringList samplingLevels;
+    samplingLevels << "Full Resolution" << "Preview (1/2)" << "Preview (1/4)" << "Preview (1/8)";
+
+    cbSampling->setInsertPolicy( QComboBox::NoInsert );
+    cbSampling->addItems( samplingLevels );
+    cbSampling->setCurrentIndex( sampler->level() );
+
+    /* The bricks replace the CPU sampler, which the GPU is used instead of if given.
+     */
+    cbBrickCache->setChecked( false );
+    cbBrickCache->setEnabled( acceleration == nullptr );
+    cbBrickCache->setToolTip( "Serves the voxels from a cache of bricks, which are prefetched along the frontier of the search." );
+
     sbMinimumMedialness->setMinimum( 0. );
     sbMinimumMedialness->setMaximum( 1. );
     sbMinimumMedialness->setSingleStep( 0.05 );
@@ -271,6 +291,8 @@ GulsunController::GulsunController
     cbAllowMedialnessEarlyOut->setChecked( graph.setup().allowMedialnessEarlyOut );
 
     connect( cbEdgeEvaluation, SIGNAL( currentIndexChanged( int ) ), this, SLOT( setup( int ) ) );
+    connect( cbSampling, SIGNAL( currentIndexChanged( int ) ), this, SLOT( setSamplingLevel( int ) ) );
+    connect( cbBrickCache, SIGNAL( toggled( bool ) ), this, SLOT( setBrickCache( bool ) ) );
     connect( sbMinimumMedialness, SIGNAL( editingFinished() ), this, SLOT( setup() ) );
     connect( cbAllowMedialnessEarlyOut, SIGNAL( clicked() ), this, SLOT( setup() ) );
 
@@ -461,6 +483,58 @@ void GulsunController::setup( int )
 }
 
 
+void GulsunController::setSamplingLevel( int level )
+{
+    /* The searches hold results of the previous level, which must not be mixed with
+     * the new one. Resetting them also ensures that no worker samples the graph
+     * while the level changes.
+     */
+    resetSearches();
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    sampler->setLevel( static_cast< unsigned int >( level ) );
+    updatePrefetching();
+    QApplication::restoreOverrideCursor();
+}
+
+
+void GulsunController::setBrickCache( bool enabled )
+{
+    /* The searches hold results of the previous sampler.
+     */
+    resetSearches();
+
+    const Carna::base::model::Scene& model = CarnaContextClient( server ).model();
+
+    graph.setPrefetchedBricks( nullptr );
+    bricks = enabled ? new BrickedIntensitySampler( model ) : nullptr;
+    sampler->setFullResolution( enabled
+        ? static_cast< Differential::Sampler* >( bricks )
+        : static_cast< Differential::Sampler* >( new IntensitySampler( model ) ) );
+
+    updatePrefetching();
+}
+
+
+void GulsunController::updatePrefetching()
+{
+    graph.setPrefetchedBricks( bricks != nullptr && sampler->level() == 0 ? &bricks->bricks() : nullptr );
+}
+
+
+void GulsunController::resetSearches()
+{
+    if( gulsun.get() != nullptr )
+    {
+        resetGulsun();
+    }
+    if( successiveMedialness.get() != nullptr )
+    {
+        resetSuccessiveMedialness();
+    }
+}
+
+
 void GulsunController::resetGulsun()
 {
     gulsun.reset();
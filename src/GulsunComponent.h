@@ -75,6 +75,10 @@ private:
 
     QComboBox* const cbEdgeEvaluation;
 
+    QComboBox* const cbSampling;
+
+    QCheckBox* const cbBrickCache;
+
     QPushButton* const buResetGulsun;
 
     QPushButton* const buResetSuccessiveMedialness;
@@ -147,6 +151,15 @@ private:
 
     Carna::base::model::Object3D* selectedSeed;
 
+    /** \brief  References the sampler of \ref graph, which is owned by the latter.
+      */
+    PyramidIntensitySampler* const sampler;
+
+    /** \brief  References the full-resolution sampler of \ref sampler if it caches
+      *         bricks, or is \c nullptr.
+      */
+    BrickedIntensitySampler* bricks;
+
     MedialnessGraph graph;
 
     std::unique_ptr< SuccessiveMedialness > successiveMedialness;
@@ -169,6 +182,16 @@ private:
 
     void updateGulsunStats();
 
+    /** \brief  Discards the results of both searches, e.g. before the sampling of
+      *         the graph changes.
+      */
+    void resetSearches();
+
+    /** \brief  Lets the graph prefetch from \ref bricks while they back the
+      *         sampled level.
+      */
+    void updatePrefetching();
+
  // ----------------------------------------------------------------------------------
 
 signals:
@@ -195,6 +218,10 @@ private slots:
 
     void setup( int = 0 );
 
+    void setSamplingLevel( int );
+
+    void setBrickCache( bool );
+
     void segment();
 
     void setCenterlinesVisibility( bool hide );
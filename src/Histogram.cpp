@@ -14,7 +14,6 @@
 #include "HistogramController.h"
 #include <QFrame>
 #include <QHBoxLayout>
-#include <QTimer>
 
 
 
@@ -45,5 +44,5 @@ Histogram::Histogram( Record::Server& server, ComponentWindowFactory& componentW
                   , ComponentWindowFactory::defaultDockableFeatures
                   | QDockWidget::DockWidgetFloatable );
 
-    QTimer::singleShot( 0, view, SLOT( setAutoZoom() ) );
+    QObject::connect( view, SIGNAL( histogramReady() ), view, SLOT( setAutoZoom() ) );
 }
@@ -86,6 +86,16 @@ HistogramController::HistogramController( HistogramView& view )
     connect( sbMaxHuv, SIGNAL(  valueChanged( int ) ),    &view, SLOT( setMaxHuv( int ) ) );
     connect(    &view, SIGNAL( maxHuvChanged( int ) ), sbMaxHuv, SLOT(  setValue( int ) ) );
 
+    QDoubleSpinBox* const sbPercentile = new QDoubleSpinBox();
+    sbPercentile->setMinimum( 0 );
+    sbPercentile->setMaximum( 49.9 );
+    sbPercentile->setDecimals( 1 );
+    sbPercentile->setSingleStep( 0.1 );
+    sbPercentile->setSuffix( " %" );
+    sbPercentile->setToolTip( "Fits the HUV range, so that this percentage of voxels lies below and above it." );
+
+    connect( sbPercentile, SIGNAL( valueChanged( double ) ), &view, SLOT( setPercentileHuvRange( double ) ) );
+
     auto createSpacerItem = []()->QSpacerItem*
     {
         return new QSpacerItem( 5, 5 );
@@ -103,6 +113,7 @@ HistogramController::HistogramController( HistogramView& view )
     form->addItem( createSpacerItem() );
     form->addRow( "Min. HUV:", sbMinHuv );
     form->addRow( "Max. HUV:", sbMaxHuv );
+    form->addRow( "Percentile Range:", sbPercentile );
 }
 
 
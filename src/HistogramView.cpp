@@ -11,6 +11,8 @@
 
 #include "HistogramView.h"
 #include "CarnaContextClient.h"
+#include "StatisticsClient.h"
+#include "VolumeStatistics.h"
 #include <Carna/base/model/Scene.h>
 #include <Carna/base/model/Volume.h>
 #include <Carna/base/CarnaException.h>
@@ -18,8 +20,11 @@
 #include <QProgressDialog>
 #include <QFontMetrics>
 #include <QApplication>
+#include <QMessageBox>
+#include <QtConcurrentRun>
 #include <cmath>
 #include <algorithm>
+#include <memory>
 #include <QTimer>
 
 
@@ -72,68 +77,92 @@ const static int offset_y = 40;
 
 HistogramView::HistogramView( Record::Server& server )
     : server( server )
-    , histogram( 4096 )
     , scale( logarithmic )
     , huv0( -1024 )
     , huv1(  3071 )
     , minClassSize( 1 )
     , minBarWidth( 2 )
     , zoom( 1 )
+    , histogram( nullptr )
     , initialized( false )
 {
     QTimer::singleShot( 0, this, SLOT( init() ) );
 }
 
 
-void HistogramView::init()
+HistogramView::~HistogramView()
 {
-    CARNA_ASSERT( !initialized );
-
-    const Carna::base::model::Volume& volume = CarnaContextClient( server ).model().volume();
-
-    QProgressDialog progress( "Building histogram...", "Abort", 0, volume.size.x - 1, this );
-    progress.setWindowModality( Qt::WindowModal );
-
-    for( unsigned int x = 0; x < volume.size.x; ++x )
+    if( histogramBuilder.isRunning() )
     {
-        QApplication::processEvents();
-        if( progress.wasCanceled() )
+        try
         {
-            std::for_each( histogram.begin(), histogram.end(), []( unsigned long& x ){ x = 0; } );
-            break;
+            histogramBuilder.waitForFinished();
         }
-
-        for( unsigned int y = 0; y < volume.size.y; ++y )
-        for( unsigned int z = 0; z < volume.size.z; ++z )
+        catch( ... )
         {
-            const unsigned short shifted_huv = volume( x, y, z ) + 1024;
-            ++histogram[ shifted_huv ];
         }
-
-        progress.setValue( x );
     }
+}
+
+
+unsigned long HistogramView::getSum() const
+{
+    return histogram == nullptr ? 0 : histogram->sum();
+}
 
-    progress.close();
 
-    sum = 0;
-    for( unsigned int i = 0; i < histogram.size(); ++i )
+void HistogramView::init()
+{
+    CARNA_ASSERT( !initialized );
+
+    connect( &histogramBuilder, SIGNAL( finished() ), this, SLOT( histogramBuilt() ) );
+
+    /* Waiting for the statistics service is done in the background.
+     */
+    const std::shared_ptr< const StatisticsClient > statisticsClient( new StatisticsClient( server ) );
+    std::function< std::shared_ptr< const VolumeStatistics >() > fetchStatistics = [statisticsClient]()->std::shared_ptr< const VolumeStatistics >
+    {
+        return statisticsClient->volumeStatistics();
+    };
+    histogramBuilder.setFuture( QtConcurrent::run( fetchStatistics ) );
+}
+
+
+void HistogramView::histogramBuilt()
+{
+    try
     {
-        sum += histogram[ i ];
+        statistics = histogramBuilder.result();
     }
-    if( sum == 0 )
+    catch( const QtConcurrent::UnhandledException& )
     {
+        QMessageBox::critical( this, "Histogram", "Failed building the histogram." );
         return;
     }
 
+    if( statistics->histogram().sum() == 0 )
+    {
+        return;
+    }
+    histogram = &statistics->histogram();
+
  // initialize
 
     this->initialized = true;
+    this->compute();
     this->update();
+
+    emit histogramReady();
 }
 
 
 void HistogramView::setAutoZoom()
 {
+    if( !initialized )
+    {
+        return;
+    }
+
     this->compute( true );
 
  // compute zoom
@@ -141,11 +170,7 @@ void HistogramView::setAutoZoom()
     unsigned long max_absolute_probability = 0;
     for( int min_huv = huv0; min_huv <= huv1 - signed( classSize ); min_huv += classSize )
     {
-        unsigned long absolute_probability = 0;
-        for( int huv = min_huv; huv < min_huv + signed( classSize ); ++huv )
-        {
-            absolute_probability += histogram[ huv + 1024 ];
-        }
+        const unsigned long absolute_probability = histogram->count( min_huv, min_huv + classSize - 1 );
         max_absolute_probability = std::max( max_absolute_probability, absolute_probability );
     }
 
@@ -165,13 +190,18 @@ void HistogramView::setAutoZoom()
 
 void HistogramView::setAutoHuvRange()
 {
+    if( !initialized )
+    {
+        return;
+    }
+
     const static double threshold = 1e-4;
 
  // adjust huv0
 
     for( huv0 = -1024; huv0 < 3071; ++huv0 )
     {
-        unsigned long absolute_probability = histogram[ huv0 + 1024 ];
+        const unsigned long absolute_probability = histogram->count( huv0 );
         const double relative_probability = absolute_probability / static_cast< double >( getSum() );
         if( relative_probability >= threshold )
         {
@@ -183,7 +213,7 @@ void HistogramView::setAutoHuvRange()
 
     for( huv1 = 3071; huv1 > huv0; --huv1 )
     {
-        unsigned long absolute_probability = histogram[ huv1 + 1024 ];
+        const unsigned long absolute_probability = histogram->count( huv1 );
         const double relative_probability = absolute_probability / static_cast< double >( getSum() );
         if( relative_probability >= threshold )
         {
@@ -203,6 +233,29 @@ void HistogramView::setAutoHuvRange()
 }
 
 
+void HistogramView::setPercentileHuvRange( double percentage )
+{
+    if( !initialized )
+    {
+        return;
+    }
+
+    const double fraction = std::min( std::max( percentage / 100, 0. ), 0.5 );
+    huv0 = histogram->percentile( fraction );
+    huv1 = std::max( huv0, histogram->percentile( 1 - fraction ) );
+
+ // emit notifier signals
+
+    emit minHuvChanged( huv0 );
+    emit maxHuvChanged( huv1 );
+
+ // re-compute parameters and post repaint event
+
+    this->compute();
+    this->update();
+}
+
+
 void HistogramView::setScale( const Scale& scale )
 {
     this->scale = scale;
@@ -338,17 +391,8 @@ void HistogramView::paintEvent( QPaintEvent* ev )
         const int huv_class_max = huv_class_min + classSize - 1;
 
      // compute absolute probability
-        
-        unsigned long absolute_probability = 0;
-        for( int huv = huv_class_min; huv <= huv_class_max; ++huv )
-        {
-            const unsigned short shifted_huv = huv + 1024;
-            if( shifted_huv >= histogram.size() )
-            {
-                break;
-            }
-            absolute_probability += histogram[ shifted_huv ];
-        }
+
+        const unsigned long absolute_probability = histogram->count( huv_class_min, huv_class_max );
 
      // compute relative probability
 
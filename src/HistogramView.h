@@ -13,9 +13,13 @@
 
 #include "Server.h"
 #include <QWidget>
+#include <QFutureWatcher>
 #include <functional>
+#include <memory>
 
 class QPaintEvent;
+class VolumeHistogram;
+class VolumeStatistics;
 
 
 
@@ -41,9 +45,16 @@ class HistogramView : public QWidget
 public:
 
     /** \brief  Instantiates.
+      *
+      * The histogram is taken from the \ref Statistics service, which computes it in
+      * the background. The view stays empty until \ref histogramReady is emitted.
       */
     HistogramView( Record::Server& server );
 
+    /** \brief  Waits for the histogram to be taken, if it still is.
+      */
+    virtual ~HistogramView();
+
 
     /** \brief	Defines \f$\mathbb R \to \mathbb R\f$ scale function.
       */
@@ -66,10 +77,7 @@ public:
 
     /** \brief	Tells \f$\sum\limits_{x,y,z} \mathrm{huv}(x,y,z)\f$
       */
-    unsigned long getSum() const
-    {
-        return sum;
-    }
+    unsigned long getSum() const;
 
     /** \brief	Tells the configured minimal class size.
       *
@@ -169,11 +177,20 @@ public slots:
 
     void setAutoHuvRange();
 
+    /** \brief  Sets the shown HUV range, so that the given \a percentage of voxels lies
+      *         below and above it, respectively.
+      */
+    void setPercentileHuvRange( double percentage );
+
     void setAutoZoom();
 
 
 signals:
 
+    /** \brief  Emitted once the histogram is available.
+      */
+    void histogramReady();
+
     void parametersChanged();
 
     void minHuvChanged( int );
@@ -194,12 +211,18 @@ private:
 
     Record::Server& server;
 
-    std::vector< unsigned long > histogram;
+    /** \brief  Holds the statistics which the \ref histogram belongs to.
+      */
+    std::shared_ptr< const VolumeStatistics > statistics;
 
-    unsigned long sum;
+    /** \brief  References the histogram once it is available.
+      */
+    const VolumeHistogram* histogram;
 
     bool initialized;
 
+    QFutureWatcher< std::shared_ptr< const VolumeStatistics > > histogramBuilder;
+
 
     Scale scale;
 
@@ -229,4 +252,8 @@ private slots:
 
     void init();
 
+    /** \brief  Takes the histogram from the \ref histogramBuilder.
+      */
+    void histogramBuilt();
+
 }; // HistogramView
@@ -0,0 +1,186 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "HuvRangeMask.h"
+#include "VolumeRows.h"
+#include "Slabs.h"
+#include "Simd.h"
+#include <Carna/base/model/Volume.h>
+#include <QMutex>
+#include <algorithm>
+#include <map>
+
+
+
+// ----------------------------------------------------------------------------------
+// HuvRangeMaskCacheKey
+// ----------------------------------------------------------------------------------
+
+struct HuvRangeMaskCacheKey
+{
+    const Carna::base::model::Volume* volume;
+    int huv0;
+    int huv1;
+
+    bool operator<( const HuvRangeMaskCacheKey& other ) const
+    {
+        if( volume != other.volume )
+        {
+            return volume < other.volume;
+        }
+        if( huv0 != other.huv0 )
+        {
+            return huv0 < other.huv0;
+        }
+        return huv1 < other.huv1;
+    }
+};
+
+
+static QMutex huvRangeMaskCacheLock;
+
+static std::map< HuvRangeMaskCacheKey, std::weak_ptr< const HuvRangeMask > > huvRangeMaskCache;
+
+
+
+// ----------------------------------------------------------------------------------
+// HuvRangeMask
+// ----------------------------------------------------------------------------------
+
+HuvRangeMask::HuvRangeMask( const Carna::base::model::Volume& volume, int huv0, int huv1 )
+    : PackedMask( volume.size )
+    , huv0( std::max( -1024, huv0 ) )
+    , huv1( std::min(  3071, huv1 ) )
+{
+    compute( volume, Carna::base::Vector3ui( 0, 0, 0 ), volume.size );
+}
+
+
+HuvRangeMask::HuvRangeMask( const Carna::base::model::Volume& volume, int huv0, int huv1
+                          , const Carna::base::Vector3ui& roiBegin
+                          , const Carna::base::Vector3ui& roiEnd )
+    : PackedMask( volume.size )
+    , huv0( std::max( -1024, huv0 ) )
+    , huv1( std::min(  3071, huv1 ) )
+{
+    compute( volume, roiBegin, roiEnd );
+}
+
+
+std::shared_ptr< const HuvRangeMask > HuvRangeMask::acquire( const Carna::base::model::Volume& volume, int huv0, int huv1 )
+{
+    HuvRangeMaskCacheKey key;
+    key.volume = &volume;
+    key.huv0 = std::max( -1024, huv0 );
+    key.huv1 = std::min(  3071, huv1 );
+
+    QMutexLocker lock( &huvRangeMaskCacheLock );
+
+    /* Drop expired entries, so that masks of closed volumes are not matched by
+     * volumes which are allocated at the same address later on.
+     */
+    for( auto entry = huvRangeMaskCache.begin(); entry != huvRangeMaskCache.end(); )
+    {
+        if( entry->second.expired() )
+        {
+            huvRangeMaskCache.erase( entry++ );
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+
+    std::shared_ptr< const HuvRangeMask > mask = huvRangeMaskCache[ key ].lock();
+    if( !mask.get() )
+    {
+        mask.reset( new HuvRangeMask( volume, key.huv0, key.huv1 ) );
+        huvRangeMaskCache[ key ] = mask;
+    }
+    return mask;
+}
+
+
+void HuvRangeMask::compute( const Carna::base::model::Volume& volume
+                          , const Carna::base::Vector3ui& roiBegin
+                          , const Carna::base::Vector3ui& roiEndRequested )
+{
+    const Carna::base::Vector3ui roiEnd
+        ( std::min( roiEndRequested.x, size.x )
+        , std::min( roiEndRequested.y, size.y )
+        , std::min( roiEndRequested.z, size.z ) );
+
+    if( huv1 < huv0 || roiBegin.x >= roiEnd.x || roiBegin.y >= roiEnd.y || roiBegin.z >= roiEnd.z )
+    {
+        return;
+    }
+
+    const VolumeRows rows( volume );
+    const Slabs slabs( roiEnd.z - roiBegin.z );
+
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            std::vector< VolumeRows::Voxel > scratch;
+
+#ifdef DICOMVIEWER_SSE2
+            const __m128i offset = _mm_set1_epi16( 1024 );
+            const __m128i lower  = _mm_set1_epi16( static_cast< short >( huv0 - 1 ) );
+            const __m128i upper  = _mm_set1_epi16( static_cast< short >( huv1 + 1 ) );
+#endif
+
+            for( unsigned int z = roiBegin.z + z0; z < roiBegin.z + z1; ++z )
+            for( unsigned int y = roiBegin.y; y < roiEnd.y; ++y )
+            {
+                const VolumeRows::Voxel* const voxels = rows.row( y, z, scratch );
+                Word* const bits = row( y, z );
+                unsigned int x = roiBegin.x;
+
+#ifdef DICOMVIEWER_SSE2
+
+             // decode and compare 16 voxels at once
+
+                for( ; x + 16 <= roiEnd.x; x += 16 )
+                {
+                    __m128i v0 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( voxels + x ) );
+                    __m128i v1 = _mm_loadu_si128( reinterpret_cast< const __m128i* >( voxels + x + 8 ) );
+
+                    v0 = _mm_sub_epi16( _mm_srli_epi16( v0, 4 ), offset );
+                    v1 = _mm_sub_epi16( _mm_srli_epi16( v1, 4 ), offset );
+
+                    const __m128i m0 = _mm_and_si128( _mm_cmpgt_epi16( v0, lower ), _mm_cmplt_epi16( v0, upper ) );
+                    const __m128i m1 = _mm_and_si128( _mm_cmpgt_epi16( v1, lower ), _mm_cmplt_epi16( v1, upper ) );
+
+                    const Word chunk = static_cast< unsigned int >( _mm_movemask_epi8( _mm_packs_epi16( m0, m1 ) ) );
+                    if( chunk != 0 )
+                    {
+                        const unsigned int shift = x % WORD_BITS;
+                        bits[ x / WORD_BITS ] |= chunk << shift;
+                        if( shift > WORD_BITS - 16 )
+                        {
+                            bits[ x / WORD_BITS + 1 ] |= chunk >> ( WORD_BITS - shift );
+                        }
+                    }
+                }
+
+#endif
+
+                for( ; x < roiEnd.x; ++x )
+                {
+                    const signed short huv = VolumeRows::decode( voxels[ x ] );
+                    if( huv0 <= huv && huv <= huv1 )
+                    {
+                        bits[ x / WORD_BITS ] |= Word( 1 ) << ( x % WORD_BITS );
+                    }
+                }
+            }
+        }
+    );
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "PackedMask.h"
+#include <Carna/Carna.h>
+#include <memory>
+
+
+
+// ----------------------------------------------------------------------------------
+// HuvRangeMask
+// ----------------------------------------------------------------------------------
+
+/** \brief  Packed mask of those voxels whose HUV lie within \f$[\mathrm{huv}_0, \mathrm{huv}_1]\f$.
+  *
+  * The mask is computed in a single pass over the volume, which is parallelized across
+  * z-slabs. Rows of \c UInt16Volume buffers are decoded and compared with SSE2
+  * intrinsics 16 voxels at a time, if available.
+  *
+  * Masks which are shared through \ref acquire are computed only once per volume and
+  * range, as long as any of them is referenced.
+  */
+class HuvRangeMask : public PackedMask
+{
+
+public:
+
+    /** \brief  Computes the mask for the whole \a volume.
+      */
+    HuvRangeMask( const Carna::base::model::Volume& volume, int huv0, int huv1 );
+
+    /** \brief  Computes the mask for the region \f$[\mathrm{roiBegin}, \mathrm{roiEnd})\f$ of
+      *         \a volume. Voxels outside the region are not set.
+      */
+    HuvRangeMask( const Carna::base::model::Volume& volume, int huv0, int huv1
+                , const Carna::base::Vector3ui& roiBegin
+                , const Carna::base::Vector3ui& roiEnd );
+
+
+    /** \brief  Holds the lower bound of the HUV range.
+      */
+    const int huv0;
+
+    /** \brief  Holds the upper bound of the HUV range.
+      */
+    const int huv1;
+
+
+    /** \brief  Returns the mask for the whole \a volume which is shared with all other
+      *         callers that request the same \a volume and range.
+      *
+      * The volume must not be modified while the returned mask is referenced.
+      */
+    static std::shared_ptr< const HuvRangeMask > acquire( const Carna::base::model::Volume& volume, int huv0, int huv1 );
+
+
+private:
+
+    void compute( const Carna::base::model::Volume& volume
+                , const Carna::base::Vector3ui& roiBegin
+                , const Carna::base::Vector3ui& roiEnd );
+
+}; // HuvRangeMask
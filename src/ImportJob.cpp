@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "ImportJob.h"
+#include "VolumeStatistics.h"
+#include <Carna/base/model/Scene.h>
+#include <Carna/base/model/Volume.h>
+#include <stdexcept>
+
+
+
+// ----------------------------------------------------------------------------------
+// ImportJob
+// ----------------------------------------------------------------------------------
+
+ImportJob::ImportJob( const QString& description, double spacingX, double spacingY, double spacingZ )
+    : description( description )
+    , spacingX( spacingX )
+    , spacingY( spacingY )
+    , spacingZ( spacingZ )
+    , hasVoidThreshold( false )
+    , voidThreshold( 0 )
+{
+}
+
+
+ImportJob::~ImportJob()
+{
+    cancelAndWait();
+}
+
+
+void ImportJob::process()
+{
+    try
+    {
+        volume.reset( load() );
+        if( volume.get() != nullptr && !hasVoidThreshold )
+        {
+            /* The statistics are kept until the scene is handed out, so that the
+             * statistics service of the scene picks them up instead of scanning
+             * the volume again.
+             */
+            statistics = VolumeStatistics::acquire( *volume );
+            setVoidThreshold( statistics->voidThreshold() );
+        }
+    }
+    catch( const std::exception& ex )
+    {
+        volume.reset();
+        error = QString::fromStdString( ex.what() );
+    }
+    catch( ... )
+    {
+        volume.reset();
+        error = "Unknown error.";
+    }
+}
+
+
+void ImportJob::setVoidThreshold( int huv )
+{
+    voidThreshold = huv;
+    hasVoidThreshold = true;
+}
+
+
+void ImportJob::finish()
+{
+    if( !error.isEmpty() )
+    {
+        emit failed( error );
+    }
+    else
+    if( volume.get() == nullptr || isCanceled() )
+    {
+        statistics.reset();
+        volume.reset();
+        emit canceled();
+    }
+    else
+    {
+        Carna::base::model::Scene* const model = new Carna::base::model::Scene
+            ( new Carna::base::Composition< Carna::base::model::Volume >( volume.release() )
+            , spacingX
+            , spacingY
+            , spacingZ );
+
+        model->setRecommendedVoidThreshold( voidThreshold );
+
+        emit finished( model );
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "BackgroundJob.h"
+#include <Carna/Carna.h>
+#include <QString>
+#include <memory>
+
+class VolumeStatistics;
+
+
+
+// ----------------------------------------------------------------------------------
+// ImportJob
+// ----------------------------------------------------------------------------------
+
+/** \brief  Loads some volume in the background and creates a scene from it.
+  *
+  * \ref load is invoked on a worker thread once \ref start is called. The scene is
+  * created on the thread which the job belongs to, i.e. the GUI thread, and handed
+  * out through \ref finished. Exactly one of \ref finished, \ref failed and
+  * \ref canceled is emitted, after which the job deletes itself.
+  */
+class ImportJob : public BackgroundJob
+{
+
+    Q_OBJECT
+
+public:
+
+    /** \brief  Instantiates a job which produces a scene with the given spacings.
+      */
+    ImportJob( const QString& description, double spacingX, double spacingY, double spacingZ );
+
+    /** \brief  Waits until the worker has finished.
+      *
+      * The worker runs \ref load of the derived class, whose members are gone by
+      * the time this destructor runs. Hence a running job must be stopped through
+      * \ref cancelAndWait before it is deleted.
+      */
+    virtual ~ImportJob();
+
+
+    /** \brief  Describes what is loaded, e.g. for a progress dialog.
+      */
+    const QString description;
+
+
+signals:
+
+    /** \brief  Hands out the created scene.
+      */
+    void finished( Carna::base::model::Scene* );
+
+    /** \brief  Tells that loading failed with \a message.
+      */
+    void failed( const QString& message );
+
+    /** \brief  Tells that the job was canceled.
+      */
+    void canceled();
+
+
+protected:
+
+    /** \brief  Loads the volume, or returns \c nullptr if the job was canceled.
+      *
+      * Invoked on a worker thread. Exceptions are reported through \ref failed.
+      */
+    virtual Carna::base::model::Volume* load() = 0;
+
+    /** \brief  Sets the recommended void threshold of the scene, which is taken
+      *         from the \ref VolumeStatistics of the volume otherwise.
+      */
+    void setVoidThreshold( int huv );
+
+
+private:
+
+    const double spacingX;
+
+    const double spacingY;
+
+    const double spacingZ;
+
+    bool hasVoidThreshold;
+
+    int voidThreshold;
+
+    std::unique_ptr< Carna::base::model::Volume > volume;
+
+    std::shared_ptr< const VolumeStatistics > statistics;
+
+    QString error;
+
+    /** \brief  Invokes \ref load and acquires the statistics of the loaded volume.
+      */
+    virtual void process() override;
+
+    /** \brief  Creates the scene.
+      */
+    virtual void finish() override;
+
+}; // ImportJob
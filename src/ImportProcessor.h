@@ -16,6 +16,7 @@
 #include <string>
 
 class Importer;
+class ImportJob;
 
 
 
@@ -45,6 +46,9 @@ public:
     virtual const std::string& pattern() = 0;
 
 
-    virtual Carna::base::model::Scene* doImport( Importer& ) = 0;
+    /** \brief  Prompts for settings and validates the file, then returns the job
+      *         which loads the volume, or \c nullptr if the import was aborted.
+      */
+    virtual ImportJob* doImport( Importer& ) = 0;
     
 }; // ImportProcessor
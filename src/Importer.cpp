@@ -72,7 +72,7 @@ QStringList Importer::getFilters() const
 }
 
 
-Carna::base::model::Scene* Importer::run()
+ImportJob* Importer::run()
 {
     if( processors.empty() )
     {
@@ -108,7 +108,7 @@ Carna::base::model::Scene* Importer::run()
         rx.setPatternSyntax( QRegExp::Wildcard );
         if( rx.exactMatch( fileName ) )
         {
-            return processor.doImport( *this );;
+            return processor.doImport( *this );
         }
     }
 
@@ -18,6 +18,7 @@
 #include <set>
 
 class ImportProcessor;
+class ImportJob;
 
 class QStringList;
 
@@ -50,7 +51,13 @@ public:
 
     void install( ImportProcessor* );
 
-    Carna::base::model::Scene* run();
+    /** \brief  Prepares the import of the \ref file, which is prompted from the user
+      *         if none is set.
+      *
+      * \returns The job which still has to be \ref ImportJob::start "started", or
+      *          \c nullptr if the import was aborted.
+      */
+    ImportJob* run();
 
 
     QFile& file()
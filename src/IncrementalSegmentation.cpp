@@ -0,0 +1,353 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "IncrementalSegmentation.h"
+#include <Carna/base/model/Volume.h>
+#include <Carna/base/CarnaException.h>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+
+
+// ----------------------------------------------------------------------------------
+// IncrementalSegmentation
+// ----------------------------------------------------------------------------------
+
+IncrementalSegmentation::IncrementalSegmentation( const Carna::base::model::Volume& volume
+                                                , const Carna::base::Vector3ui& seed
+                                                , FloodFill::Connectivity connectivity )
+    : seed( seed )
+    , connectivity( connectivity )
+    , rows( volume )
+    , currentHuv0( 1 )
+    , currentHuv1( 0 )
+    , currentRegion( volume.size )
+    , voxels( 0 )
+    , frontier( volume.size )
+    , buckets( 4096 )
+    , reached( volume.size )
+{
+    CARNA_ASSERT( static_cast< double >( volume.size.x ) * volume.size.y * volume.size.z
+               <= std::numeric_limits< uint32_t >::max() );
+
+    CARNA_ASSERT( seed.x < volume.size.x && seed.y < volume.size.y && seed.z < volume.size.z );
+
+    for( int dz = -1; dz <= 1; ++dz )
+    for( int dy = -1; dy <= 1; ++dy )
+    for( int dx = -1; dx <= 1; ++dx )
+    {
+        const int distance = std::abs( dx ) + std::abs( dy ) + std::abs( dz );
+        if( distance == 0
+            || ( connectivity == FloodFill::faces && distance > 1 )
+            || ( connectivity == FloodFill::edges && distance > 2 ) )
+        {
+            continue;
+        }
+
+        const Neighbor neighbor = { dx, dy, dz };
+        neighbors.push_back( neighbor );
+    }
+
+    reset();
+}
+
+
+IncrementalSegmentation::~IncrementalSegmentation()
+{
+}
+
+
+signed short IncrementalSegmentation::huvAt( uint32_t voxel ) const
+{
+    unsigned int x, y, z;
+    decode( voxel, x, y, z );
+    return VolumeRows::decode( rows.voxel( x, y, z ) );
+}
+
+
+void IncrementalSegmentation::decode( uint32_t voxel, unsigned int& x, unsigned int& y, unsigned int& z ) const
+{
+    x = voxel % rows.size.x;
+    voxel /= rows.size.x;
+    y = voxel % rows.size.y;
+    z = voxel / rows.size.y;
+}
+
+
+uint32_t IncrementalSegmentation::encode( unsigned int x, unsigned int y, unsigned int z ) const
+{
+    return x + rows.size.x * ( y + rows.size.y * z );
+}
+
+
+void IncrementalSegmentation::extendBounds( unsigned int x, unsigned int y, unsigned int z )
+{
+    regionMin.x = std::min( regionMin.x, x );
+    regionMin.y = std::min( regionMin.y, y );
+    regionMin.z = std::min( regionMin.z, z );
+    regionMax.x = std::max( regionMax.x, x );
+    regionMax.y = std::max( regionMax.y, y );
+    regionMax.z = std::max( regionMax.z, z );
+}
+
+
+void IncrementalSegmentation::clearBounds()
+{
+    const unsigned int none = std::numeric_limits< unsigned int >::max();
+    regionMin = Carna::base::Vector3ui( none, none, none );
+    regionMax = Carna::base::Vector3ui( 0, 0, 0 );
+}
+
+
+bool IncrementalSegmentation::bounds( Carna::base::Vector3ui& min, Carna::base::Vector3ui& max ) const
+{
+    if( voxels == 0 )
+    {
+        return false;
+    }
+
+    min = regionMin;
+    max = regionMax;
+    return true;
+}
+
+
+void IncrementalSegmentation::update( int huv0, int huv1 )
+{
+    huv0 = std::max( -1024, huv0 );
+    huv1 = std::min(  3071, huv1 );
+
+    const bool wasEmpty = currentHuv0 > currentHuv1;
+    const int commonHuv0 = std::max( huv0, currentHuv0 );
+    const int commonHuv1 = std::min( huv1, currentHuv1 );
+
+    if( huv0 > huv1 )
+    {
+        reset();
+    }
+    else
+    if( wasEmpty || commonHuv0 > commonHuv1 )
+    {
+        reset();
+        currentHuv0 = huv0;
+        currentHuv1 = huv1;
+        admit( huv0, huv1 );
+    }
+    else
+    {
+     // narrow to the common range first
+
+        if( commonHuv0 != currentHuv0 || commonHuv1 != currentHuv1 )
+        {
+            shrink( commonHuv0, commonHuv1 );
+        }
+
+     // widen afterwards
+
+        currentHuv0 = huv0;
+        currentHuv1 = huv1;
+        if( huv0 < commonHuv0 )
+        {
+            admit( huv0, commonHuv0 - 1 );
+        }
+        if( huv1 > commonHuv1 )
+        {
+            admit( commonHuv1 + 1, huv1 );
+        }
+    }
+
+    currentHuv0 = huv0;
+    currentHuv1 = huv1;
+    grow();
+}
+
+
+void IncrementalSegmentation::reset()
+{
+    std::fill( currentRegion.words().begin(), currentRegion.words().end(), 0 );
+    voxels = 0;
+    clearBounds();
+
+    clearFrontier();
+    enqueueFrontier( encode( seed.x, seed.y, seed.z ) );
+
+    currentHuv0 = 1;
+    currentHuv1 = 0;
+}
+
+
+void IncrementalSegmentation::clearFrontier()
+{
+    unsigned int x, y, z;
+    for( auto bucket = buckets.begin(); bucket != buckets.end(); ++bucket )
+    {
+        for( auto voxel = bucket->begin(); voxel != bucket->end(); ++voxel )
+        {
+            decode( *voxel, x, y, z );
+            frontier.set( x, y, z, false );
+        }
+        std::vector< uint32_t >().swap( *bucket );
+    }
+}
+
+
+void IncrementalSegmentation::enqueueFrontier( uint32_t voxel )
+{
+    unsigned int x, y, z;
+    decode( voxel, x, y, z );
+    if( !frontier.test( x, y, z ) )
+    {
+        frontier.set( x, y, z );
+        buckets[ huvAt( voxel ) + 1024 ].push_back( voxel );
+    }
+}
+
+
+void IncrementalSegmentation::admit( int huv0, int huv1 )
+{
+    unsigned int x, y, z;
+    for( int huv = huv0; huv <= huv1; ++huv )
+    {
+        std::vector< uint32_t >& bucket = buckets[ huv + 1024 ];
+        for( auto voxel = bucket.begin(); voxel != bucket.end(); ++voxel )
+        {
+            decode( *voxel, x, y, z );
+            frontier.set( x, y, z, false );
+            if( !currentRegion.test( x, y, z ) )
+            {
+                currentRegion.set( x, y, z );
+                ++voxels;
+                extendBounds( x, y, z );
+                pending.push_back( *voxel );
+            }
+        }
+        std::vector< uint32_t >().swap( bucket );
+    }
+}
+
+
+void IncrementalSegmentation::grow()
+{
+    const Carna::base::Vector3ui& size = rows.size;
+    unsigned int x, y, z;
+    while( !pending.empty() )
+    {
+        decode( pending.back(), x, y, z );
+        pending.pop_back();
+
+        for( auto neighbor = neighbors.begin(); neighbor != neighbors.end(); ++neighbor )
+        {
+            const unsigned int nx = x + neighbor->dx;
+            const unsigned int ny = y + neighbor->dy;
+            const unsigned int nz = z + neighbor->dz;
+
+            /* Negative coordinates wrap around and are caught by the upper bounds.
+             */
+            if( nx >= size.x || ny >= size.y || nz >= size.z || currentRegion.test( nx, ny, nz ) )
+            {
+                continue;
+            }
+
+            const uint32_t next = encode( nx, ny, nz );
+            const signed short huv = VolumeRows::decode( rows.voxel( nx, ny, nz ) );
+            if( currentHuv0 <= huv && huv <= currentHuv1 )
+            {
+                currentRegion.set( nx, ny, nz );
+                ++voxels;
+                extendBounds( nx, ny, nz );
+                pending.push_back( next );
+            }
+            else
+            {
+                enqueueFrontier( next );
+            }
+        }
+    }
+}
+
+
+void IncrementalSegmentation::shrink( int huv0, int huv1 )
+{
+    const Carna::base::Vector3ui& size = rows.size;
+
+    const signed short seedHuv = VolumeRows::decode( rows.voxel( seed.x, seed.y, seed.z ) );
+    if( seedHuv < huv0 || seedHuv > huv1 )
+    {
+        reset();
+        return;
+    }
+
+ // re-grow the region from the seed, but within the previous region only
+
+    /* The bounding box is rebuilt from the remaining voxels, which are visited
+     * anyway.
+     */
+    std::vector< uint32_t > region;
+    region.reserve( voxels );
+    region.push_back( encode( seed.x, seed.y, seed.z ) );
+    reached.set( seed.x, seed.y, seed.z );
+    clearBounds();
+    extendBounds( seed.x, seed.y, seed.z );
+
+    unsigned int x, y, z;
+    for( std::size_t i = 0; i < region.size(); ++i )
+    {
+        decode( region[ i ], x, y, z );
+        for( auto neighbor = neighbors.begin(); neighbor != neighbors.end(); ++neighbor )
+        {
+            const unsigned int nx = x + neighbor->dx;
+            const unsigned int ny = y + neighbor->dy;
+            const unsigned int nz = z + neighbor->dz;
+
+            if( nx >= size.x || ny >= size.y || nz >= size.z
+                || !currentRegion.test( nx, ny, nz )
+                ||  reached.test( nx, ny, nz ) )
+            {
+                continue;
+            }
+
+            const signed short huv = VolumeRows::decode( rows.voxel( nx, ny, nz ) );
+            if( huv0 <= huv && huv <= huv1 )
+            {
+                reached.set( nx, ny, nz );
+                region.push_back( encode( nx, ny, nz ) );
+                extendBounds( nx, ny, nz );
+            }
+        }
+    }
+
+    currentRegion.words().swap( reached.words() );
+    std::fill( reached.words().begin(), reached.words().end(), 0 );
+    voxels = region.size();
+
+    currentHuv0 = huv0;
+    currentHuv1 = huv1;
+
+ // rebuild the frontier
+
+    clearFrontier();
+    for( auto voxel = region.begin(); voxel != region.end(); ++voxel )
+    {
+        decode( *voxel, x, y, z );
+        for( auto neighbor = neighbors.begin(); neighbor != neighbors.end(); ++neighbor )
+        {
+            const unsigned int nx = x + neighbor->dx;
+            const unsigned int ny = y + neighbor->dy;
+            const unsigned int nz = z + neighbor->dz;
+
+            if( nx < size.x && ny < size.y && nz < size.z && !currentRegion.test( nx, ny, nz ) )
+            {
+                enqueueFrontier( encode( nx, ny, nz ) );
+            }
+        }
+    }
+}
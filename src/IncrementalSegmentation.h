@@ -0,0 +1,198 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "FloodFill.h"
+#include "PackedMask.h"
+#include "VolumeRows.h"
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <vector>
+#include <cstdint>
+
+
+
+// ----------------------------------------------------------------------------------
+// IncrementalSegmentation
+// ----------------------------------------------------------------------------------
+
+/** \brief  Maintains the region of voxels within an HUV range which is connected to
+  *         some seed, while the range is changed repeatedly.
+  *
+  * Besides the region, the session keeps its frontier: the voxels which are adjacent
+  * to the region but lie outside the current range, bucketed by their HUV.
+  *
+  * - When the range is widened, the buckets of the newly admitted HUV are drained and
+  *   the region grows from these voxels only. This takes time proportional to the
+  *   number of added voxels.
+  * - When the range is narrowed, the region is re-grown from the seed within the
+  *   previous region only. This takes time proportional to the previous region's
+  *   size, rather than to the size of the volume.
+  *
+  * Changes which narrow one bound and widen the other are done in this order.
+  */
+class IncrementalSegmentation
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Instantiates with an empty HUV range.
+      */
+    IncrementalSegmentation( const Carna::base::model::Volume& volume
+                           , const Carna::base::Vector3ui& seed
+                           , FloodFill::Connectivity connectivity = FloodFill::vertices );
+
+    ~IncrementalSegmentation();
+
+
+    /** \brief  Holds the seed voxel.
+      */
+    const Carna::base::Vector3ui seed;
+
+    /** \brief  Holds the voxel neighborhood.
+      */
+    const FloodFill::Connectivity connectivity;
+
+
+    /** \brief  Updates the region to the HUV range \f$[\mathrm{huv}_0, \mathrm{huv}_1]\f$.
+      */
+    void update( int huv0, int huv1 );
+
+    /** \brief  Tells the lower bound of the current HUV range.
+      */
+    int huv0() const
+    {
+        return currentHuv0;
+    }
+
+    /** \brief  Tells the upper bound of the current HUV range.
+      */
+    int huv1() const
+    {
+        return currentHuv1;
+    }
+
+    /** \brief  References the current region.
+      */
+    const PackedMask& region() const
+    {
+        return currentRegion;
+    }
+
+    /** \brief  Tells the number of voxels within the current region.
+      */
+    unsigned long count() const
+    {
+        return voxels;
+    }
+
+    /** \brief  Tells the bounding box of the current region, where \a max is
+      *         inclusive, or returns \c false if the region is empty.
+      *
+      * The box is kept up to date by the updates, hence this takes constant time.
+      */
+    bool bounds( Carna::base::Vector3ui& min, Carna::base::Vector3ui& max ) const;
+
+
+private:
+
+    /** \brief  Provides access to the segmented volume's voxels.
+      */
+    const VolumeRows rows;
+
+    /** \brief  Describes the displacement of some neighboring voxel.
+      */
+    struct Neighbor
+    {
+        int dx, dy, dz;
+    };
+
+    std::vector< Neighbor > neighbors;
+
+    int currentHuv0;
+
+    int currentHuv1;
+
+    PackedMask currentRegion;
+
+    unsigned long voxels;
+
+    /** \brief  Holds the bounding box of the region, which is extended by each added
+      *         voxel and rebuilt when the region shrinks.
+      */
+    Carna::base::Vector3ui regionMin;
+
+    Carna::base::Vector3ui regionMax;
+
+    /** \brief  Marks the voxels which are held by any of the \ref buckets.
+      */
+    PackedMask frontier;
+
+    /** \brief  Holds the frontier voxels for each HUV.
+      */
+    std::vector< std::vector< uint32_t > > buckets;
+
+    /** \brief  Holds the voxels whose neighborhood is still to be processed.
+      */
+    std::vector< uint32_t > pending;
+
+    /** \brief  Marks the voxels which have been reached while shrinking the region.
+      *
+      * Kept between updates, so that it needs not to be reallocated each time.
+      */
+    PackedMask reached;
+
+
+    signed short huvAt( uint32_t voxel ) const;
+
+    void decode( uint32_t voxel, unsigned int& x, unsigned int& y, unsigned int& z ) const;
+
+    uint32_t encode( unsigned int x, unsigned int y, unsigned int z ) const;
+
+    /** \brief  Extends the bounding box of the region by the voxel \f$(x, y, z)\f$.
+      */
+    void extendBounds( unsigned int x, unsigned int y, unsigned int z );
+
+    /** \brief  Makes the bounding box of the region empty.
+      */
+    void clearBounds();
+
+    /** \brief  Empties the region and makes the seed the only frontier voxel.
+      */
+    void reset();
+
+    /** \brief  Empties the frontier.
+      */
+    void clearFrontier();
+
+    /** \brief  Adds \a voxel to the frontier, unless it is already part of it.
+      */
+    void enqueueFrontier( uint32_t voxel );
+
+    /** \brief  Drains the frontier buckets of \f$[\mathrm{huv}_0, \mathrm{huv}_1]\f$ into
+      *         the region.
+      */
+    void admit( int huv0, int huv1 );
+
+    /** \brief  Grows the region from the \ref pending voxels within the current range.
+      */
+    void grow();
+
+    /** \brief  Re-grows the region from the seed within the current region and the
+      *         HUV range \f$[\mathrm{huv}_0, \mathrm{huv}_1]\f$.
+      */
+    void shrink( int huv0, int huv1 );
+
+}; // IncrementalSegmentation
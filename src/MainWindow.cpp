@@ -13,6 +13,7 @@
 #include "CarnaContextProvider.h"
 #include "ComponentsProvider.h"
 #include "PointCloudsProvider.h"
+#include "StatisticsProvider.h"
 #include "ViewWindow.h"
 #include "WindowingComponent.h"
 #include "ModelInfo.h"
@@ -22,11 +23,17 @@
 #include "Exporter.h"
 #include "Importer.h"
 #include "BinaryDumpProcessor.h"
+#include "CompressedDumpProcessor.h"
+#include "NativeDumpProcessor.h"
 #include "ObjectsComponent.h"
 #include "VolumeNormalizer.h"
 #include "CarnaModelFactory.h"
 #include "MaskingDialog.h"
+#include "MaskFile.h"
+#include "OptionsDialog.h"
 #include "GulsunComponent.h"
+#include "MeshExportJob.h"
+#include "PackedMask.h"
 #include <Carna/base/model/SceneFactory.h>
 #include <Carna/base/CarnaException.h>
 #include <QTabWidget>
@@ -101,6 +108,8 @@ MainWindow::MainWindow( QWidget* parent, Qt::WFlags flags )
     , acquiringGulsun( new QAction( "&Gulsun Vessel Segmentation", this ) )
     , maskExporting( new QAction( "&Export Binary Mask...", this ) )
     , maskImporting( new QAction( "&Import Binary Mask...", this ) )
+    , maskMeshExporting( new QAction( "Export Mask &Mesh...", this ) )
+    , configuring( new QAction( "&Settings...", this ) )
 {
     this->setWindowTitle( "DICOM Viewer 3" );
     this->resize( 750, 750 );
@@ -119,10 +128,13 @@ MainWindow::MainWindow( QWidget* parent, Qt::WFlags flags )
     fileMenu->addSeparator();
     fileMenu->addAction( maskImporting );
     fileMenu->addAction( maskExporting );
+    fileMenu->addAction( maskMeshExporting );
     fileMenu->addSeparator();
     fileMenu->addAction( exporting );
     fileMenu->addAction( closing );
     fileMenu->addSeparator();
+    fileMenu->addAction( configuring );
+    fileMenu->addSeparator();
     fileMenu->addAction( exiting );
 
     closing->setShortcut( QKeySequence( Qt::CTRL + Qt::Key_W ) );
@@ -134,6 +146,7 @@ MainWindow::MainWindow( QWidget* parent, Qt::WFlags flags )
     masking->setEnabled( false );
     maskExporting->setEnabled( false );
     maskImporting->setEnabled( false );
+    maskMeshExporting->setEnabled( false );
 
     connect( exporting    , SIGNAL( triggered() ), this, SLOT( exportRecord() ) );
     connect( normalizing  , SIGNAL( triggered() ), this, SLOT(    normalize() ) );
@@ -142,6 +155,8 @@ MainWindow::MainWindow( QWidget* parent, Qt::WFlags flags )
     connect( exiting      , SIGNAL( triggered() ), this, SLOT(         exit() ) );
     connect( maskExporting, SIGNAL( triggered() ), this, SLOT(   exportMask() ) );
     connect( maskImporting, SIGNAL( triggered() ), this, SLOT(   importMask() ) );
+    connect( maskMeshExporting, SIGNAL( triggered() ), this, SLOT( exportMaskMesh() ) );
+    connect( configuring  , SIGNAL( triggered() ), this, SLOT( showSettings() ) );
 
     // -----------------------------------------------------------------
 
@@ -230,6 +245,7 @@ void MainWindow::init( Carna::base::model::Scene* model )
     CARNA_ASSERT( !carna.get() );
 
     carna.reset( new CarnaContextProvider( server, model ) );
+    statistics.reset( new StatisticsProvider( server, model->volume() ) );
     components.reset( new ComponentsProvider( server ) );
     pointClouds.reset( new PointCloudsProvider( server ) );
 
@@ -265,6 +281,7 @@ void MainWindow::init( Carna::base::model::Scene* model )
 void MainWindow::updateMaskExporting()
 {
     maskExporting->setEnabled( carna->model().hasVolumeMask() );
+    maskMeshExporting->setEnabled( carna->model().hasVolumeMask() && carna->model().volumeMask().isBinary() );
 }
 
 
@@ -321,6 +338,7 @@ void MainWindow::closeRecord()
     QApplication::processEvents();
     components.reset();
     QApplication::processEvents();
+    statistics.reset();
     carna.reset();
     QApplication::processEvents();
 
@@ -466,10 +484,8 @@ void MainWindow::closeEvent( QCloseEvent* )
 
 void MainWindow::showSettings()
 {
-    /*
     OptionsDialog dlg( this );
     dlg.exec();
-    */
 }
 
 
@@ -482,13 +498,15 @@ void MainWindow::exportRecord()
 
     Exporter exporter( server, this );
     exporter.install( new BinaryDumpProcessor() );
+    exporter.install( new NativeDumpProcessor() );
+    exporter.install( new CompressedDumpProcessor() );
     exporter.run();
 }
 
 
 void MainWindow::normalize()
 {
-    VolumeNormalizer normalizer( carna->model(), this );
+    VolumeNormalizer normalizer( carna->model(), server );
 
     bool ok = false;
     normalizer.setThreshold( QInputDialog::getInt
@@ -518,7 +536,7 @@ void MainWindow::normalize()
 
     if( QMessageBox::question( this, "Volume Normalization", "The resolution of the normalized volume data is " + sizeLoss + "% of the original. Do you want to close your current data set and load the new one?", QMessageBox::Yes | QMessageBox::No, defaultButton ) == QMessageBox::Yes )
     {
-        Carna::base::model::Scene* const new_model = normalizer.getResult();
+        Carna::base::model::Scene* const new_model = normalizer.getResult( carna->releaseModel() );
         this->closeRecord();
         this->init( new_model );
     }
@@ -572,31 +590,52 @@ void MainWindow::exportMask()
     }
 
     QApplication::setOverrideCursor( Qt::WaitCursor );
-    QDataStream out( &file );
-
-    const Carna::base::model::BufferedMaskAdapter::BinaryMask& mask = carna->model().volumeMask().binary();
-    out << mask.size.x << mask.size.y << mask.size.z;
+    try
+    {
+        MaskFile::save( file, carna->model().volumeMask().binary() );
+    }
+    catch( const std::exception& ex )
+    {
+        QApplication::restoreOverrideCursor();
+        QMessageBox::critical( this, "Export Binary Mask", QString::fromStdString( ex.what() ) );
+        return;
+    }
 
-    QProgressDialog progress( "Exporting binary mask...", "", 0, mask.size.z, this );
-    progress.setCancelButton( nullptr );
-    progress.show();
+    file.close();
+    QApplication::restoreOverrideCursor();
+}
 
-    for( unsigned int z = 0; z < mask.size.z; ++z )
-    {
-        for( unsigned int y = 0; y < mask.size.y; ++y )
-        for( unsigned int x = 0; x < mask.size.x; ++x )
-        {
-            const uint8_t mask_value = mask( x, y, z );
-            out.writeRawData( reinterpret_cast< const char* >( &mask_value ), 1 );
-        }
 
-        progress.setValue( z );
-    }
+void MainWindow::exportMaskMesh()
+{
+    CARNA_ASSERT( carna->model().hasVolumeMask() );
+    CARNA_ASSERT( carna->model().volumeMask().isBinary() );
 
-    progress.close();
+    const Carna::base::model::Scene& model = carna->model();
+    const Carna::base::Vector spacing( model.spacingX(), model.spacingY(), model.spacingZ() );
 
-    file.close();
+    /* The mask is packed on the GUI thread, so that it may be modified while the
+     * mesh is extracted. Packing is cheap compared to the extraction.
+     */
+    std::shared_ptr< const PackedMask > mask;
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    try
+    {
+        mask.reset( new PackedMask( model.volumeMask().binary() ) );
+    }
+    catch( const std::bad_alloc& )
+    {
+        QApplication::restoreOverrideCursor();
+        QMessageBox::critical( this, "Export Mask Mesh", "Not enough memory to finish operation." );
+        return;
+    }
     QApplication::restoreOverrideCursor();
+
+    MeshExportJob::run( this, "Export Mask Mesh", [mask]()->std::shared_ptr< const PackedMask >
+        {
+            return mask;
+        }
+        , spacing );
 }
 
 
@@ -626,56 +665,36 @@ void MainWindow::importMask()
         return;
     }
 
-    QDataStream in( &file );
+    QApplication::setOverrideCursor( Qt::WaitCursor );
 
-    Carna::base::Vector3ui size;
-    in >> size.x >> size.y >> size.z;
+    std::unique_ptr< Carna::base::model::BufferedMaskAdapter::BinaryMask > mask;
+    try
+    {
+        mask.reset( MaskFile::load( file ) );
+    }
+    catch( const std::exception& ex )
+    {
+        QApplication::restoreOverrideCursor();
+        QMessageBox::critical( this, "Import Binary Mask", QString::fromStdString( ex.what() ) );
+        return;
+    }
+
+    file.close();
+    QApplication::restoreOverrideCursor();
 
+    const Carna::base::Vector3ui& size = mask->size;
     if( size.x != carna->model().volume().size.x ||
         size.y != carna->model().volume().size.y ||
         size.z != carna->model().volume().size.z )
     {
         if( QMessageBox::question( this, "Import Binary Mask", "The volume resolution does not match the loaded datasets resolution. Shall the mask be loaded anyway?" ) != QMessageBox::Ok )
         {
-            file.close();
             return;
         }
     }
 
-    QApplication::setOverrideCursor( Qt::WaitCursor );
-
-    Carna::base::model::BufferedMaskAdapter::BinaryMask* const mask = new Carna::base::model::BufferedMaskAdapter::BinaryMask( size );
-
-    QProgressDialog progress( "Importing binary mask...", "", 0, size.z, this );
-    progress.setCancelButton( nullptr );
-    progress.show();
-
-    for( unsigned int z = 0; z < size.z; ++z )
-    {
-        for( unsigned int y = 0; y < size.y; ++y )
-        {
-            std::vector< char > line_binary_values( size.x );
-            const unsigned int read_bytes = in.readRawData( &line_binary_values.front(), line_binary_values.size() );
-            CARNA_ASSERT( read_bytes == line_binary_values.size() );
-
-            for( unsigned int x = 0; x < size.x; ++x )
-            {
-                const uint8_t mask_value = static_cast< uint8_t >( line_binary_values[ x ] );
-                ( *mask )( x, y, z ) = mask_value;
-            }
-        }
-
-        progress.setValue( z );
-    }
-
-    progress.close();
-
-    file.close();
-
     carna->model().setVolumeMask(
         new Carna::base::model::BufferedMaskAdapter(
             new Carna::base::Composition< Carna::base::model::BufferedMaskAdapter::BinaryMask >(
-                mask ) ) );
-
-    QApplication::restoreOverrideCursor();
+                mask.release() ) ) );
 }
@@ -30,6 +30,7 @@ class ViewWindow;
 class CarnaContextProvider;
 class ComponentsProvider;
 class PointCloudsProvider;
+class StatisticsProvider;
 class CarnaModelFactory;
 
 
@@ -189,6 +190,12 @@ private:
 
     QAction* const maskImporting;
 
+    QAction* const maskMeshExporting;
+
+    /** \brief  Opens the settings.
+      */
+    QAction* const configuring;
+
 
     /** \brief	References the record service.
       */
@@ -197,6 +204,10 @@ private:
     /** \brief	Holds the carna context service provider.
       */
     std::unique_ptr< CarnaContextProvider > carna;
+
+    /** \brief	Holds the volume statistics service provider.
+      */
+    std::unique_ptr< StatisticsProvider > statistics;
     
     /** \brief	Holds the components service provider.
       */
@@ -314,6 +325,10 @@ private slots:
 
     void importMask();
 
+    /** \brief  Exports the surface mesh of the current binary mask as STL or PLY.
+      */
+    void exportMaskMesh();
+
     void updateMaskExporting();
 
 
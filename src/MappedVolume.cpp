@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "glew.h"
+#include "MappedVolume.h"
+#include "VolumeRows.h"
+#include <QFile>
+#include <stdexcept>
+
+
+
+// ----------------------------------------------------------------------------------
+// MappedVolume
+// ----------------------------------------------------------------------------------
+
+MappedVolume::MappedVolume( const QString& fileName, qint64 offset, const Carna::base::Vector3ui& size )
+    : Volume( size )
+    , file( new QFile( fileName ) )
+    , mapping( nullptr )
+    , voxels( nullptr )
+{
+    const qint64 bytes = static_cast< qint64 >( size.x ) * size.y * size.z * sizeof( Voxel );
+
+    if( !file->open( QIODevice::ReadOnly ) )
+    {
+        throw std::runtime_error( "Failed to open \"" + fileName.toStdString() + "\"." );
+    }
+    if( offset + bytes > file->size() )
+    {
+        throw std::runtime_error( "Volume file smaller than expected." );
+    }
+
+    mapping = file->map( offset, bytes );
+    if( mapping == nullptr )
+    {
+        throw std::runtime_error( "Failed to map \"" + fileName.toStdString() + "\": " + file->errorString().toStdString() );
+    }
+    voxels = reinterpret_cast< const Voxel* >( mapping );
+}
+
+
+MappedVolume::~MappedVolume()
+{
+    file->unmap( mapping );
+}
+
+
+void MappedVolume::uploadTexture() const
+{
+    glPushClientAttrib( GL_CLIENT_PIXEL_STORE_BIT );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 2 );
+
+    glTexImage3D( GL_TEXTURE_3D, 0, GL_INTENSITY16, size.x, size.y, size.z, 0, GL_LUMINANCE, GL_UNSIGNED_SHORT, voxels );
+
+    glPopClientAttrib();
+}
+
+
+signed short MappedVolume::operator()( const Carna::base::Vector3ui& at ) const
+{
+    return ( *this )( at.x, at.y, at.z );
+}
+
+
+signed short MappedVolume::operator()
+    ( unsigned int x
+    , unsigned int y
+    , unsigned int z ) const
+{
+    return VolumeRows::decode( voxels[ x + size.x * ( y + static_cast< unsigned long >( size.y ) * z ) ] );
+}
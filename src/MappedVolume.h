@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/base/model/Volume.h>
+#include <Carna/Carna.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <QString>
+#include <memory>
+
+class QFile;
+
+
+
+// ----------------------------------------------------------------------------------
+// MappedVolume
+// ----------------------------------------------------------------------------------
+
+/** \brief  Volume whose voxels are read from a read-only memory map of some file.
+  *
+  * The file must hold the voxels in the \c UInt16Volume encoding and in the byte
+  * order of this machine. Pages are loaded lazily by the operating system, and
+  * several processes which map the same file share its pages.
+  *
+  * \ref VolumeRows references the mapped voxels directly.
+  */
+class MappedVolume : public Carna::base::model::Volume
+{
+
+public:
+
+    /** \brief  Holds the encoded voxel type.
+      */
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+
+    /** \brief  Maps the \a size voxels which start at \a offset within the file
+      *         \a fileName.
+      *
+      * \throws std::runtime_error  if the file cannot be mapped.
+      */
+    MappedVolume( const QString& fileName, qint64 offset, const Carna::base::Vector3ui& size );
+
+    /** \brief  Unmaps the file.
+      */
+    virtual ~MappedVolume();
+
+
+    /** \brief  References the first mapped voxel.
+      */
+    const Voxel* buffer() const
+    {
+        return voxels;
+    }
+
+
+    virtual void uploadTexture() const override;
+
+    virtual signed short operator()
+        ( unsigned int x
+        , unsigned int y
+        , unsigned int z ) const override;
+
+    virtual signed short operator()( const Carna::base::Vector3ui& at ) const override;
+
+
+private:
+
+    const std::unique_ptr< QFile > file;
+
+    uchar* mapping;
+
+    const Voxel* voxels;
+
+}; // MappedVolume
@@ -0,0 +1,200 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "MaskFile.h"
+#include "PackedMask.h"
+#include "Slabs.h"
+#include <QByteArray>
+#include <QDataStream>
+#include <QIODevice>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+
+static const char MASK_FILE_MAGIC[ 4 ] = { 'M', 'S', 'K', '2' };
+
+
+
+// ----------------------------------------------------------------------------------
+// MaskFile
+// ----------------------------------------------------------------------------------
+
+void MaskFile::save( QIODevice& device, const BinaryMask& mask )
+{
+    const PackedMask packed( mask );
+    const Carna::base::Vector3ui& size = packed.size;
+
+    const unsigned int chunks = ( size.z + CHUNK_SLICES - 1 ) / CHUNK_SLICES;
+    const std::size_t sliceWords = static_cast< std::size_t >( size.y ) * packed.rowWords;
+
+ // pack the chunks in parallel
+
+    std::vector< QByteArray > payloads( chunks );
+
+    const Slabs slabs( chunks );
+    slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+        {
+            for( unsigned int chunk = first; chunk < last; ++chunk )
+            {
+                const unsigned int z0 = chunk * CHUNK_SLICES;
+                const unsigned int z1 = std::min( z0 + CHUNK_SLICES, size.z );
+                const std::size_t words = sliceWords * ( z1 - z0 );
+                const PackedMask::Word* const source = &packed.words()[ sliceWords * z0 ];
+
+                QByteArray bytes( static_cast< int >( words * sizeof( PackedMask::Word ) ), '\0' );
+                unsigned char* const target = reinterpret_cast< unsigned char* >( bytes.data() );
+                for( std::size_t i = 0; i < words; ++i )
+                {
+                    for( unsigned int b = 0; b < sizeof( PackedMask::Word ); ++b )
+                    {
+                        target[ i * sizeof( PackedMask::Word ) + b ] = static_cast< unsigned char >( source[ i ] >> ( 8 * b ) );
+                    }
+                }
+
+                payloads[ chunk ] = qCompress( bytes );
+            }
+        }
+    );
+
+ // write header and chunks
+
+    QDataStream out( &device );
+    out.writeRawData( MASK_FILE_MAGIC, sizeof( MASK_FILE_MAGIC ) );
+    out << static_cast< quint32 >( size.x ) << static_cast< quint32 >( size.y ) << static_cast< quint32 >( size.z );
+    out << static_cast< quint32 >( CHUNK_SLICES ) << static_cast< quint32 >( chunks );
+
+    for( unsigned int chunk = 0; chunk < chunks; ++chunk )
+    {
+        out << static_cast< quint32 >( payloads[ chunk ].size() );
+        out.writeRawData( payloads[ chunk ].constData(), payloads[ chunk ].size() );
+    }
+
+    if( out.status() != QDataStream::Ok )
+    {
+        throw std::runtime_error( "Failed writing the mask." );
+    }
+}
+
+
+MaskFile::BinaryMask* MaskFile::load( QIODevice& device )
+{
+    QDataStream in( &device );
+
+    /* Version 1 masks start with the mask width instead of the magic bytes, which
+     * would be a width of more than a billion voxels.
+     */
+    const QByteArray magic = device.peek( sizeof( MASK_FILE_MAGIC ) );
+    const bool packedFormat = magic.size() == sizeof( MASK_FILE_MAGIC ) && std::memcmp( magic.constData(), MASK_FILE_MAGIC, sizeof( MASK_FILE_MAGIC ) ) == 0;
+    if( packedFormat )
+    {
+        in.skipRawData( sizeof( MASK_FILE_MAGIC ) );
+    }
+
+    quint32 width, height, depth;
+    in >> width >> height >> depth;
+    if( in.status() != QDataStream::Ok )
+    {
+        throw std::runtime_error( "Mask header is incomplete." );
+    }
+
+    const Carna::base::Vector3ui size( width, height, depth );
+
+ // read version 1 masks slice-wise
+
+    if( !packedFormat )
+    {
+        std::unique_ptr< BinaryMask > mask( new BinaryMask( size ) );
+        BinaryMask& out = *mask;
+
+        const std::size_t sliceBytes = static_cast< std::size_t >( size.x ) * size.y;
+        std::vector< char > slice( sliceBytes );
+        for( unsigned int z = 0; z < size.z; ++z )
+        {
+            if( sliceBytes > 0 && in.readRawData( &slice.front(), static_cast< int >( sliceBytes ) ) != static_cast< int >( sliceBytes ) )
+            {
+                throw std::runtime_error( "Mask file is truncated." );
+            }
+
+            const Slabs rows( size.y, 16 );
+            rows.process( [&]( unsigned int, unsigned int y0, unsigned int y1 )
+                {
+                    for( unsigned int y = y0; y < y1; ++y )
+                    for( unsigned int x = 0; x < size.x; ++x )
+                    {
+                        out( x, y, z ) = static_cast< uint8_t >( slice[ x + y * size.x ] );
+                    }
+                }
+            );
+        }
+
+        return mask.release();
+    }
+
+ // read version 2 chunks, then unpack them in parallel
+
+    quint32 chunkSlices, chunks;
+    in >> chunkSlices >> chunks;
+    if( in.status() != QDataStream::Ok || chunkSlices == 0 || chunks != ( size.z + chunkSlices - 1 ) / chunkSlices )
+    {
+        throw std::runtime_error( "Mask header is malformed." );
+    }
+
+    std::vector< QByteArray > payloads( chunks );
+    for( unsigned int chunk = 0; chunk < chunks; ++chunk )
+    {
+        quint32 length;
+        in >> length;
+        payloads[ chunk ].resize( static_cast< int >( length ) );
+        if( in.status() != QDataStream::Ok || in.readRawData( payloads[ chunk ].data(), static_cast< int >( length ) ) != static_cast< int >( length ) )
+        {
+            throw std::runtime_error( "Mask file is truncated." );
+        }
+    }
+
+    PackedMask packed( size );
+    const std::size_t sliceWords = static_cast< std::size_t >( size.y ) * packed.rowWords;
+
+    const Slabs slabs( chunks );
+    slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+        {
+            for( unsigned int chunk = first; chunk < last; ++chunk )
+            {
+                const unsigned int z0 = chunk * chunkSlices;
+                const unsigned int z1 = std::min( z0 + chunkSlices, size.z );
+                const std::size_t words = sliceWords * ( z1 - z0 );
+
+                const QByteArray bytes = qUncompress( payloads[ chunk ] );
+                if( bytes.size() != static_cast< int >( words * sizeof( PackedMask::Word ) ) )
+                {
+                    throw std::runtime_error( "Mask chunk is corrupt." );
+                }
+
+                const unsigned char* const source = reinterpret_cast< const unsigned char* >( bytes.constData() );
+                PackedMask::Word* const target = &packed.words()[ sliceWords * z0 ];
+                for( std::size_t i = 0; i < words; ++i )
+                {
+                    PackedMask::Word word = 0;
+                    for( unsigned int b = 0; b < sizeof( PackedMask::Word ); ++b )
+                    {
+                        word |= static_cast< PackedMask::Word >( source[ i * sizeof( PackedMask::Word ) + b ] ) << ( 8 * b );
+                    }
+                    target[ i ] = word;
+                }
+            }
+        }
+    );
+
+    return packed.toBinaryMask();
+}
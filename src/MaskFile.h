@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/base/model/BufferedMaskAdapter.h>
+
+class QIODevice;
+
+
+
+// ----------------------------------------------------------------------------------
+// MaskFile
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads and writes \c *.mask files.
+  *
+  * Masks are written in version 2 of the format, which starts with the magic bytes
+  * \c MSK2, followed by the mask size as three big-endian \c uint32_t, the number
+  * of z-slices per chunk as \c uint32_t and the number of chunks as \c uint32_t.
+  * Each chunk is stored as its length as \c uint32_t, followed by the
+  * \c qCompress -ed \ref PackedMask words of its slices, which are little-endian.
+  * The chunks are packed and unpacked in parallel.
+  *
+  * Version 1 masks, which start with the mask size, followed by one byte per voxel,
+  * are still read.
+  */
+class MaskFile
+{
+
+public:
+
+    /** \brief  Holds the mask type which is read and written.
+      */
+    typedef Carna::base::model::BufferedMaskAdapter::BinaryMask BinaryMask;
+
+    /** \brief  Holds the number of z-slices per chunk.
+      */
+    const static unsigned int CHUNK_SLICES = 16;
+
+
+    /** \brief  Writes \a mask to \a out in the version 2 format.
+      *
+      * \throws std::runtime_error  if writing fails.
+      */
+    static void save( QIODevice& out, const BinaryMask& mask );
+
+    /** \brief  Reads a mask of either version from \a in.
+      *
+      * \throws std::runtime_error  if the file is truncated or malformed.
+      */
+    static BinaryMask* load( QIODevice& in );
+
+}; // MaskFile
@@ -10,12 +10,15 @@
  */
 
 #include "MedialnessGraph.h"
+#include "OptimizedVolumeDecorator.h"
 #include <Carna/base/view/SceneProvider.h>
 #include <Carna/base/model/Scene.h>
 #include <Carna/base/model/Volume.h>
 #include <Carna/base/VisualizationEnvironment.h>
 #include <Carna/base/view/glError.h>
+#include <Carna/base/Aggregation.h>
 #include <QGLFramebufferObject>
+#include <algorithm>
 
 
 
@@ -169,6 +172,130 @@ double GpuIntensitySampler::valueAt( const Carna::base::Vector& millimeters ) co
 
 
 
+// ----------------------------------------------------------------------------------
+// BrickedIntensitySampler
+// ----------------------------------------------------------------------------------
+
+BrickedIntensitySampler::BrickedIntensitySampler( const Carna::base::model::Scene& model )
+    : model( model )
+    , volume( new OptimizedVolumeDecorator
+        ( new Carna::base::Aggregation< const Carna::base::model::Volume >( model.volume() )
+        , static_cast< float >( model.spacingX() )
+        , static_cast< float >( model.spacingY() )
+        , static_cast< float >( model.spacingZ() ) ) )
+{
+}
+
+
+BrickedIntensitySampler::~BrickedIntensitySampler()
+{
+}
+
+
+const OptimizedVolumeDecorator& BrickedIntensitySampler::bricks() const
+{
+    return *volume;
+}
+
+
+double BrickedIntensitySampler::valueAt( const Carna::base::Vector& millimeters ) const
+{
+    const double u[ 3 ] =
+        { millimeters.x() / model.spacingX()
+        , millimeters.y() / model.spacingY()
+        , millimeters.z() / model.spacingZ() };
+
+    const unsigned int n[ 3 ] = { volume->size.x, volume->size.y, volume->size.z };
+    unsigned int i0[ 3 ], i1[ 3 ];
+    double t[ 3 ];
+    for( unsigned int axis = 0; axis < 3; ++axis )
+    {
+        if( u[ axis ] < 0 || u[ axis ] > n[ axis ] - 1. )
+        {
+            return -1024;
+        }
+        i0[ axis ] = static_cast< unsigned int >( u[ axis ] );
+        i1[ axis ] = std::min( i0[ axis ] + 1, n[ axis ] - 1 );
+        t [ axis ] = u[ axis ] - i0[ axis ];
+    }
+
+ // interpolate trilinearly
+
+    double value = 0;
+    for( unsigned int corner = 0; corner < 8; ++corner )
+    {
+        const bool cx = ( corner & 1 ) != 0;
+        const bool cy = ( corner & 2 ) != 0;
+        const bool cz = ( corner & 4 ) != 0;
+
+        const double weight = ( cx ? t[ 0 ] : 1 - t[ 0 ] )
+                            * ( cy ? t[ 1 ] : 1 - t[ 1 ] )
+                            * ( cz ? t[ 2 ] : 1 - t[ 2 ] );
+
+        value += weight * ( *volume )
+            ( cx ? i1[ 0 ] : i0[ 0 ]
+            , cy ? i1[ 1 ] : i0[ 1 ]
+            , cz ? i1[ 2 ] : i0[ 2 ] );
+    }
+    return value;
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// PyramidIntensitySampler
+// ----------------------------------------------------------------------------------
+
+PyramidIntensitySampler::PyramidIntensitySampler( const Carna::base::model::Scene& model, Differential::Sampler* fullResolution )
+    : model( model )
+    , fullResolution( fullResolution )
+    , currentLevel( 0 )
+{
+}
+
+
+void PyramidIntensitySampler::setFullResolution( Differential::Sampler* fullResolution )
+{
+    this->fullResolution.reset( fullResolution );
+}
+
+
+void PyramidIntensitySampler::setLevel( unsigned int level )
+{
+    CARNA_ASSERT( level < VolumePyramid::LEVELS );
+
+    if( level > 0 && pyramid.get() == nullptr )
+    {
+        pyramid = VolumePyramid::acquire( model.volume() );
+    }
+    currentLevel = level;
+}
+
+
+unsigned int PyramidIntensitySampler::level() const
+{
+    return currentLevel;
+}
+
+
+double PyramidIntensitySampler::valueAt( const Carna::base::Vector& millimeters ) const
+{
+    if( currentLevel == 0 )
+    {
+        return fullResolution->valueAt( millimeters );
+    }
+    else
+    {
+        return pyramid->valueAt
+            ( currentLevel
+            , millimeters.x() / model.spacingX()
+            , millimeters.y() / model.spacingY()
+            , millimeters.z() / model.spacingZ() );
+    }
+}
+
+
+
 // ----------------------------------------------------------------------------------
 // MedialnessGraph
 // ----------------------------------------------------------------------------------
@@ -198,6 +325,7 @@ MedialnessGraph::MedialnessGraph
                 return Carna::base::Vector3ui( max_x + 1, max_y + 1, max_z + 1 );
             }
         () )
+    , prefetchedBricks( nullptr )
     , sampler( [&]()->Differential::Sampler&
             {
                 CARNA_ASSERT( sampler != nullptr );
@@ -415,6 +543,13 @@ void MedialnessGraph::expand
             edges.insert( std::pair< double, Node >( weight, neighbor ) );
             produceRadius( probedNode, neighbor, radius );
             status = "( OK )";
+
+         // let the bricks around the frontier load in the background
+
+            if( prefetchedBricks != nullptr )
+            {
+                prefetchedBricks->prefetch( neighborPosition, setup().maximumRadius + setup().maximumScale );
+            }
         }
         else
         {
@@ -468,6 +603,12 @@ bool MedialnessGraph::hasDetailedDebug() const
 }
 
 
+void MedialnessGraph::setPrefetchedBricks( const OptimizedVolumeDecorator* bricks )
+{
+    prefetchedBricks = bricks;
+}
+
+
 void MedialnessGraph::fetchNodeByIndex( MedialnessGraph::Node& node, const unsigned int index ) const
 {
     const unsigned int nodes_per_slice = size.x * size.y;
@@ -12,11 +12,14 @@
 #pragma once
 
 #include "Medialness.h"
+#include "VolumePyramid.h"
 #include <Carna/Carna.h>
 #include <Carna/base/Vector3.h>
 #include <Carna/base/model/Position.h>
 #include <map>
+#include <memory>
 
+class OptimizedVolumeDecorator;
 class QGLFramebufferObject;
 
 
@@ -63,6 +66,88 @@ public:
 
 
 
+// ----------------------------------------------------------------------------------
+// BrickedIntensitySampler
+// ----------------------------------------------------------------------------------
+
+/** \brief  Interpolates the intensities trilinearly from an
+  *         \ref OptimizedVolumeDecorator "LRU brick cache" of the volume.
+  *
+  * The bricks around the frontier of some graph search can be prefetched through
+  * \ref bricks, e.g. by \ref MedialnessGraph::setPrefetchedBricks.
+  */
+class BrickedIntensitySampler : public Differential::Sampler
+{
+
+    const Carna::base::model::Scene& model;
+
+    const std::unique_ptr< OptimizedVolumeDecorator > volume;
+
+public:
+
+    BrickedIntensitySampler( const Carna::base::model::Scene& );
+
+    virtual ~BrickedIntensitySampler();
+
+    /** \brief  References the brick cache.
+      */
+    const OptimizedVolumeDecorator& bricks() const;
+
+
+    virtual double valueAt( const Carna::base::Vector& ) const override;
+
+}; // BrickedIntensitySampler
+
+
+
+// ----------------------------------------------------------------------------------
+// PyramidIntensitySampler
+// ----------------------------------------------------------------------------------
+
+/** \brief  Samples some level of the \ref VolumePyramid "volume pyramid" or delegates
+  *         to another sampler on level \f$0\f$.
+  *
+  * The coarse levels trade accuracy for speed, e.g. while tuning parameters.
+  */
+class PyramidIntensitySampler : public Differential::Sampler
+{
+
+    const Carna::base::model::Scene& model;
+
+    std::unique_ptr< Differential::Sampler > fullResolution;
+
+    std::shared_ptr< const VolumePyramid > pyramid;
+
+    unsigned int currentLevel;
+
+public:
+
+    /** \brief  Delegates to \a fullResolution on level \f$0\f$ and takes its ownership.
+      */
+    PyramidIntensitySampler( const Carna::base::model::Scene&, Differential::Sampler* fullResolution );
+
+    /** \brief  Replaces the sampler of level \f$0\f$ and takes its ownership.
+      *
+      * Must not be invoked while the sampler is in use.
+      */
+    void setFullResolution( Differential::Sampler* fullResolution );
+
+    /** \brief  Selects the level to sample from.
+      *
+      * The pyramid is acquired when a coarse level is selected for the first time.
+      * Must not be invoked while the sampler is in use.
+      */
+    void setLevel( unsigned int level );
+
+    unsigned int level() const;
+
+
+    virtual double valueAt( const Carna::base::Vector& ) const override;
+
+}; // PyramidIntensitySampler
+
+
+
 // ----------------------------------------------------------------------------------
 // MedialnessGraph
 // ----------------------------------------------------------------------------------
@@ -192,6 +277,13 @@ public:
 
     bool hasDetailedDebug() const;
 
+    /** \brief  Lets \ref expand prefetch the neighborhoods of the nodes it enqueues
+      *         from \a bricks, or stops prefetching if \a bricks is \c nullptr.
+      *
+      * The \a bricks should back the \ref sampler.
+      */
+    void setPrefetchedBricks( const OptimizedVolumeDecorator* bricks );
+
  // ----------------------------------------------------------------------------------
 
     Carna::base::model::Position getNodePosition( const Node& node ) const;
@@ -216,6 +308,8 @@ private:
 
     const Carna::base::Vector3ui size;
 
+    const OptimizedVolumeDecorator* prefetchedBricks;
+
  // ----------------------------------------------------------------------------------
 
     void computeEdge( const Carna::base::Vector& p0, const Carna::base::Vector& p1, double& medialness, double& radius ) const;
@@ -0,0 +1,186 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "MeshExportJob.h"
+#include "SurfaceMesh.h"
+#include "PackedMask.h"
+#include <QProgressDialog>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFile>
+#include <stdexcept>
+
+
+
+/** \brief  Holds the fraction of the progress which the extraction makes up, the
+  *         rest is up to writing the file.
+  */
+const static double MESH_EXPORT_EXTRACTION_SHARE = 0.9;
+
+
+
+// ----------------------------------------------------------------------------------
+// MeshExportJob
+// ----------------------------------------------------------------------------------
+
+MeshExportJob::MeshExportJob( const MaskFactory& createMask
+                            , const Carna::base::Vector& spacing
+                            , const QString& fileName
+                            , QObject* parent )
+    : BackgroundJob( parent )
+    , fileName( fileName )
+    , createMask( createMask )
+    , spacing( spacing )
+    , complete( false )
+{
+}
+
+
+MeshExportJob::~MeshExportJob()
+{
+    cancelAndWait();
+}
+
+
+void MeshExportJob::run( QWidget* parent
+                       , const QString& title
+                       , const MaskFactory& createMask
+                       , const Carna::base::Vector& spacing )
+{
+    QString selectedFilter;
+    QString fileName
+        = QFileDialog::getSaveFileName
+        ( parent
+        , title
+        , ""
+        , "STL meshes (*.stl);;PLY meshes (*.ply)"
+        , &selectedFilter
+        , QFileDialog::DontResolveSymlinks
+        | QFileDialog::HideNameFilterDetails );
+
+    if( fileName.isEmpty() )
+    {
+        return;
+    }
+    if( selectedFilter.startsWith( "PLY" ) && !fileName.endsWith( ".ply", Qt::CaseInsensitive ) )
+    {
+        fileName += ".ply";
+    }
+
+    MeshExportJob* const job = new MeshExportJob( createMask, spacing, fileName, parent );
+
+    QProgressDialog* const progress = new QProgressDialog( "Extracting surface mesh...", "Abort", 0, PROGRESS_STEPS - 1, parent );
+    progress->setWindowTitle( title );
+    progress->setWindowModality( Qt::WindowModal );
+    progress->setMinimumDuration( 0 );
+
+    connect( job, SIGNAL( progressed( int ) ), progress, SLOT( setValue( int ) ) );
+    connect( progress, SIGNAL( canceled() ), job, SLOT( cancel() ) );
+    connect( job, SIGNAL( destroyed() ), progress, SLOT( deleteLater() ) );
+
+    /* The dialog is hidden first, so that the message is not shown behind it.
+     */
+    job->title = title;
+    connect( job, SIGNAL( failed( const QString& ) ), progress, SLOT( hide() ) );
+    connect( job, SIGNAL( failed( const QString& ) ), job, SLOT( reportFailure( const QString& ) ) );
+
+    job->start();
+    progress->show();
+}
+
+
+void MeshExportJob::process()
+{
+    try
+    {
+        const std::shared_ptr< const PackedMask > mask = createMask();
+        if( isCanceled() )
+        {
+            return;
+        }
+
+     // extract the mesh
+
+        const SurfaceMesh mesh( *mask, spacing, [this]( double fraction )->bool
+            {
+                reportProgress( MESH_EXPORT_EXTRACTION_SHARE * fraction );
+                return !isCanceled();
+            }
+        );
+        if( isCanceled() )
+        {
+            return;
+        }
+
+     // write the file
+
+        QFile file( fileName );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        {
+            throw std::runtime_error( "Failed opening file for writing." );
+        }
+        try
+        {
+            if( fileName.endsWith( ".ply", Qt::CaseInsensitive ) )
+            {
+                mesh.savePly( file );
+            }
+            else
+            {
+                mesh.saveStl( file );
+            }
+        }
+        catch( ... )
+        {
+            file.close();
+            file.remove();
+            throw;
+        }
+        complete = true;
+        reportProgress( 1 );
+    }
+    catch( const std::bad_alloc& )
+    {
+        error = "Not enough memory to finish operation.";
+    }
+    catch( const std::exception& ex )
+    {
+        error = QString::fromStdString( ex.what() );
+    }
+    catch( ... )
+    {
+        error = "Unknown error.";
+    }
+}
+
+
+void MeshExportJob::finish()
+{
+    if( !error.isEmpty() )
+    {
+        emit failed( error );
+    }
+    else
+    if( !complete )
+    {
+        emit canceled();
+    }
+    else
+    {
+        emit finished();
+    }
+}
+
+
+void MeshExportJob::reportFailure( const QString& message )
+{
+    QMessageBox::critical( qobject_cast< QWidget* >( parent() ), title, message );
+}
@@ -0,0 +1,127 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "BackgroundJob.h"
+#include <Carna/Carna.h>
+#include <Carna/base/Transformation.h>
+#include <QString>
+#include <functional>
+#include <memory>
+
+class PackedMask;
+class QWidget;
+
+
+
+// ----------------------------------------------------------------------------------
+// MeshExportJob
+// ----------------------------------------------------------------------------------
+
+/** \brief  Extracts the \ref SurfaceMesh of some mask in the background and writes it
+  *         to a file.
+  *
+  * The mask is created by a factory, which is invoked on the worker thread, so that
+  * e.g. a \ref Segmentation is computed in the background as well. The file format is
+  * PLY if the file name ends with \c .ply and binary STL otherwise. A partially
+  * written file is removed.
+  *
+  * Exactly one of \ref finished, \ref failed and \ref canceled is emitted, after which
+  * the job deletes itself.
+  */
+class MeshExportJob : public BackgroundJob
+{
+
+    Q_OBJECT
+
+public:
+
+    /** \brief  Creates the mask on the worker thread.
+      */
+    typedef std::function< std::shared_ptr< const PackedMask >() > MaskFactory;
+
+
+    /** \brief  Instantiates a job which writes the mesh of the mask created by
+      *         \a createMask, whose voxels are \a spacing millimeters apart, to
+      *         \a fileName.
+      */
+    MeshExportJob( const MaskFactory& createMask
+                 , const Carna::base::Vector& spacing
+                 , const QString& fileName
+                 , QObject* parent = nullptr );
+
+    /** \brief  Cancels the job and waits until the worker has finished.
+      */
+    virtual ~MeshExportJob();
+
+
+    /** \brief  Holds the name of the written file.
+      */
+    const QString fileName;
+
+    /** \brief  Asks the user for a file name, then runs a job under a window-modal
+      *         progress dialog.
+      *
+      * The dialog blocks \a parent until the job is done, so that the data which
+      * \a createMask reads stays untouched.
+      */
+    static void run( QWidget* parent
+                   , const QString& title
+                   , const MaskFactory& createMask
+                   , const Carna::base::Vector& spacing );
+
+
+signals:
+
+    /** \brief  Tells that the file was written.
+      */
+    void finished();
+
+    /** \brief  Tells that the export failed with \a message.
+      */
+    void failed( const QString& message );
+
+    /** \brief  Tells that the job was canceled.
+      */
+    void canceled();
+
+
+private:
+
+    const MaskFactory createMask;
+
+    const Carna::base::Vector spacing;
+
+    bool complete;
+
+    QString error;
+
+    /** \brief  Holds the title of the message which \ref reportFailure shows.
+      */
+    QString title;
+
+    /** \brief  Creates the mask, extracts the mesh and writes the file.
+      */
+    virtual void process() override;
+
+    /** \brief  Notifies about the outcome.
+      */
+    virtual void finish() override;
+
+
+private slots:
+
+    /** \brief  Shows \a message to the user.
+      */
+    void reportFailure( const QString& message );
+
+}; // MeshExportJob
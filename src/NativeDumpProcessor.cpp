@@ -0,0 +1,427 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "NativeDumpProcessor.h"
+#include "Exporter.h"
+#include "Importer.h"
+#include "ImportJob.h"
+#include "DataSize.h"
+#include "CarnaContextClient.h"
+#include "MappedVolume.h"
+#include "Slabs.h"
+#include "VolumeRows.h"
+#include <Carna/base/model/Scene.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <QDataStream>
+#include <QProgressDialog>
+#include <QSysInfo>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+
+static const char NATIVE_DUMP_MAGIC[ 4 ] = { 'N', 'V', 'D', '1' };
+
+static const uint16_t NATIVE_DUMP_UINT16_ENCODING = 1;
+
+static const uint16_t NATIVE_DUMP_LITTLE_ENDIAN = 0;
+
+static const uint16_t NATIVE_DUMP_BIG_ENDIAN = 1;
+
+/** \brief  Aligns the voxel data to memory pages, so that it can be mapped without
+  *         adjusting the offset.
+  */
+static const uint32_t NATIVE_DUMP_ALIGNMENT = 4096;
+
+
+
+static uint16_t nativeDumpByteOrder()
+{
+    return QSysInfo::ByteOrder == QSysInfo::LittleEndian ? NATIVE_DUMP_LITTLE_ENDIAN : NATIVE_DUMP_BIG_ENDIAN;
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// NativeDumpHeader
+// ----------------------------------------------------------------------------------
+
+/** \brief  Holds the validated header of some native dump.
+  */
+struct NativeDumpHeader
+{
+    uint16_t byteOrder;
+    uint32_t width, height, depth;
+    double spacingX, spacingY, spacingZ;
+    int32_t voidThreshold;
+    qint64 dataOffset;
+};
+
+
+/** \brief  Reads the header from the beginning of \a file and verifies that the
+  *         voxel data it declares is contained by the file.
+  */
+static void readNativeDumpHeader( QFile& file, NativeDumpHeader& header )
+{
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+    QDataStream in( &file );
+
+    char magic[ sizeof( NATIVE_DUMP_MAGIC ) ];
+    uint16_t encoding;
+    uint32_t alignment;
+    quint64 dataOffset;
+
+    if( in.readRawData( magic, sizeof( magic ) ) != sizeof( magic ) || std::memcmp( magic, NATIVE_DUMP_MAGIC, sizeof( magic ) ) != 0 )
+    {
+        throw std::runtime_error( "Not a native volume dump." );
+    }
+
+    in >> encoding >> header.byteOrder >> alignment;
+    in >> header.width >> header.height >> header.depth;
+    in >> header.spacingX >> header.spacingY >> header.spacingZ;
+    in >> header.voidThreshold >> dataOffset;
+
+    if( in.status() != QDataStream::Ok )
+    {
+        throw std::runtime_error( "Native volume dump header is incomplete." );
+    }
+    if( encoding != NATIVE_DUMP_UINT16_ENCODING )
+    {
+        throw std::runtime_error( "Unsupported voxel encoding." );
+    }
+    if( header.byteOrder != NATIVE_DUMP_LITTLE_ENDIAN && header.byteOrder != NATIVE_DUMP_BIG_ENDIAN )
+    {
+        throw std::runtime_error( "Unsupported byte order." );
+    }
+    if( alignment == 0 || dataOffset % alignment != 0 || dataOffset % sizeof( Voxel ) != 0 )
+    {
+        throw std::runtime_error( "Voxel data is misaligned." );
+    }
+    if( header.width == 0 || header.height == 0 || header.depth == 0 )
+    {
+        throw std::runtime_error( "Dataset dimensions are invalid." );
+    }
+    if( header.spacingX <= 0 || header.spacingY <= 0 || header.spacingZ <= 0 )
+    {
+        throw std::runtime_error( "Spacings are invalid." );
+    }
+
+    const qint64 dataBytes = static_cast< qint64 >( header.width ) * header.height * header.depth * sizeof( Voxel );
+    header.dataOffset = static_cast< qint64 >( dataOffset );
+
+    if( header.dataOffset + dataBytes > file.size() )
+    {
+        throw std::runtime_error( "Native volume dump smaller than expected." );
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// NativeDumpImportJob
+// ----------------------------------------------------------------------------------
+
+/** \brief  Maps some native dump, or reads it and swaps its bytes if it was written
+  *         in the other byte order.
+  */
+class NativeDumpImportJob : public ImportJob
+{
+
+public:
+
+    NativeDumpImportJob
+        ( QFile& file
+        , qint64 dataOffset
+        , const Carna::base::Vector3ui& size
+        , bool swapBytes
+        , int voidThreshold
+        , const QString& description
+        , double spacingX
+        , double spacingY
+        , double spacingZ )
+        : ImportJob( description, spacingX, spacingY, spacingZ )
+        , file( file )
+        , dataOffset( dataOffset )
+        , size( size )
+        , swapBytes( swapBytes )
+    {
+        setVoidThreshold( voidThreshold );
+    }
+
+
+protected:
+
+    virtual Carna::base::model::Volume* load() override;
+
+
+private:
+
+    QFile& file;
+
+    const qint64 dataOffset;
+
+    const Carna::base::Vector3ui size;
+
+    const bool swapBytes;
+
+}; // NativeDumpImportJob
+
+
+Carna::base::model::Volume* NativeDumpImportJob::load()
+{
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+    if( !swapBytes )
+    {
+        file.close();
+        return new MappedVolume( file.fileName(), dataOffset, size );
+    }
+
+    const qint64 voxelsCount = static_cast< qint64 >( size.x ) * size.y * size.z;
+
+    Carna::base::model::UInt16Volume::BufferType* const buffer = new Carna::base::model::UInt16Volume::BufferType( static_cast< std::size_t >( voxelsCount ) );
+
+    std::unique_ptr< Carna::base::model::UInt16Volume > loadedVolume( new Carna::base::model::UInt16Volume( size, new Carna::base::Composition< Carna::base::model::UInt16Volume::BufferType >( buffer ) ) );
+
+    /* Read blocks of whole voxels and swap their bytes in place.
+     */
+    const static unsigned int BLOCK_VOXELS = 1 << 22;
+
+    file.seek( dataOffset );
+
+    for( qint64 first = 0; first < voxelsCount; first += BLOCK_VOXELS )
+    {
+        if( isCanceled() )
+        {
+            return nullptr;
+        }
+
+        const unsigned int count = static_cast< unsigned int >( std::min< qint64 >( BLOCK_VOXELS, voxelsCount - first ) );
+        Voxel* const out = &( *buffer )[ static_cast< std::size_t >( first ) ];
+        if( file.read( reinterpret_cast< char* >( out ), count * sizeof( Voxel ) ) != static_cast< qint64 >( count * sizeof( Voxel ) ) )
+        {
+            throw std::runtime_error( "Native volume dump smaller than expected." );
+        }
+
+        const Slabs chunks( count, 1 << 16 );
+        chunks.process( [&]( unsigned int, unsigned int begin, unsigned int end )
+            {
+                for( unsigned int i = begin; i < end; ++i )
+                {
+                    out[ i ] = static_cast< Voxel >( ( out[ i ] << 8 ) | ( out[ i ] >> 8 ) );
+                }
+            }
+        );
+
+        reportProgress( static_cast< double >( first + count ) / voxelsCount );
+    }
+
+    file.close();
+
+    return loadedVolume.release();
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// NativeDumpProcessor
+// ----------------------------------------------------------------------------------
+
+const std::string& NativeDumpProcessor::description()
+{
+    const static std::string description = "Native volume dump";
+    return description;
+}
+
+
+const std::string& NativeDumpProcessor::pattern()
+{
+    const static std::string pattern = "*.nvd";
+    return pattern;
+}
+
+
+void NativeDumpProcessor::doExport( Exporter& exporter )
+{
+    QFile& file = exporter.file();
+    file.open( QIODevice::WriteOnly | QIODevice::Truncate );
+
+    const bool complete = write( file, CarnaContextClient( exporter.server ).model(), exporter.parent, "Export Volume" );
+
+ // a partial dump cannot be mapped, hence it is dropped
+
+    file.close();
+    if( !complete )
+    {
+        file.remove();
+    }
+}
+
+
+bool NativeDumpProcessor::write( QFile& file, const Carna::base::model::Scene& model, QWidget* parent, const QString& title )
+{
+    const Carna::base::model::Volume& volume = model.volume();
+    const qint64 dataBytes = static_cast< qint64 >( volume.size.x ) * volume.size.y * volume.size.z
+        * sizeof( Carna::base::model::UInt16Volume::VoxelType );
+
+    QProgressDialog progress( "Writing " + DataSize( static_cast< unsigned long >( dataBytes ) ) + "...", "Abort", 0, volume.size.z - 1, parent );
+    progress.setWindowTitle( title );
+    progress.setWindowModality( Qt::WindowModal );
+    progress.show();
+
+    return write( file, model, [&]( double fraction )->bool
+        {
+            progress.setValue( static_cast< int >( fraction * ( volume.size.z - 1 ) + 0.5 ) );
+            return !progress.wasCanceled();
+        }
+    );
+}
+
+
+bool NativeDumpProcessor::write( QFile& file, const Carna::base::model::Scene& model, const Progress& progress )
+{
+    return write
+        ( file
+        , model.volume()
+        , Carna::base::Vector( model.spacingX(), model.spacingY(), model.spacingZ() )
+        , model.recommendedVoidThreshold()
+        , progress );
+}
+
+
+bool NativeDumpProcessor::write( QFile& file
+                               , const Carna::base::model::Volume& volume
+                               , const Carna::base::Vector& spacing
+                               , int voidThreshold
+                               , const Progress& progress )
+{
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+    const qint64 sliceBytes = static_cast< qint64 >( volume.size.x ) * volume.size.y * sizeof( Voxel );
+
+ // write header
+
+    QDataStream out( &file );
+    out.writeRawData( NATIVE_DUMP_MAGIC, sizeof( NATIVE_DUMP_MAGIC ) );
+    out << NATIVE_DUMP_UINT16_ENCODING << nativeDumpByteOrder() << NATIVE_DUMP_ALIGNMENT;
+    out << static_cast< uint32_t >( volume.size.x )
+        << static_cast< uint32_t >( volume.size.y )
+        << static_cast< uint32_t >( volume.size.z );
+    out << static_cast< double >( spacing.x() )
+        << static_cast< double >( spacing.y() )
+        << static_cast< double >( spacing.z() );
+    out << static_cast< int32_t >( voidThreshold );
+
+    const uint64_t dataOffset = ( ( file.pos() + sizeof( uint64_t ) + NATIVE_DUMP_ALIGNMENT - 1 ) / NATIVE_DUMP_ALIGNMENT ) * NATIVE_DUMP_ALIGNMENT;
+    out << static_cast< quint64 >( dataOffset );
+
+    const std::vector< char > padding( static_cast< std::size_t >( dataOffset - file.pos() ), 0 );
+    if( file.write( &padding.front(), padding.size() ) != static_cast< qint64 >( padding.size() ) )
+    {
+        return false;
+    }
+
+ // dump data
+
+    /* The rows are copied as they are, since the encoding equals the one in memory.
+     */
+    const VolumeRows rows( volume );
+    std::vector< Voxel > slice( static_cast< std::size_t >( volume.size.x ) * volume.size.y );
+
+    for( unsigned int z = 0; z < volume.size.z; ++z )
+    {
+        const Slabs slabs( volume.size.y, 16 );
+        slabs.process( [&]( unsigned int, unsigned int y0, unsigned int y1 )
+            {
+                std::vector< Voxel > scratch;
+                for( unsigned int y = y0; y < y1; ++y )
+                {
+                    std::memcpy( &slice[ y * volume.size.x ], rows.row( y, z, scratch ), volume.size.x * sizeof( Voxel ) );
+                }
+            }
+        );
+
+        if( file.write( reinterpret_cast< const char* >( &slice.front() ), sliceBytes ) != sliceBytes )
+        {
+            return false;
+        }
+
+        if( progress && !progress( ( z + 1. ) / volume.size.z ) )
+        {
+            return false;
+        }
+    }
+
+    return file.flush();
+}
+
+
+Carna::base::model::Scene* NativeDumpProcessor::map( const QString& fileName )
+{
+    QFile file( fileName );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        throw std::runtime_error( "Failed to open native volume dump." );
+    }
+
+    NativeDumpHeader header;
+    readNativeDumpHeader( file, header );
+    file.close();
+
+    if( header.byteOrder != nativeDumpByteOrder() )
+    {
+        throw std::runtime_error( "Native volume dump was written in the other byte order." );
+    }
+
+    const Carna::base::Vector3ui size( header.width, header.height, header.depth );
+    Carna::base::model::Volume* const volume = new MappedVolume( fileName, header.dataOffset, size );
+
+    Carna::base::model::Scene* const model = new Carna::base::model::Scene
+        ( new Carna::base::Composition< Carna::base::model::Volume >( volume )
+        , header.spacingX
+        , header.spacingY
+        , header.spacingZ );
+
+    model->setRecommendedVoidThreshold( header.voidThreshold );
+    return model;
+}
+
+
+ImportJob* NativeDumpProcessor::doImport( Importer& importer )
+{
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+    QFile& file = importer.file();
+    file.open( QIODevice::ReadOnly );
+
+    NativeDumpHeader header;
+    readNativeDumpHeader( file, header );
+
+    const qint64 dataBytes = static_cast< qint64 >( header.width ) * header.height * header.depth * sizeof( Voxel );
+
+ // map or read the data in the background
+
+    return new NativeDumpImportJob
+        ( file
+        , header.dataOffset
+        , Carna::base::Vector3ui( header.width, header.height, header.depth )
+        , header.byteOrder != nativeDumpByteOrder()
+        , header.voidThreshold
+        , "Reading " + DataSize( static_cast< unsigned long >( dataBytes ) ) + "..."
+        , header.spacingX
+        , header.spacingY
+        , header.spacingZ );
+}
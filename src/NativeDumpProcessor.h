@@ -0,0 +1,103 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "ExportProcessor.h"
+#include "ImportProcessor.h"
+#include <Carna/Carna.h>
+#include <Carna/base/Transformation.h>
+#include <functional>
+
+class QFile;
+class QString;
+class QWidget;
+
+
+
+// ----------------------------------------------------------------------------------
+// NativeDumpProcessor
+// ----------------------------------------------------------------------------------
+
+/** \brief  Processes \c *.nvd exports and imports, which hold the voxels in the
+  *         encoding of \c UInt16Volume.
+  *
+  * The file starts with a big-endian header, which declares the encoding, the byte
+  * order and the alignment of the voxel data:
+  *
+  * | Field            | Type        | Value                                   |
+  * |------------------|-------------|-----------------------------------------|
+  * | magic            | 4 bytes     | \c NVD1                                 |
+  * | encoding         | \c uint16_t | \c 1 for \f$(\mathrm{huv}+1024) \cdot 2^4\f$ |
+  * | byte order       | \c uint16_t | \c 0 for little-endian, \c 1 for big-endian |
+  * | alignment        | \c uint32_t | alignment of the data offset in bytes   |
+  * | size             | 3 \c uint32_t | width, height, depth                  |
+  * | spacing          | 3 \c double | millimeters per voxel                   |
+  * | void threshold   | \c int32_t  | recommended void threshold in HUV       |
+  * | data offset      | \c uint64_t | position of the first voxel             |
+  *
+  * Dumps in the byte order of this machine are imported without copying through a
+  * \ref MappedVolume. Others are read and converted.
+  */
+class NativeDumpProcessor : public ExportProcessor, public ImportProcessor
+{
+
+public:
+
+    virtual const std::string& description() override;
+
+    virtual const std::string& pattern() override;
+
+
+    virtual void doExport( Exporter& ) override;
+
+    virtual ImportJob* doImport( Importer& ) override;
+
+
+    /** \brief  Writes \a model to the beginning of \a file, which must be open for
+      *         writing, while a progress dialog with the given \a title is shown.
+      *
+      * Returns \c false if the user canceled or the file could not be written. The
+      * partial dump is left to the caller.
+      */
+    static bool write( QFile& file, const Carna::base::model::Scene& model, QWidget* parent, const QString& title );
+
+    /** \brief  Is told the written fraction of the dump and returns whether writing
+      *         shall go on.
+      */
+    typedef std::function< bool( double ) > Progress;
+
+    /** \brief  Writes \a model to the beginning of \a file, which must be open for
+      *         writing, without any user interface, so that it may run on a worker
+      *         thread.
+      *
+      * Returns \c false if \a progress stopped it or the file could not be written.
+      * The partial dump is left to the caller.
+      */
+    static bool write( QFile& file, const Carna::base::model::Scene& model, const Progress& progress );
+
+    /** \brief  Writes \a volume, whose voxels are \a spacing millimeters apart, with
+      *         the given \a voidThreshold like \ref write does with some scene.
+      */
+    static bool write( QFile& file
+                     , const Carna::base::model::Volume& volume
+                     , const Carna::base::Vector& spacing
+                     , int voidThreshold
+                     , const Progress& progress );
+
+    /** \brief  Maps the dump \a fileName, which must be in the byte order of this
+      *         machine, and returns the model it describes.
+      *
+      * \throws std::runtime_error  if the file is no valid dump or not mapable.
+      */
+    static Carna::base::model::Scene* map( const QString& fileName );
+    
+}; // NativeDumpProcessor
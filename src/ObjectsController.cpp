@@ -16,6 +16,7 @@
 #include "Object3DEditorFactory.h"
 #include "PointCloud3D.h"
 #include "CarnaContextClient.h"
+#include "PointCloudParser.h"
 #include <Carna/base/model/Object3D.h>
 #include <Carna/base/view/Point3D.h>
 #include <Carna/base/view/Polyline.h>
@@ -34,6 +35,9 @@
 #include <QRegExp>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 #ifndef NO_CRA
 #include "Pointer3D.h"
@@ -201,6 +205,76 @@ PolylineImportConfiguration* PolylineImportConfiguration::createFromUserPrompt(
 
 
 
+// ----------------------------------------------------------------------------------
+// readDelimitedPolylineVertices
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads the vertices from \a data if it holds three coordinates per line,
+  *         which are separated by whitespace, commas or semicolons.
+  *
+  * A leading line which does not start with a number, like CSV column titles, is
+  * skipped. The layout is only accepted if \a vertexRegex captures the coordinates
+  * of the first vertex, so that the result is the same as with the regex.
+  *
+  * \returns \c false if \a data has some other layout.
+  */
+static bool readDelimitedPolylineVertices( const QByteArray& data, const QRegExp& vertexRegex, std::vector< Carna::base::Vector >& vertices )
+{
+    const char* begin = data.constData();
+    const char* const end = begin + data.size();
+
+ // skip column titles
+
+    const char* const firstLineEnd = std::find( begin, end, '\n' );
+    const char* p = begin;
+    while( p != firstLineEnd && ( *p == ' ' || *p == '\t' ) )
+    {
+        ++p;
+    }
+    double number;
+    if( !PointCloudParser::parseNumber( p, firstLineEnd, number ) )
+    {
+        begin = firstLineEnd == end ? end : firstLineEnd + 1;
+    }
+
+ // tokenize all lines
+
+    try
+    {
+        PointCloudParser::parseText( begin, end, vertices );
+    }
+    catch( const std::runtime_error& )
+    {
+        return false;
+    }
+    if( vertices.empty() || vertexRegex.captureCount() != 3 )
+    {
+        return false;
+    }
+
+ // check the first vertex against the regex
+
+    const static int PREFIX_SIZE = 1 << 12;
+    const QString prefix = QString::fromLocal8Bit( data.constData(), std::min( data.size(), PREFIX_SIZE ) );
+    if( vertexRegex.indexIn( prefix ) == -1 )
+    {
+        return false;
+    }
+    for( unsigned int axis = 0; axis < 3; ++axis )
+    {
+        bool ok;
+        const double expected = vertexRegex.cap( axis + 1 ).toDouble( &ok );
+        if( !ok || std::abs( expected - vertices.front()[ axis ] ) > 1e-9 * std::max( 1., std::abs( expected ) ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
 // ----------------------------------------------------------------------------------
 // ObjectsController
 // ----------------------------------------------------------------------------------
@@ -478,8 +552,7 @@ void ObjectsController::importPolyline()
         return;
     }
 
-    QTextStream in( &file );
-    const QString text = in.readAll();
+    const QByteArray data = file.readAll();
     file.close();
 
     struct number_format_exception {};
@@ -503,53 +576,71 @@ void ObjectsController::importPolyline()
 
     QApplication::setOverrideCursor( Qt::WaitCursor );
 
-    try
+    std::vector< Carna::base::Vector > vertices;
+    if( !readDelimitedPolylineVertices( data, setup->getVertexRegex(), vertices ) )
     {
-        int currentPosition = 0;
-        while( ( currentPosition = setup->getVertexRegex().indexIn( text, currentPosition ) ) != -1 )
+        vertices.clear();
+
+        const QString text = QString::fromLocal8Bit( data.constData(), data.size() );
+        try
         {
-            if( setup->getVertexRegex().captureCount() != 3 )
+            int currentPosition = 0;
+            while( ( currentPosition = setup->getVertexRegex().indexIn( text, currentPosition ) ) != -1 )
             {
-                QMessageBox::critical( this, dialogTitle, "Must capture exactly 3 groups per vertex, but did " + QString::number( setup->getVertexRegex().captureCount() ) + "." );
-                return;
-            }
+                if( setup->getVertexRegex().captureCount() != 3 )
+                {
+                    QApplication::restoreOverrideCursor();
+                    QMessageBox::critical( this, dialogTitle, "Must capture exactly 3 groups per vertex, but did " + QString::number( setup->getVertexRegex().captureCount() ) + "." );
+                    delete line;
+                    return;
+                }
 
-            bool ok = true;
+                bool ok = true;
 
-            const double x = setup->getVertexRegex().cap( 1 ).toDouble( &ok );
-            if( !ok ) throw number_format_exception();
+                const double x = setup->getVertexRegex().cap( 1 ).toDouble( &ok );
+                if( !ok ) throw number_format_exception();
 
-            const double y = setup->getVertexRegex().cap( 2 ).toDouble( &ok );
-            if( !ok ) throw number_format_exception();
+                const double y = setup->getVertexRegex().cap( 2 ).toDouble( &ok );
+                if( !ok ) throw number_format_exception();
 
-            const double z = setup->getVertexRegex().cap( 3 ).toDouble( &ok );
-            if( !ok ) throw number_format_exception();
+                const double z = setup->getVertexRegex().cap( 3 ).toDouble( &ok );
+                if( !ok ) throw number_format_exception();
 
-            switch( setup->getUnits() )
-            {
+                vertices.push_back( Carna::base::Vector( x, y, z ) );
 
-                case PolylineImportConfiguration::millimeters:
-                {
-                    ( *line ) << Carna::base::model::Position::fromMillimeters( model, x, y, z );
-                    break;
-                }
+                currentPosition += setup->getVertexRegex().matchedLength();
+            }
+        }
+        catch( const number_format_exception& )
+        {
+            QApplication::restoreOverrideCursor();
+            QMessageBox::critical( this, dialogTitle, "Failed to parse coordinate: not a number." );
+            delete line;
+            return;
+        }
+    }
 
-                case PolylineImportConfiguration::volumeUnits:
-                {
-                    ( *line ) << Carna::base::model::Position::fromVolumeUnits( model, x, y, z );
-                    break;
-                }
+ // append vertices
+
+    for( auto vertex = vertices.begin(); vertex != vertices.end(); ++vertex )
+    {
+        switch( setup->getUnits() )
+        {
 
+            case PolylineImportConfiguration::millimeters:
+            {
+                ( *line ) << Carna::base::model::Position::fromMillimeters( model, vertex->x(), vertex->y(), vertex->z() );
+                break;
+            }
+
+            case PolylineImportConfiguration::volumeUnits:
+            {
+                ( *line ) << Carna::base::model::Position::fromVolumeUnits( model, vertex->x(), vertex->y(), vertex->z() );
+                break;
             }
 
-            currentPosition += setup->getVertexRegex().matchedLength();
         }
     }
-    catch( const number_format_exception& )
-    {
-        QMessageBox::critical( this, dialogTitle, "Failed to parse coordinate: not a number." );
-        delete line;
-    }
 
     QApplication::restoreOverrideCursor();
 }
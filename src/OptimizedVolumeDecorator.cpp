@@ -10,8 +10,212 @@
  */
 
 #include "OptimizedVolumeDecorator.h"
-#include "CarnaContextClient.h"
-#include <Carna/base/model/Scene.h>
+#include "VolumeRows.h"
+#include <Carna/base/CarnaException.h>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThreadStorage>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <list>
+
+
+
+/** \brief  Runs some function on a thread pool.
+  */
+class OptimizedVolumeDecoratorTask : public QRunnable
+{
+
+public:
+
+    explicit OptimizedVolumeDecoratorTask( const std::function< void() >& job )
+        : job( job )
+    {
+    }
+
+    virtual void run() override
+    {
+        job();
+    }
+
+private:
+
+    const std::function< void() > job;
+
+}; // OptimizedVolumeDecoratorTask
+
+
+
+// ----------------------------------------------------------------------------------
+// OptimizedVolumeDecorator :: Cache
+// ----------------------------------------------------------------------------------
+
+struct OptimizedVolumeDecorator::Cache
+{
+
+    const static unsigned int SHARDS = 16;
+
+    const static unsigned int AXIS_BITS = 21;
+
+    struct Entry
+    {
+        std::shared_ptr< const Brick > brick;
+        std::list< BrickKey >::iterator position;
+    };
+
+    /** \brief  Holds the bricks whose keys hash to the same shard.
+      *
+      * The most recently used key is at the front of \c lru, while \c prefetched
+      * holds the keys of the bricks which are about to be prefetched.
+      */
+    struct Shard
+    {
+        Shard() : hits( 0 ), misses( 0 )
+        {
+        }
+
+        QMutex lock;
+        std::list< BrickKey > lru;
+        std::unordered_map< BrickKey, Entry > entries;
+        std::unordered_set< BrickKey > prefetched;
+        unsigned long hits;
+        unsigned long misses;
+    };
+
+    /** \brief  Holds the brick which some thread has accessed last, together with
+      *         the hits on it which are not yet added to any shard.
+      */
+    struct LastBrick
+    {
+        LastBrick() : key( 0 ), hits( 0 )
+        {
+        }
+
+        BrickKey key;
+        std::shared_ptr< const Brick > brick;
+        unsigned long hits;
+    };
+
+    /** \brief  Holds the last bricks of some thread by the \ref id of their
+      *         decorators.
+      *
+      * The lock is only contended while some decorator is destroyed.
+      */
+    struct ThreadState
+    {
+        QMutex lock;
+        std::map< int, LastBrick > lastBricks;
+    };
+
+    Cache( unsigned int maxBricks )
+        : capacity( std::max( 1u, ( maxBricks + SHARDS - 1 ) / SHARDS ) )
+        , id( nextId.fetchAndAddOrdered( 1 ) )
+        , prefetching( 1 )
+    {
+    }
+
+    const std::size_t capacity;
+
+    /** \brief  Identifies the decorator within the \ref ThreadState "thread states".
+      *
+      * Identifiers are never reused, so that no state of some destroyed decorator is
+      * ever taken for the state of another one.
+      */
+    const int id;
+
+    Shard shards[ SHARDS ];
+
+    QThreadPool prefetcher;
+
+    /** \brief  Is read by the threads which request prefetches, hence it is
+      *         accessed atomically.
+      */
+    QAtomicInt prefetching;
+
+    static QAtomicInt nextId;
+
+    /** \brief  Holds the state of each thread, which is deleted when the thread
+      *         exits.
+      */
+    static QThreadStorage< std::shared_ptr< ThreadState >* > threadStates;
+
+    /** \brief  References the states of all threads, so that \ref forget reaches
+      *         them.
+      */
+    static std::vector< std::weak_ptr< ThreadState > > registry;
+
+    static QMutex registryLock;
+
+    /** \brief  Returns the state of the calling thread.
+      */
+    static ThreadState& localState()
+    {
+        std::shared_ptr< ThreadState >* state = threadStates.localData();
+        if( state == nullptr )
+        {
+            state = new std::shared_ptr< ThreadState >( new ThreadState() );
+            threadStates.setLocalData( state );
+
+            QMutexLocker lock( &registryLock );
+            registry.push_back( *state );
+        }
+        return **state;
+    }
+
+    /** \brief  Drops the last bricks of the decorator \a id from the states of all
+      *         threads.
+      */
+    static void forget( int id )
+    {
+        QMutexLocker lock( &registryLock );
+        for( auto entry = registry.begin(); entry != registry.end(); )
+        {
+            const std::shared_ptr< ThreadState > state = entry->lock();
+            if( state.get() == nullptr )
+            {
+                entry = registry.erase( entry );
+            }
+            else
+            {
+                QMutexLocker stateLock( &state->lock );
+                state->lastBricks.erase( id );
+                ++entry;
+            }
+        }
+    }
+
+    static BrickKey key( unsigned int bx, unsigned int by, unsigned int bz )
+    {
+        return ( static_cast< BrickKey >( bz ) << ( 2 * AXIS_BITS ) )
+             | ( static_cast< BrickKey >( by ) <<       AXIS_BITS   )
+             |   static_cast< BrickKey >( bx );
+    }
+
+    Shard& shard( BrickKey key )
+    {
+        key ^= key >> 29;
+        key *= 0xBF58476D1CE4E5B9ULL;
+        key ^= key >> 32;
+        return shards[ key % SHARDS ];
+    }
+
+}; // OptimizedVolumeDecorator :: Cache
+
+
+QAtomicInt OptimizedVolumeDecorator::Cache::nextId( 0 );
+
+QThreadStorage< std::shared_ptr< OptimizedVolumeDecorator::Cache::ThreadState >* > OptimizedVolumeDecorator::Cache::threadStates;
+
+std::vector< std::weak_ptr< OptimizedVolumeDecorator::Cache::ThreadState > > OptimizedVolumeDecorator::Cache::registry;
+
+QMutex OptimizedVolumeDecorator::Cache::registryLock;
 
 
 
@@ -23,27 +227,29 @@ OptimizedVolumeDecorator::OptimizedVolumeDecorator
     ( Carna::base::Association< const Carna::base::model::Volume >* originalPtr
     , float spacingX
     , float spacingY
-    , float spacingZ )
+    , float spacingZ
+    , double brickSizeMillimeters
+    , unsigned int maxBricks )
 
     : Volume( originalPtr->get()->size )
+    , brickSize
+        ( std::max( 1u, static_cast< unsigned int >( std::ceil( brickSizeMillimeters / spacingX ) ) )
+        , std::max( 1u, static_cast< unsigned int >( std::ceil( brickSizeMillimeters / spacingY ) ) )
+        , std::max( 1u, static_cast< unsigned int >( std::ceil( brickSizeMillimeters / spacingZ ) ) ) )
+    , maxBricks( maxBricks )
     , originalPtr( originalPtr )
-    , bufferIsValid( false )
+    , cache( new Cache( maxBricks ) )
     , spacingX( spacingX )
     , spacingY( spacingY )
     , spacingZ( spacingZ )
 {
-    static const double BUFFER_SIZE_MILLIMETERS = 20.;
-
-    const unsigned int sx = static_cast< unsigned int>( std::ceil( BUFFER_SIZE_MILLIMETERS / spacingX ) + 0.1 );
-    const unsigned int sy = static_cast< unsigned int>( std::ceil( BUFFER_SIZE_MILLIMETERS / spacingY ) + 0.1 );
-    const unsigned int sz = static_cast< unsigned int>( std::ceil( BUFFER_SIZE_MILLIMETERS / spacingZ ) + 0.1 );
-
-    buffer.reset( new Carna::base::model::UInt16Volume( Carna::base::Vector3ui( sx, sy, sz ) ) );
 }
 
 
 OptimizedVolumeDecorator::~OptimizedVolumeDecorator()
 {
+    cache->prefetcher.waitForDone();
+    Cache::forget( cache->id );
 }
 
 
@@ -70,95 +276,200 @@ signed short OptimizedVolumeDecorator::operator()
     , unsigned int y
     , unsigned int z ) const
 {
-    if( !testCacheHit( x, y, z ) )
+    /* Consecutive accesses mostly hit the same brick. Hence each thread remembers
+     * the brick it has accessed last, so that neither the shard lock is taken nor
+     * the LRU order is updated until the thread moves on to another brick.
+     */
+    Cache::ThreadState& state = Cache::localState();
+    QMutexLocker stateLock( &state.lock );
+    Cache::LastBrick* const last = &state.lastBricks[ cache->id ];
+
+    const BrickKey key = Cache::key( x / brickSize.x, y / brickSize.y, z / brickSize.z );
+    if( last->brick.get() == nullptr || last->key != key )
+    {
+        last->brick = brick( key, true, last->hits );
+        last->key   = key;
+        last->hits  = 0;
+    }
+    else
     {
-        unsigned int dx = 0, dy = 0, dz = 0;
-        const unsigned int x0 = bufferX, y0 = bufferY, z0 = bufferZ;
-        const unsigned int x1 = x0 + buffer->size.x, y1 = y0 + buffer->size.y, z1 = z0 + buffer->size.z;
+        ++last->hits;
+    }
 
-        if( x < x0 )
-        {
-            dx = x0 - x;
-        }
-        else
-        if( x >= x1 )
-        {
-            dx = 1 + x - x1;
-        }
-        
-        if( y < y0 )
-        {
-            dy = y0 - y;
-        }
-        else
-        if( y >= y1 )
-        {
-            dy = 1 + y - y1;
-        }
-        
-        if( z < z0 )
+    const unsigned int i = x % brickSize.x + brickSize.x * ( y % brickSize.y + brickSize.y * ( z % brickSize.z ) );
+    return VolumeRows::decode( ( *last->brick )[ i ] );
+}
+
+
+std::shared_ptr< const OptimizedVolumeDecorator::Brick > OptimizedVolumeDecorator::brick( BrickKey key, bool countAccess, unsigned long pendingHits ) const
+{
+    Cache::Shard& shard = cache->shard( key );
+    {
+        QMutexLocker lock( &shard.lock );
+
+        shard.hits += pendingHits;
+
+        const auto entry = shard.entries.find( key );
+        if( entry != shard.entries.end() )
         {
-            dz = z0 - z;
+            if( countAccess )
+            {
+                ++shard.hits;
+            }
+            shard.lru.splice( shard.lru.begin(), shard.lru, entry->second.position );
+            return entry->second.brick;
         }
-        else
-        if( z >= z1 )
+
+        if( countAccess )
         {
-            dz = 1 + z - z1;
+            ++shard.misses;
         }
+    }
+
+    /* The brick is loaded without holding the lock. If another thread loads the same
+     * brick meanwhile, the brick which is inserted first is kept.
+     */
+    const std::shared_ptr< const Brick > loaded( loadBrick( key ) );
+
+    QMutexLocker lock( &shard.lock );
+
+    const auto inserted = shard.entries.insert( std::make_pair( key, Cache::Entry() ) );
+    if( !inserted.second )
+    {
+        return inserted.first->second.brick;
+    }
 
-        qWarning
-            ( "OptimizedVolumeDecorator: Cache Miss! dx = %f mm, dy = %f mm, dz = %f mm"
-            , dx * spacingX
-            , dy * spacingY
-            , dz * spacingZ );
+    shard.lru.push_front( key );
+    inserted.first->second.brick = loaded;
+    inserted.first->second.position = shard.lru.begin();
 
-        updateCache( x, y, z );
+    while( shard.lru.size() > cache->capacity )
+    {
+        shard.entries.erase( shard.lru.back() );
+        shard.lru.pop_back();
     }
 
-    return ( *buffer )( x - bufferX, y - bufferY, z - bufferZ );
+    return loaded;
 }
 
 
-bool OptimizedVolumeDecorator::testCacheHit( unsigned int x, unsigned int y, unsigned int z ) const
+OptimizedVolumeDecorator::Brick* OptimizedVolumeDecorator::loadBrick( BrickKey key ) const
 {
-    return bufferIsValid && !(
-        x < bufferX || x >= bufferX + buffer->size.x ||
-        y < bufferY || y >= bufferY + buffer->size.y ||
-        z < bufferZ || z >= bufferZ + buffer->size.z );
+    const BrickKey axisMask = ( BrickKey( 1 ) << Cache::AXIS_BITS ) - 1;
+    const unsigned int x0 = static_cast< unsigned int >(   key                              & axisMask ) * brickSize.x;
+    const unsigned int y0 = static_cast< unsigned int >( ( key >>       Cache::AXIS_BITS  ) & axisMask ) * brickSize.y;
+    const unsigned int z0 = static_cast< unsigned int >( ( key >> ( 2 * Cache::AXIS_BITS ) ) & axisMask ) * brickSize.z;
+
+    CARNA_ASSERT( x0 < size.x && y0 < size.y && z0 < size.z );
+
+    const unsigned int width = std::min( brickSize.x, size.x - x0 );
+    const unsigned int y1    = std::min( y0 + brickSize.y, size.y );
+    const unsigned int z1    = std::min( z0 + brickSize.z, size.z );
+
+    Brick* const result = new Brick( brickSize.x * brickSize.y * brickSize.z, VolumeRows::encode( -1024 ) );
+
+    const VolumeRows rows( original() );
+    std::vector< VolumeRows::Voxel > scratch;
+    for( unsigned int z = z0; z < z1; ++z )
+    for( unsigned int y = y0; y < y1; ++y )
+    {
+        std::memcpy
+            ( &( *result )[ brickSize.x * ( ( y - y0 ) + brickSize.y * ( z - z0 ) ) ]
+            , rows.row( y, z, scratch ) + x0
+            , width * sizeof( VolumeRows::Voxel ) );
+    }
+
+    return result;
 }
 
 
-void OptimizedVolumeDecorator::updateCache( unsigned int x, unsigned int y, unsigned int z ) const
+bool OptimizedVolumeDecorator::isPrefetching() const
 {
-    bufferX = Carna::base::Math::clamp( signed( x ) - signed( buffer->size.x / 2 ), 0, signed( original().size.x - 1 - buffer->size.x ) );
-    bufferY = Carna::base::Math::clamp( signed( y ) - signed( buffer->size.y / 2 ), 0, signed( original().size.y - 1 - buffer->size.y ) );
-    bufferZ = Carna::base::Math::clamp( signed( z ) - signed( buffer->size.z / 2 ), 0, signed( original().size.z - 1 - buffer->size.z ) );
+    return cache->prefetching.fetchAndAddOrdered( 0 ) != 0;
+}
+
+
+void OptimizedVolumeDecorator::setPrefetching( bool prefetching )
+{
+    cache->prefetching.fetchAndStoreOrdered( prefetching ? 1 : 0 );
+}
+
+
+void OptimizedVolumeDecorator::prefetch( const Carna::base::Vector& millimeters, double marginMillimeters ) const
+{
+    if( !isPrefetching() )
+    {
+        return;
+    }
+
+    const float spacing[ 3 ] = { spacingX, spacingY, spacingZ };
+    const unsigned int extent[ 3 ] = { size.x, size.y, size.z };
+    const unsigned int bricks[ 3 ] = { brickSize.x, brickSize.y, brickSize.z };
 
-    const Carna::base::model::UInt16Volume* const original = dynamic_cast< const Carna::base::model::UInt16Volume* >( &this->original() );
-    if( original != nullptr )
+    unsigned int first[ 3 ], last[ 3 ];
+    for( unsigned int i = 0; i < 3; ++i )
     {
-        for( unsigned int z = bufferZ; z < bufferZ + buffer->size.z; ++z )
-        for( unsigned int y = bufferY; y < bufferY + buffer->size.y; ++y )
+        const double lower = ( millimeters[ i ] - marginMillimeters ) / spacing[ i ];
+        const double upper = ( millimeters[ i ] + marginMillimeters ) / spacing[ i ];
+        if( upper < 0 || lower > extent[ i ] - 1. )
         {
-            const unsigned int src_index = bufferX + y * original->size.x + z * original->size.x * original->size.y;
-            const unsigned int dst_index = ( y - bufferY ) * buffer->size.x + ( z - bufferZ ) * buffer->size.x * buffer->size.y;
-
-            CARNA_ASSERT( src_index >= 0 && src_index + buffer->size.x <= original->getBuffer().size() );
-            CARNA_ASSERT( dst_index >= 0 && dst_index + buffer->size.x <= buffer->getBuffer().size() );
-
-#if 0
-            std::copy
-                ( original->getBuffer().begin() + src_index
-                , original->getBuffer().begin() + src_index + buffer->size.x
-                , buffer->getBuffer().begin() + dst_index );
-#else
-            memcpy
-                ( &buffer->getBuffer()[ dst_index ]
-                , &original->getBuffer()[ src_index ]
-                , buffer->size.x * 2 /*bytes per element*/ );
-#endif
+            return;
         }
+        first[ i ] = static_cast< unsigned int >( std::max( 0., lower ) ) / bricks[ i ];
+        last [ i ] = static_cast< unsigned int >( std::min( extent[ i ] - 1., upper ) ) / bricks[ i ];
+    }
+
+    for( unsigned int bz = first[ 2 ]; bz <= last[ 2 ]; ++bz )
+    for( unsigned int by = first[ 1 ]; by <= last[ 1 ]; ++by )
+    for( unsigned int bx = first[ 0 ]; bx <= last[ 0 ]; ++bx )
+    {
+        const BrickKey key = Cache::key( bx, by, bz );
+        Cache::Shard& shard = cache->shard( key );
+        {
+            QMutexLocker lock( &shard.lock );
+            if( shard.entries.find( key ) != shard.entries.end() || !shard.prefetched.insert( key ).second )
+            {
+                continue;
+            }
+        }
+        cache->prefetcher.start( new OptimizedVolumeDecoratorTask( [this, key, &shard]()
+            {
+                try
+                {
+                    brick( key, false, 0 );
+                }
+                catch( ... )
+                {
+                    /* Prefetching is best-effort. The brick is loaded on access otherwise.
+                     */
+                }
+                QMutexLocker lock( &shard.lock );
+                shard.prefetched.erase( key );
+            }
+        ) );
+    }
+}
+
 
-        bufferIsValid = true;
+unsigned long OptimizedVolumeDecorator::hits() const
+{
+    unsigned long hits = 0;
+    for( unsigned int i = 0; i < Cache::SHARDS; ++i )
+    {
+        QMutexLocker lock( &cache->shards[ i ].lock );
+        hits += cache->shards[ i ].hits;
+    }
+    return hits;
+}
+
+
+unsigned long OptimizedVolumeDecorator::misses() const
+{
+    unsigned long misses = 0;
+    for( unsigned int i = 0; i < Cache::SHARDS; ++i )
+    {
+        QMutexLocker lock( &cache->shards[ i ].lock );
+        misses += cache->shards[ i ].misses;
     }
+    return misses;
 }
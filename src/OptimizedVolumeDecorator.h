@@ -14,7 +14,12 @@
 #include <Carna/base/model/Volume.h>
 #include <Carna/Carna.h>
 #include <Carna/base/Association.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/Transformation.h>
 #include <Carna/base/model/UInt16Volume.h>
+#include <memory>
+#include <vector>
+#include <cstdint>
 
 
 
@@ -22,22 +27,53 @@
 // OptimizedVolumeDecorator
 // ----------------------------------------------------------------------------------
 
+/** \brief  Serves the voxels of some volume from a cache of bricks.
+  *
+  * The volume is partitioned into a grid of bricks. Recently used bricks are kept
+  * within a least-recently-used cache, which is split into shards by the brick
+  * position, so that concurrent threads rarely contend for the same lock. Hence the
+  * voxels may be accessed from several threads at once, provided that the decorated
+  * volume may be, too. Each thread keeps a reference to the brick it accessed last,
+  * so that the cache is only consulted when the thread moves on to another brick.
+  * These references are released when the decorator is destroyed.
+  *
+  * Bricks can be \ref prefetch "prefetched" in the background, e.g. around the
+  * frontier of some graph search.
+  */
 class OptimizedVolumeDecorator : public Carna::base::model::Volume
 {
 
 public:
 
+    /** \brief  Instantiates.
+      *
+      * Each brick spans \a brickSizeMillimeters along each axis, while at most
+      * \a maxBricks bricks are cached.
+      */
     OptimizedVolumeDecorator
         ( Carna::base::Association< const Carna::base::model::Volume >*
         , float spacingX
         , float spacingY
-        , float spacingZ );
+        , float spacingZ
+        , double brickSizeMillimeters = 20.
+        , unsigned int maxBricks = 64 );
 
+    /** \brief  Waits for pending prefetches.
+      */
     virtual ~OptimizedVolumeDecorator();
     
     const Carna::base::model::Volume& original() const;
 
 
+    /** \brief  Holds the size of each brick in voxels.
+      */
+    const Carna::base::Vector3ui brickSize;
+
+    /** \brief  Holds the maximum number of cached bricks.
+      */
+    const unsigned int maxBricks;
+
+
     virtual void uploadTexture() const override;
 
     virtual signed short operator()
@@ -48,25 +84,58 @@ public:
     virtual signed short operator()( const Carna::base::Vector3ui& at ) const override;
 
 
-    bool testCacheHit( unsigned int x, unsigned int y, unsigned int z ) const;
+    /** \brief  Tells whether \ref prefetch has any effect.
+      */
+    bool isPrefetching() const;
+
+    /** \brief  Enables or disables \ref prefetch.
+      */
+    void setPrefetching( bool prefetching );
+
+    /** \brief  Loads the missing bricks, which intersect the cube of
+      *         \f$2 \cdot \mathrm{marginMillimeters}\f$ around \a millimeters, in the
+      *         background.
+      */
+    void prefetch( const Carna::base::Vector& millimeters, double marginMillimeters ) const;
+
 
-    void updateCache( unsigned int x, unsigned int y, unsigned int z ) const;
+    /** \brief  Tells how many voxel accesses were served by cached bricks.
+      *
+      * Repeated accesses to the same brick are counted once the accessing thread
+      * moves on to another brick.
+      */
+    unsigned long hits() const;
+
+    /** \brief  Tells how many voxel accesses required a brick to be loaded.
+      */
+    unsigned long misses() const;
 
 
 private:
 
-    const std::unique_ptr< Carna::base::Association< const Carna::base::model::Volume > > originalPtr;
+    typedef uint64_t BrickKey;
+
+    typedef std::vector< Carna::base::model::UInt16Volume::VoxelType > Brick;
 
-    mutable std::unique_ptr< Carna::base::model::UInt16Volume > buffer;
+    struct Cache;
 
-    mutable bool bufferIsValid;
+    const std::unique_ptr< Carna::base::Association< const Carna::base::model::Volume > > originalPtr;
 
-    mutable unsigned int bufferX;
-    mutable unsigned int bufferY;
-    mutable unsigned int bufferZ;
+    const std::unique_ptr< Cache > cache;
 
     const float spacingX;
     const float spacingY;
     const float spacingZ;
 
+    /** \brief  Returns the brick \a key, which is loaded if it is not cached.
+      *
+      * The \a pendingHits, which the calling thread has served from the brick it
+      * accessed before, are added to the hits.
+      */
+    std::shared_ptr< const Brick > brick( BrickKey key, bool countAccess, unsigned long pendingHits ) const;
+
+    /** \brief  Copies the voxels of the brick \a key from the original volume.
+      */
+    Brick* loadBrick( BrickKey key ) const;
+
 }; // OptimizedVolumeDecorator
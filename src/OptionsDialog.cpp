@@ -0,0 +1,165 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "OptionsDialog.h"
+#include "VolumeCache.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QDialogButtonBox>
+#include <QTabWidget>
+#include <QCheckBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDir>
+
+
+
+// ----------------------------------------------------------------------------------
+// OptionsDialog
+// ----------------------------------------------------------------------------------
+
+OptionsDialog::OptionsDialog( QWidget* parent, Qt::WindowFlags f )
+    : QDialog( parent, f )
+    , cache( new VolumeCache() )
+    , cbCacheEnabled( new QCheckBox( "&Keep converted DICOM series on disk" ) )
+    , leCacheDirectory( new QLineEdit() )
+    , sbCacheCapacity( new QSpinBox() )
+    , laCacheUsage( new QLabel() )
+{
+    this->setWindowTitle( "Settings" );
+    if( parent != nullptr )
+    {
+        this->setWindowModality( Qt::WindowModal );
+    }
+
+    QVBoxLayout* const global = new QVBoxLayout();
+    QTabWidget* const pages = new QTabWidget();
+
+    pages->addTab( createCachePage(), "Volume Cache" );
+
+ // put all together
+
+    global->addWidget( pages );
+
+ // dialog buttons
+
+    QDialogButtonBox* const buttons = new QDialogButtonBox( QDialogButtonBox::Ok | QDialogButtonBox::Cancel );
+    connect( buttons, SIGNAL( accepted() ), this, SLOT( accept() ) );
+    connect( buttons, SIGNAL( rejected() ), this, SLOT( reject() ) );
+
+    global->addWidget( buttons );
+
+    this->setLayout( global );
+}
+
+
+OptionsDialog::~OptionsDialog()
+{
+}
+
+
+QWidget* OptionsDialog::createCachePage()
+{
+    QWidget* const page = new QWidget();
+    QFormLayout* const form = new QFormLayout();
+
+ // enabled
+
+    cbCacheEnabled->setChecked( cache->isEnabled() );
+    form->addRow( cbCacheEnabled );
+
+ // directory
+
+    QWidget* const directory = new QWidget();
+    QHBoxLayout* const directoryLayout = new QHBoxLayout();
+    QPushButton* const buBrowse = new QPushButton( "&Browse..." );
+    directoryLayout->setContentsMargins( 0, 0, 0, 0 );
+    directoryLayout->addWidget( leCacheDirectory, 1 );
+    directoryLayout->addWidget( buBrowse );
+    directory->setLayout( directoryLayout );
+
+    leCacheDirectory->setText( QDir::toNativeSeparators( cache->directory() ) );
+    form->addRow( "&Directory:", directory );
+
+    connect( buBrowse, SIGNAL( clicked() ), this, SLOT( browseCacheDirectory() ) );
+
+ // capacity
+
+    sbCacheCapacity->setRange( 0, 1 << 20 );
+    sbCacheCapacity->setSingleStep( 512 );
+    sbCacheCapacity->setSuffix( " MB" );
+    sbCacheCapacity->setValue( static_cast< int >( cache->capacity() >> 20 ) );
+    form->addRow( "&Capacity:", sbCacheCapacity );
+
+ // usage
+
+    QWidget* const usage = new QWidget();
+    QHBoxLayout* const usageLayout = new QHBoxLayout();
+    QPushButton* const buClear = new QPushButton( "C&lear" );
+    usageLayout->setContentsMargins( 0, 0, 0, 0 );
+    usageLayout->addWidget( laCacheUsage, 1 );
+    usageLayout->addWidget( buClear );
+    usage->setLayout( usageLayout );
+
+    form->addRow( "Usage:", usage );
+    updateCacheUsage();
+
+    connect( buClear, SIGNAL( clicked() ), this, SLOT( clearCache() ) );
+
+    page->setLayout( form );
+    return page;
+}
+
+
+void OptionsDialog::browseCacheDirectory()
+{
+    const QString directory = QFileDialog::getExistingDirectory( this, "Volume Cache Directory", leCacheDirectory->text() );
+    if( !directory.isEmpty() )
+    {
+        leCacheDirectory->setText( QDir::toNativeSeparators( directory ) );
+    }
+}
+
+
+void OptionsDialog::clearCache()
+{
+    cache->clear();
+    updateCacheUsage();
+}
+
+
+void OptionsDialog::updateCacheUsage()
+{
+    laCacheUsage->setText( QString::number( cache->size() >> 20 ) + " MB" );
+}
+
+
+void OptionsDialog::accept()
+{
+    const QString directory = QDir::fromNativeSeparators( leCacheDirectory->text().trimmed() );
+    if( directory.isEmpty() )
+    {
+        QMessageBox::warning( this, "Settings", "The volume cache directory must be specified." );
+        return;
+    }
+
+    cache->setEnabled( cbCacheEnabled->isChecked() );
+    cache->setDirectory( directory );
+    cache->setCapacity( static_cast< qint64 >( sbCacheCapacity->value() ) << 20 );
+    cache->saveSettings();
+
+    QDialog::accept();
+}
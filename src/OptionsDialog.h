@@ -0,0 +1,78 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <QDialog>
+#include <memory>
+
+class VolumeCache;
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QSpinBox;
+
+
+
+// ----------------------------------------------------------------------------------
+// OptionsDialog
+// ----------------------------------------------------------------------------------
+
+/** \brief  Presents the application settings to the user.
+  *
+  * The settings are saved when the dialog is accepted.
+  *
+  * \see    \ref MainWindow
+  */
+class OptionsDialog : public QDialog
+{
+
+    Q_OBJECT
+
+public:
+
+    /** \brief  Instantiates.
+      */
+    OptionsDialog( QWidget* parent = nullptr, Qt::WindowFlags f = 0 );
+
+    virtual ~OptionsDialog();
+
+
+public slots:
+
+    virtual void accept() override;
+
+
+private slots:
+
+    void browseCacheDirectory();
+
+    void clearCache();
+
+    void updateCacheUsage();
+
+
+private:
+
+    const std::unique_ptr< VolumeCache > cache;
+
+    QCheckBox* const cbCacheEnabled;
+
+    QLineEdit* const leCacheDirectory;
+
+    QSpinBox* const sbCacheCapacity;
+
+    QLabel* const laCacheUsage;
+
+    QWidget* createCachePage();
+
+}; // OptionsDialog
@@ -0,0 +1,162 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "PackedMask.h"
+#include "RunLengthMask.h"
+#include "Slabs.h"
+#include <Carna/base/CarnaException.h>
+#include <memory>
+
+
+
+// ----------------------------------------------------------------------------------
+// PackedMask
+// ----------------------------------------------------------------------------------
+
+PackedMask::PackedMask( const Carna::base::Vector3ui& size )
+    : size( size )
+    , rowWords( ( size.x + WORD_BITS - 1 ) / WORD_BITS )
+    , data( static_cast< std::size_t >( ( size.x + WORD_BITS - 1 ) / WORD_BITS ) * size.y * size.z, 0 )
+{
+}
+
+
+PackedMask::PackedMask( const RunLengthMask& mask )
+    : size( mask.size )
+    , rowWords( ( size.x + WORD_BITS - 1 ) / WORD_BITS )
+    , data( static_cast< std::size_t >( ( size.x + WORD_BITS - 1 ) / WORD_BITS ) * size.y * size.z, 0 )
+{
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                mask.visitSpans( y, z, [&]( unsigned int x0, unsigned int x1 )
+                    {
+                        fill( y, z, x0, x1 );
+                    }
+                );
+            }
+        }
+    );
+}
+
+
+PackedMask::PackedMask( const Carna::base::model::BufferedMaskAdapter::BinaryMask& mask )
+    : size( mask.size )
+    , rowWords( ( size.x + WORD_BITS - 1 ) / WORD_BITS )
+    , data( static_cast< std::size_t >( ( size.x + WORD_BITS - 1 ) / WORD_BITS ) * size.y * size.z, 0 )
+{
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                Word* const bits = row( y, z );
+                for( unsigned int x = 0; x < size.x; ++x )
+                {
+                    if( mask( x, y, z ) )
+                    {
+                        bits[ x / WORD_BITS ] |= Word( 1 ) << ( x % WORD_BITS );
+                    }
+                }
+            }
+        }
+    );
+}
+
+
+PackedMask::~PackedMask()
+{
+}
+
+
+void PackedMask::fill( unsigned int y, unsigned int z, unsigned int x0, unsigned int x1 )
+{
+    CARNA_ASSERT( x0 <= x1 && x1 <= size.x );
+    if( x0 == x1 )
+    {
+        return;
+    }
+
+    Word* const bits = row( y, z );
+    const unsigned int w0 = x0 / WORD_BITS;
+    const unsigned int w1 = ( x1 - 1 ) / WORD_BITS;
+    const Word head = ~Word( 0 ) << ( x0 % WORD_BITS );
+    const Word tail = ~Word( 0 ) >> ( WORD_BITS - 1 - ( x1 - 1 ) % WORD_BITS );
+
+    if( w0 == w1 )
+    {
+        bits[ w0 ] |= head & tail;
+    }
+    else
+    {
+        bits[ w0 ] |= head;
+        for( unsigned int w = w0 + 1; w < w1; ++w )
+        {
+            bits[ w ] = ~Word( 0 );
+        }
+        bits[ w1 ] |= tail;
+    }
+}
+
+
+unsigned long PackedMask::count() const
+{
+    const Slabs slabs( size.z );
+    std::vector< unsigned long > counts( slabs.count(), 0 );
+    slabs.process( [&]( unsigned int slab, unsigned int z0, unsigned int z1 )
+        {
+            const std::size_t first = static_cast< std::size_t >( z0 ) * size.y * rowWords;
+            const std::size_t last  = static_cast< std::size_t >( z1 ) * size.y * rowWords;
+            unsigned long n = 0;
+            for( std::size_t i = first; i < last; ++i )
+            {
+                n += countBits( data[ i ] );
+            }
+            counts[ slab ] = n;
+        }
+    );
+
+    unsigned long n = 0;
+    for( unsigned int slab = 0; slab < slabs.count(); ++slab )
+    {
+        n += counts[ slab ];
+    }
+    return n;
+}
+
+
+Carna::base::model::BufferedMaskAdapter::BinaryMask* PackedMask::toBinaryMask() const
+{
+    typedef Carna::base::model::BufferedMaskAdapter::BinaryMask BinaryMask;
+    std::unique_ptr< BinaryMask > mask( new BinaryMask( size ) );
+
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            BinaryMask& out = *mask;
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                const Word* const bits = row( y, z );
+                for( unsigned int x = 0; x < size.x; ++x )
+                {
+                    out( x, y, z ) = ( bits[ x / WORD_BITS ] >> ( x % WORD_BITS ) ) & 1 ? 1 : 0;
+                }
+            }
+        }
+    );
+
+    return mask.release();
+}
@@ -0,0 +1,205 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/model/BufferedMaskAdapter.h>
+#include <vector>
+#include <cstdint>
+
+class RunLengthMask;
+
+
+
+// ----------------------------------------------------------------------------------
+// PackedMask
+// ----------------------------------------------------------------------------------
+
+/** \brief  Binary mask which stores one bit per voxel.
+  *
+  * Each row is padded to a whole number of \ref Word "words", so rows never share a
+  * word and may be written concurrently. The padding bits are always zero.
+  */
+class PackedMask
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Holds the type of the words the bits are packed into.
+      */
+    typedef uint64_t Word;
+
+    /** \brief  Holds the number of bits per word.
+      */
+    const static unsigned int WORD_BITS = 64;
+
+
+    /** \brief  Instantiates with all bits cleared.
+      */
+    explicit PackedMask( const Carna::base::Vector3ui& size );
+
+    /** \brief  Instantiates from \a mask.
+      */
+    explicit PackedMask( const RunLengthMask& mask );
+
+    /** \brief  Instantiates from \a mask.
+      */
+    explicit PackedMask( const Carna::base::model::BufferedMaskAdapter::BinaryMask& mask );
+
+    virtual ~PackedMask();
+
+
+    /** \brief  Holds the mask's size in voxels.
+      */
+    const Carna::base::Vector3ui size;
+
+    /** \brief  Holds the number of words per row.
+      */
+    const unsigned int rowWords;
+
+
+    /** \brief  Tells whether the voxel \f$(x, y, z)\f$ is set.
+      */
+    bool test( unsigned int x, unsigned int y, unsigned int z ) const
+    {
+        return ( ( row( y, z )[ x / WORD_BITS ] >> ( x % WORD_BITS ) ) & 1 ) != 0;
+    }
+
+    /** \brief  Sets the voxel \f$(x, y, z)\f$ to \a value.
+      */
+    void set( unsigned int x, unsigned int y, unsigned int z, bool value = true )
+    {
+        Word& word = row( y, z )[ x / WORD_BITS ];
+        const Word bit = Word( 1 ) << ( x % WORD_BITS );
+        word = value ? ( word | bit ) : ( word & ~bit );
+    }
+
+    /** \brief  Sets the voxels \f$[x_0, x_1)\f$ of the row \f$(y, z)\f$.
+      */
+    void fill( unsigned int y, unsigned int z, unsigned int x0, unsigned int x1 );
+
+    /** \brief  References the words of the row \f$(y, z)\f$.
+      */
+    Word* row( unsigned int y, unsigned int z )
+    {
+        return &data[ ( static_cast< std::size_t >( z ) * size.y + y ) * rowWords ];
+    }
+
+    /** \brief  References the words of the row \f$(y, z)\f$.
+      */
+    const Word* row( unsigned int y, unsigned int z ) const
+    {
+        return &data[ ( static_cast< std::size_t >( z ) * size.y + y ) * rowWords ];
+    }
+
+    /** \brief  References the underlying words.
+      */
+    std::vector< Word >& words()
+    {
+        return data;
+    }
+
+    /** \brief  References the underlying words.
+      */
+    const std::vector< Word >& words() const
+    {
+        return data;
+    }
+
+    /** \brief  Tells the number of set voxels.
+      */
+    unsigned long count() const;
+
+    /** \brief  Creates a \c BinaryMask of the same content.
+      */
+    Carna::base::model::BufferedMaskAdapter::BinaryMask* toBinaryMask() const;
+
+
+    /** \brief  Invokes \a visit with \f$(x_0, x_1)\f$ for each maximal span of set voxels
+      *         \f$[x_0, x_1)\f$ within the row \f$(y, z)\f$, in ascending order.
+      */
+    template< typename SpanVisitor >
+    void visitSpans( unsigned int y, unsigned int z, SpanVisitor visit ) const
+    {
+        const Word* const bits = row( y, z );
+        bool inside = false;
+        unsigned int x0 = 0;
+        for( unsigned int w = 0; w < rowWords; ++w )
+        {
+            const Word word = bits[ w ];
+            for( unsigned int b = 0; b < WORD_BITS; )
+            {
+                /* The set bits of 'toggles' mark where the current state changes.
+                 */
+                const Word toggles = ( inside ? ~word : word ) >> b;
+                if( toggles == 0 )
+                {
+                    break;
+                }
+
+                b += countTrailingZeros( toggles );
+                if( inside )
+                {
+                    visit( x0, w * WORD_BITS + b );
+                }
+                else
+                {
+                    x0 = w * WORD_BITS + b;
+                }
+                inside = !inside;
+            }
+        }
+        if( inside )
+        {
+            visit( x0, size.x );
+        }
+    }
+
+    /** \brief  Tells the number of trailing zero bits of the non-zero \a word.
+      */
+    static unsigned int countTrailingZeros( Word word )
+    {
+        unsigned int n = 0;
+        while( ( word & 0xFF ) == 0 )
+        {
+            word >>= 8;
+            n += 8;
+        }
+        while( ( word & 1 ) == 0 )
+        {
+            word >>= 1;
+            ++n;
+        }
+        return n;
+    }
+
+    /** \brief  Tells the number of set bits of \a word.
+      */
+    static unsigned int countBits( Word word )
+    {
+        word = word - ( ( word >> 1 ) & 0x5555555555555555ULL );
+        word = ( word & 0x3333333333333333ULL ) + ( ( word >> 2 ) & 0x3333333333333333ULL );
+        word = ( word + ( word >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast< unsigned int >( ( word * 0x0101010101010101ULL ) >> 56 );
+    }
+
+
+private:
+
+    /** \brief  Holds the packed bits row by row.
+      */
+    std::vector< Word > data;
+
+}; // PackedMask
@@ -0,0 +1,348 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "PointCloudDecimation.h"
+#include "Slabs.h"
+#include <Carna/base/CarnaException.h>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+
+
+
+/** \brief  Maps points to the cells of a uniform grid.
+  */
+class PointCloudDecimationGrid
+{
+
+public:
+
+    typedef uint64_t Key;
+
+    const static unsigned int AXIS_BITS = 21;
+
+    PointCloudDecimationGrid( const PointCloud::PointList& points, double cellSize )
+        : cellSize( cellSize )
+    {
+        if( !( cellSize > 0 ) )
+        {
+            throw std::runtime_error( "The cell size must be positive." );
+        }
+
+        origin = points.empty() ? Carna::base::Vector( 0, 0, 0 ) : points.front();
+        Carna::base::Vector upper = origin;
+        for( auto point = points.begin(); point != points.end(); ++point )
+        {
+            for( unsigned int i = 0; i < 3; ++i )
+            {
+                origin[ i ] = std::min( origin[ i ], ( *point )[ i ] );
+                upper [ i ] = std::max( upper [ i ], ( *point )[ i ] );
+            }
+        }
+
+        for( unsigned int i = 0; i < 3; ++i )
+        {
+            if( ( upper[ i ] - origin[ i ] ) / cellSize >= ( 1 << AXIS_BITS ) - 2 )
+            {
+                throw std::runtime_error( "The cell size is too small for the extent of the point cloud." );
+            }
+        }
+    }
+
+    /** \brief  Tells the cell coordinate of \a point along the axis \a i.
+      */
+    int cell( const PointCloud::Point& point, unsigned int i ) const
+    {
+        return static_cast< int >( std::floor( ( point[ i ] - origin[ i ] ) / cellSize ) );
+    }
+
+    /** \brief  Tells the key of the cell \f$(x, y, z)\f$, where each coordinate is at
+      *         least \f$-1\f$.
+      */
+    static Key key( int x, int y, int z )
+    {
+        return ( static_cast< Key >( x + 1 ) << ( 2 * AXIS_BITS ) )
+             | ( static_cast< Key >( y + 1 ) <<       AXIS_BITS   )
+             |   static_cast< Key >( z + 1 );
+    }
+
+    Key key( const PointCloud::Point& point ) const
+    {
+        return key( cell( point, 0 ), cell( point, 1 ), cell( point, 2 ) );
+    }
+
+    /** \brief  Scrambles \a key, so that neighboring cells are spread evenly.
+      */
+    static uint64_t hash( uint64_t key )
+    {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key >> 33;
+        key *= 0xC4CEB9FE1A85EC53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+private:
+
+    const double cellSize;
+
+    Carna::base::Vector origin;
+
+}; // PointCloudDecimationGrid
+
+
+/** \brief  Accumulates the points of some grid cell.
+  */
+struct PointCloudDecimationCell
+{
+    PointCloudDecimationCell()
+        : x( 0 ), y( 0 ), z( 0 ), count( 0 ), first( 0 )
+    {
+    }
+
+    double x, y, z;
+    unsigned int count;
+    std::size_t first;
+
+    bool operator<( const PointCloudDecimationCell& other ) const
+    {
+        return first < other.first;
+    }
+};
+
+
+static std::vector< PointCloudDecimationGrid::Key > computePointCloudDecimationKeys
+    ( const PointCloudDecimationGrid& grid, const PointCloud::PointList& points )
+{
+    std::vector< PointCloudDecimationGrid::Key > keys( points.size() );
+    const Slabs slabs( points.size(), 1 << 14 );
+    slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+        {
+            for( unsigned int i = first; i < last; ++i )
+            {
+                keys[ i ] = grid.key( points[ i ] );
+            }
+        }
+    );
+    return keys;
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudDecimation
+// ----------------------------------------------------------------------------------
+
+PointCloud::PointList PointCloudDecimation::voxelGrid( const PointCloud::PointList& points, double cellSize )
+{
+    typedef PointCloudDecimationGrid::Key Key;
+
+    const PointCloudDecimationGrid grid( points, cellSize );
+    const std::vector< Key > keys = computePointCloudDecimationKeys( grid, points );
+
+ // partition: each slab of points sorts its indices into the shards by hash
+
+    /* Each shard owns the cells whose hash maps to it. The shard lists of each slab
+     * hold ascending indices, and the slabs are visited in order, so that each cell
+     * still learns its first point.
+     */
+    const Slabs slabs( points.size(), 1 << 14 );
+    const unsigned int shardsCount = slabs.count();
+    std::vector< std::vector< std::vector< std::size_t > > > slabShards( slabs.count() );
+
+    slabs.process( [&]( unsigned int slab, unsigned int first, unsigned int last )
+        {
+            std::vector< std::vector< std::size_t > >& shards = slabShards[ slab ];
+            shards.resize( shardsCount );
+            for( unsigned int i = first; i < last; ++i )
+            {
+                shards[ PointCloudDecimationGrid::hash( keys[ i ] ) % shardsCount ].push_back( i );
+            }
+        }
+    );
+
+ // accumulate: each shard visits only its own points
+
+    std::vector< std::vector< PointCloudDecimationCell > > shardCells( shardsCount );
+
+    const Slabs shards( shardsCount, 1 );
+    shards.process( [&]( unsigned int, unsigned int firstShard, unsigned int lastShard )
+        {
+            for( unsigned int shard = firstShard; shard < lastShard; ++shard )
+            {
+                std::unordered_map< Key, std::size_t > cellIndices;
+                std::vector< PointCloudDecimationCell >& cells = shardCells[ shard ];
+
+                for( unsigned int slab = 0; slab < slabs.count(); ++slab )
+                {
+                    std::vector< std::size_t >& indices = slabShards[ slab ][ shard ];
+                    for( auto index = indices.begin(); index != indices.end(); ++index )
+                    {
+                        const std::size_t i = *index;
+                        const auto inserted = cellIndices.insert( std::make_pair( keys[ i ], cells.size() ) );
+                        if( inserted.second )
+                        {
+                            cells.push_back( PointCloudDecimationCell() );
+                            cells.back().first = i;
+                        }
+
+                        PointCloudDecimationCell& cell = cells[ inserted.first->second ];
+                        cell.x += points[ i ].x();
+                        cell.y += points[ i ].y();
+                        cell.z += points[ i ].z();
+                        ++cell.count;
+                    }
+                    std::vector< std::size_t >().swap( indices );
+                }
+            }
+        }
+    );
+
+ // average
+
+    std::vector< PointCloudDecimationCell > cells;
+    for( auto shard = shardCells.begin(); shard != shardCells.end(); ++shard )
+    {
+        cells.insert( cells.end(), shard->begin(), shard->end() );
+        std::vector< PointCloudDecimationCell >().swap( *shard );
+    }
+    std::sort( cells.begin(), cells.end() );
+
+    PointCloud::PointList result;
+    result.reserve( cells.size() );
+    for( auto cell = cells.begin(); cell != cells.end(); ++cell )
+    {
+        result.push_back( PointCloud::Point( cell->x / cell->count, cell->y / cell->count, cell->z / cell->count ) );
+    }
+    return result;
+}
+
+
+PointCloud::PointList PointCloudDecimation::poissonDisk( const PointCloud::PointList& points, double minimumSpacing )
+{
+    typedef PointCloudDecimationGrid::Key Key;
+
+    /* With cells of edge length 'minimumSpacing', only the 26 neighbors of a cell can
+     * hold points which are too close. Cells whose coordinates are congruent modulo 3
+     * are never neighbors, so such cells are processed concurrently in one of 27
+     * phases.
+     */
+    const PointCloudDecimationGrid grid( points, minimumSpacing );
+    const std::vector< Key > keys = computePointCloudDecimationKeys( grid, points );
+
+ // group the points by cell, pseudo-randomly ordered within each cell
+
+    std::vector< std::size_t > order( points.size() );
+    for( std::size_t i = 0; i < order.size(); ++i )
+    {
+        order[ i ] = i;
+    }
+    std::sort( order.begin(), order.end(), [&]( std::size_t i, std::size_t j )->bool
+        {
+            if( keys[ i ] != keys[ j ] )
+            {
+                return keys[ i ] < keys[ j ];
+            }
+            const uint64_t hi = PointCloudDecimationGrid::hash( i );
+            const uint64_t hj = PointCloudDecimationGrid::hash( j );
+            return hi != hj ? hi < hj : i < j;
+        }
+    );
+
+    std::unordered_map< Key, std::size_t > cellIndices;
+    std::vector< std::size_t > cellBegins;
+    std::vector< std::vector< std::size_t > > phases( 27 );
+    for( std::size_t i = 0; i < order.size(); ++i )
+    {
+        const Key key = keys[ order[ i ] ];
+        if( i == 0 || key != keys[ order[ i - 1 ] ] )
+        {
+            const std::size_t cell = cellBegins.size();
+            cellIndices[ key ] = cell;
+            cellBegins.push_back( i );
+
+            const PointCloud::Point& point = points[ order[ i ] ];
+            const unsigned int phase = ( grid.cell( point, 0 ) % 3 ) * 9
+                                     + ( grid.cell( point, 1 ) % 3 ) * 3
+                                     + ( grid.cell( point, 2 ) % 3 );
+            phases[ phase ].push_back( cell );
+        }
+    }
+    cellBegins.push_back( order.size() );
+
+ // select the points phase by phase
+
+    const double minimumSpacingSquared = minimumSpacing * minimumSpacing;
+    std::vector< PointCloud::PointList > selected( cellBegins.size() - 1 );
+
+    for( auto phase = phases.begin(); phase != phases.end(); ++phase )
+    {
+        const Slabs slabs( phase->size(), 64 );
+        slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+            {
+                for( unsigned int c = first; c < last; ++c )
+                {
+                    const std::size_t cell = ( *phase )[ c ];
+                    PointCloud::PointList& out = selected[ cell ];
+
+                    const PointCloud::Point& anyPoint = points[ order[ cellBegins[ cell ] ] ];
+                    const int cx = grid.cell( anyPoint, 0 );
+                    const int cy = grid.cell( anyPoint, 1 );
+                    const int cz = grid.cell( anyPoint, 2 );
+
+                    for( std::size_t i = cellBegins[ cell ]; i < cellBegins[ cell + 1 ]; ++i )
+                    {
+                        const PointCloud::Point& candidate = points[ order[ i ] ];
+                        bool accepted = true;
+
+                        for( int dz = -1; dz <= 1 && accepted; ++dz )
+                        for( int dy = -1; dy <= 1 && accepted; ++dy )
+                        for( int dx = -1; dx <= 1 && accepted; ++dx )
+                        {
+                            const auto neighbor = cellIndices.find( PointCloudDecimationGrid::key( cx + dx, cy + dy, cz + dz ) );
+                            if( neighbor == cellIndices.end() )
+                            {
+                                continue;
+                            }
+
+                            const PointCloud::PointList& others = selected[ neighbor->second ];
+                            for( auto other = others.begin(); other != others.end(); ++other )
+                            {
+                                if( ( *other - candidate ).squaredNorm() < minimumSpacingSquared )
+                                {
+                                    accepted = false;
+                                    break;
+                                }
+                            }
+                        }
+
+                        if( accepted )
+                        {
+                            out.push_back( candidate );
+                        }
+                    }
+                }
+            }
+        );
+    }
+
+ // concatenate in the order of the cells
+
+    PointCloud::PointList result;
+    for( auto cell = selected.begin(); cell != selected.end(); ++cell )
+    {
+        result.insert( result.end(), cell->begin(), cell->end() );
+    }
+    return result;
+}
@@ -0,0 +1,52 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "PointCloud.h"
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudDecimation
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reduces the density of point lists.
+  *
+  * Both methods hash the points into a uniform grid. The grid cells are processed
+  * concurrently, hence the runtime grows linearly with the number of points.
+  */
+class PointCloudDecimation
+{
+
+public:
+
+    /** \brief  Replaces all points within each grid cell of edge length \a cellSize by
+      *         their average.
+      *
+      * The cells are ordered by their first point within \a points.
+      *
+      * \throws std::runtime_error  if the grid would have more than \f$2^{21}\f$ cells
+      *                             along some axis.
+      */
+    static PointCloud::PointList voxelGrid( const PointCloud::PointList& points, double cellSize );
+
+    /** \brief  Selects a subset of \a points where no two points are closer than
+      *         \a minimumSpacing, while no further point could be added.
+      *
+      * The points are visited in a pseudo-random, but reproducible order.
+      *
+      * \throws std::runtime_error  if the grid would have more than \f$2^{21}\f$ cells
+      *                             along some axis.
+      */
+    static PointCloud::PointList poissonDisk( const PointCloud::PointList& points, double minimumSpacing );
+
+}; // PointCloudDecimation
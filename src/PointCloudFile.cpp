@@ -0,0 +1,278 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "PointCloudFile.h"
+#include "PointCloud.h"
+#include "Slabs.h"
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+
+
+static const char POINT_CLOUD_FILE_MAGIC[ 4 ] = { 'D', 'V', 'P', 'C' };
+
+
+
+// ----------------------------------------------------------------------------------
+// decodePointCloudFileCoordinates
+// ----------------------------------------------------------------------------------
+
+/** \brief  Converts the points \f$[\mathrm{first}, \mathrm{last})\f$ from \a in,
+  *         whose coordinates have \a precision bytes each.
+  */
+static void decodePointCloudFileCoordinates
+    ( const unsigned char* in
+    , unsigned int precision
+    , bool bigEndian
+    , PointCloud::PointList& out
+    , unsigned int first
+    , unsigned int last )
+{
+    for( unsigned int i = first; i < last; ++i )
+    {
+        double xyz[ 3 ];
+        for( unsigned int axis = 0; axis < 3; ++axis )
+        {
+            const unsigned char* const bytes = in + ( 3 * static_cast< std::size_t >( i ) + axis ) * precision;
+            uint64_t bits = 0;
+            for( unsigned int b = 0; b < precision; ++b )
+            {
+                bits |= static_cast< uint64_t >( bytes[ b ] ) << ( 8 * ( bigEndian ? precision - 1 - b : b ) );
+            }
+
+            if( precision == sizeof( double ) )
+            {
+                std::memcpy( &xyz[ axis ], &bits, sizeof( double ) );
+            }
+            else
+            {
+                const uint32_t floatBits = static_cast< uint32_t >( bits );
+                float value;
+                std::memcpy( &value, &floatBits, sizeof( float ) );
+                xyz[ axis ] = value;
+            }
+        }
+        out[ i ] = PointCloud::Point( xyz[ 0 ], xyz[ 1 ], xyz[ 2 ] );
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// readPointCloudFileCoordinates
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads \a count points from \a file, starting at \a offset, and converts
+  *         them in parallel.
+  */
+static void readPointCloudFileCoordinates
+    ( QFile& file
+    , qint64 offset
+    , unsigned int count
+    , unsigned int precision
+    , bool bigEndian
+    , PointCloud::PointList& out )
+{
+    const qint64 bytes = static_cast< qint64 >( count ) * 3 * precision;
+    if( offset + bytes > file.size() )
+    {
+        throw std::runtime_error( "Point cloud file is truncated." );
+    }
+
+    out.resize( count );
+    if( count == 0 )
+    {
+        return;
+    }
+
+    /* Files which cannot be mapped, e.g. on some network shares, are read at once.
+     */
+    uchar* const mapping = file.map( offset, bytes );
+    QByteArray buffer;
+    const unsigned char* in = mapping;
+    if( mapping == nullptr )
+    {
+        file.seek( offset );
+        buffer = file.read( bytes );
+        if( buffer.size() != bytes )
+        {
+            throw std::runtime_error( "Point cloud file is truncated." );
+        }
+        in = reinterpret_cast< const unsigned char* >( buffer.constData() );
+    }
+
+    const Slabs slabs( count, 1 << 14 );
+    slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+        {
+            decodePointCloudFileCoordinates( in, precision, bigEndian, out, first, last );
+        }
+    );
+
+    if( mapping != nullptr )
+    {
+        file.unmap( mapping );
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudFile
+// ----------------------------------------------------------------------------------
+
+void PointCloudFile::save( QFile& file, const PointCloud& cloud )
+{
+    const PointCloud::PointList& points = cloud.getList();
+    const QByteArray name = QString::fromStdString( cloud.getName() ).toUtf8();
+
+ // write header
+
+    QDataStream out( &file );
+    out.writeRawData( POINT_CLOUD_FILE_MAGIC, sizeof( POINT_CLOUD_FILE_MAGIC ) );
+    out << static_cast< quint16 >( VERSION );
+    out << static_cast< quint8 >( cloud.getFormat() ) << static_cast< quint8 >( cloud.source ) << static_cast< quint8 >( sizeof( double ) );
+    out << static_cast< quint8 >( 0 ) << static_cast< quint8 >( 0 ) << static_cast< quint8 >( 0 );
+    out << static_cast< quint32 >( name.size() ) << static_cast< quint64 >( points.size() );
+
+    const char padding[ 8 ] = { 0 };
+    out.writeRawData( name.constData(), name.size() );
+    out.writeRawData( padding, ( 8 - name.size() % 8 ) % 8 );
+
+ // convert the coordinates in parallel and write them at once
+
+    std::vector< unsigned char > data( points.size() * 3 * sizeof( double ) );
+
+    const Slabs slabs( static_cast< unsigned int >( points.size() ), 1 << 14 );
+    slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+        {
+            for( unsigned int i = first; i < last; ++i )
+            {
+                const double xyz[ 3 ] = { points[ i ].x(), points[ i ].y(), points[ i ].z() };
+                for( unsigned int axis = 0; axis < 3; ++axis )
+                {
+                    uint64_t bits;
+                    std::memcpy( &bits, &xyz[ axis ], sizeof( double ) );
+
+                    unsigned char* const bytes = &data[ ( 3 * static_cast< std::size_t >( i ) + axis ) * sizeof( double ) ];
+                    for( unsigned int b = 0; b < sizeof( double ); ++b )
+                    {
+                        bytes[ b ] = static_cast< unsigned char >( bits >> ( 8 * b ) );
+                    }
+                }
+            }
+        }
+    );
+
+    if( !data.empty() )
+    {
+        out.writeRawData( reinterpret_cast< const char* >( &data.front() ), static_cast< int >( data.size() ) );
+    }
+
+    if( out.status() != QDataStream::Ok )
+    {
+        throw std::runtime_error( "Failed writing the point cloud." );
+    }
+}
+
+
+PointCloud* PointCloudFile::load( QFile& file, Record::Server& server )
+{
+    QDataStream in( &file );
+
+    PointCloud::PointList points;
+    PointCloud::Unit unit;
+    PointCloud::Domain domain = PointCloud::unknown;
+    QString name;
+
+    const QByteArray magic = file.peek( sizeof( POINT_CLOUD_FILE_MAGIC ) );
+    if( magic.size() == sizeof( POINT_CLOUD_FILE_MAGIC ) && std::memcmp( magic.constData(), POINT_CLOUD_FILE_MAGIC, sizeof( POINT_CLOUD_FILE_MAGIC ) ) == 0 )
+    {
+
+     // read version 2 header
+
+        in.skipRawData( sizeof( POINT_CLOUD_FILE_MAGIC ) );
+
+        quint16 version;
+        quint8 unitValue, domainValue, precision, reserved;
+        quint32 nameLength;
+        quint64 count;
+        in >> version >> unitValue >> domainValue >> precision;
+        in >> reserved >> reserved >> reserved;
+        in >> nameLength >> count;
+
+        if( in.status() != QDataStream::Ok )
+        {
+            throw std::runtime_error( "Point cloud header is incomplete." );
+        }
+        if( version != VERSION )
+        {
+            throw std::runtime_error( "Unsupported point cloud file version." );
+        }
+        if( unitValue > PointCloud::millimeters || domainValue > PointCloud::unknown )
+        {
+            throw std::runtime_error( "Point cloud header is malformed." );
+        }
+        if( precision != sizeof( float ) && precision != sizeof( double ) )
+        {
+            throw std::runtime_error( "Unsupported coordinate precision." );
+        }
+        if( count > 0xFFFFFFFFu )
+        {
+            throw std::runtime_error( "Point cloud is too large." );
+        }
+
+        const QByteArray nameBytes = file.read( nameLength );
+        if( nameBytes.size() != static_cast< int >( nameLength ) )
+        {
+            throw std::runtime_error( "Point cloud header is incomplete." );
+        }
+
+        unit   = static_cast< PointCloud::Unit   >( unitValue );
+        domain = static_cast< PointCloud::Domain >( domainValue );
+        name   = QString::fromUtf8( nameBytes );
+
+     // read points
+
+        const qint64 offset = file.pos() + ( 8 - nameLength % 8 ) % 8;
+        readPointCloudFileCoordinates( file, offset, static_cast< unsigned int >( count ), precision, false, points );
+
+    }
+    else
+    {
+
+     // read version 1 header
+
+        bool isModelUnits;
+        quint32 count;
+        in >> name >> isModelUnits >> count;
+
+        if( in.status() != QDataStream::Ok )
+        {
+            throw std::runtime_error( "Point cloud header is incomplete." );
+        }
+
+        unit = isModelUnits ? PointCloud::volumeUnits : PointCloud::millimeters;
+
+     // read points
+
+        readPointCloudFileCoordinates( file, file.pos(), count, sizeof( double ), true, points );
+
+    }
+
+    PointCloud* const cloud = new PointCloud( server, unit, domain, name.toStdString() );
+    cloud->getList().swap( points );
+    return cloud;
+}
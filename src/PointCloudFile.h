@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "Server.h"
+
+class PointCloud;
+class QFile;
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudFile
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads and writes binary point cloud dumps, i.e. \c *.bin files.
+  *
+  * Point clouds are written in version 2 of the format, which starts with a
+  * big-endian header:
+  *
+  * | Field        | Type         | Value                                         |
+  * |--------------|--------------|-----------------------------------------------|
+  * | magic        | 4 bytes      | \c DVPC                                       |
+  * | version      | \c uint16_t  | \c 2                                          |
+  * | unit         | \c uint8_t   | \c PointCloud::Unit                           |
+  * | domain       | \c uint8_t   | \c PointCloud::Domain                         |
+  * | precision    | \c uint8_t   | bytes per coordinate, \c 4 or \c 8            |
+  * | reserved     | 3 bytes      | zero                                          |
+  * | name length  | \c uint32_t  | bytes of the UTF-8 encoded name               |
+  * | count        | \c uint64_t  | number of points                              |
+  * | name         | UTF-8        | padded with zeros to a multiple of 8 bytes    |
+  *
+  * It is followed by one contiguous array of little-endian IEEE floating point
+  * \f$x, y, z\f$ triples. The array is written in a single call and read through
+  * a memory map of the file, while the coordinates are converted in parallel.
+  *
+  * Version 1 dumps, which start with the name as \c QString, followed by a \c bool
+  * which tells whether volume units are used, the number of points and the
+  * coordinates as big-endian \c double, are still read.
+  */
+class PointCloudFile
+{
+
+public:
+
+    /** \brief  Holds the format version which is written.
+      */
+    const static unsigned int VERSION = 2;
+
+
+    /** \brief  Writes \a cloud to \a file, using double precision.
+      *
+      * \throws std::runtime_error  if writing fails.
+      */
+    static void save( QFile& file, const PointCloud& cloud );
+
+    /** \brief  Reads a point cloud of either version from \a file.
+      *
+      * The cloud is only created if reading succeeds.
+      *
+      * \throws std::runtime_error  if the file is truncated or malformed.
+      */
+    static PointCloud* load( QFile& file, Record::Server& server );
+
+}; // PointCloudFile
@@ -0,0 +1,604 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "PointCloudParser.h"
+#include "Slabs.h"
+#include <Carna/base/noncopyable.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudParserInput
+// ----------------------------------------------------------------------------------
+
+/** \brief  References the contents of some file, which are mapped if possible and
+  *         read at once otherwise.
+  */
+class PointCloudParserInput
+{
+
+    NON_COPYABLE
+
+public:
+
+    explicit PointCloudParserInput( QFile& file )
+        : file( file )
+        , mapping( file.size() > 0 ? file.map( 0, file.size() ) : nullptr )
+    {
+        if( mapping == nullptr )
+        {
+            file.seek( 0 );
+            buffer = file.readAll();
+        }
+        begin = mapping != nullptr ? reinterpret_cast< const char* >( mapping ) : buffer.constData();
+        end = begin + ( mapping != nullptr ? file.size() : buffer.size() );
+    }
+
+    ~PointCloudParserInput()
+    {
+        if( mapping != nullptr )
+        {
+            file.unmap( mapping );
+        }
+    }
+
+    const char* begin;
+
+    const char* end;
+
+private:
+
+    QFile& file;
+
+    uchar* const mapping;
+
+    QByteArray buffer;
+
+}; // PointCloudParserInput
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudParser Helpers
+// ----------------------------------------------------------------------------------
+
+/** \brief  Holds a range of characters.
+  */
+struct PointCloudParserRange
+{
+    const char* begin;
+    const char* end;
+
+    bool equals( const char* str ) const
+    {
+        const std::size_t length = std::strlen( str );
+        return static_cast< std::size_t >( end - begin ) == length && std::memcmp( begin, str, length ) == 0;
+    }
+};
+
+
+static bool isPointCloudParserSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+/** \brief  Splits \f$[\mathrm{begin}, \mathrm{end})\f$ into at most \a count chunks,
+  *         whose bounds are moved forward to the next \a delimiter.
+  *
+  * If \a after is \c true, the bounds are placed behind the delimiter.
+  */
+static std::vector< const char* > splitPointCloudParserInput( const char* begin, const char* end, unsigned int count, char delimiter, bool after )
+{
+    std::vector< const char* > bounds( 1, begin );
+    for( unsigned int chunk = 1; chunk < count; ++chunk )
+    {
+        const char* bound = begin + static_cast< std::size_t >( ( end - begin ) * ( static_cast< double >( chunk ) / count ) );
+        bound = std::max( bound, bounds.back() );
+        bound = std::find( bound, end, delimiter );
+        if( bound != end && after )
+        {
+            ++bound;
+        }
+        bounds.push_back( bound );
+    }
+    bounds.push_back( end );
+    return bounds;
+}
+
+
+/** \brief  Parses the chunks between \a bounds concurrently by \a parseChunk and
+  *         concatenates their points to \a points.
+  */
+template< typename ChunkParser >
+static void parsePointCloudParserChunks( const std::vector< const char* >& bounds, PointCloud::PointList& points, ChunkParser parseChunk )
+{
+    const unsigned int chunks = static_cast< unsigned int >( bounds.size() - 1 );
+    std::vector< PointCloud::PointList > chunkPoints( chunks );
+
+    const Slabs slabs( chunks );
+    slabs.process( [&]( unsigned int, unsigned int first, unsigned int last )
+        {
+            for( unsigned int chunk = first; chunk < last; ++chunk )
+            {
+                parseChunk( bounds[ chunk ], bounds[ chunk + 1 ], chunkPoints[ chunk ] );
+            }
+        }
+    );
+
+    std::size_t total = points.size();
+    for( unsigned int chunk = 0; chunk < chunks; ++chunk )
+    {
+        total += chunkPoints[ chunk ].size();
+    }
+    points.reserve( total );
+    for( unsigned int chunk = 0; chunk < chunks; ++chunk )
+    {
+        points.insert( points.end(), chunkPoints[ chunk ].begin(), chunkPoints[ chunk ].end() );
+    }
+}
+
+
+/** \brief  Tells the number of chunks the input is split into.
+  */
+static unsigned int countPointCloudParserChunks( const char* begin, const char* end )
+{
+    const static std::size_t MIN_CHUNK_SIZE = 1 << 16;
+    const std::size_t maxChunks = std::max< std::size_t >( 1, ( end - begin ) / MIN_CHUNK_SIZE );
+    return static_cast< unsigned int >( std::min< std::size_t >( maxChunks, 4 * std::max( 1, QThread::idealThreadCount() ) ) );
+}
+
+
+/** \brief  Reads the next attribute of the XML tag at \a p.
+  *
+  * \returns \c false if the end of the tag is reached, with \a p pointing to either
+  *          \c / or \c >.
+  */
+static bool nextPointCloudParserAttribute( const char*& p, const char* end, PointCloudParserRange& name, PointCloudParserRange& value )
+{
+    while( p != end && isPointCloudParserSpace( *p ) )
+    {
+        ++p;
+    }
+    if( p == end )
+    {
+        throw std::runtime_error( "Unexpected end of XML tag." );
+    }
+    if( *p == '/' || *p == '>' )
+    {
+        return false;
+    }
+
+    name.begin = p;
+    while( p != end && !isPointCloudParserSpace( *p ) && *p != '=' && *p != '/' && *p != '>' )
+    {
+        ++p;
+    }
+    name.end = p;
+
+    while( p != end && isPointCloudParserSpace( *p ) )
+    {
+        ++p;
+    }
+    if( p == end || *p != '=' )
+    {
+        throw std::runtime_error( "Malformed XML attribute." );
+    }
+    ++p;
+    while( p != end && isPointCloudParserSpace( *p ) )
+    {
+        ++p;
+    }
+    if( p == end || ( *p != '"' && *p != '\'' ) )
+    {
+        throw std::runtime_error( "Malformed XML attribute." );
+    }
+
+    const char quote = *p++;
+    value.begin = p;
+    p = std::find( p, end, quote );
+    if( p == end )
+    {
+        throw std::runtime_error( "Unterminated XML attribute." );
+    }
+    value.end = p++;
+    return true;
+}
+
+
+/** \brief  Parses \a value, which must hold a single number.
+  */
+static double parsePointCloudParserCoordinate( const PointCloudParserRange& value )
+{
+    const char* p = value.begin;
+    while( p != value.end && isPointCloudParserSpace( *p ) )
+    {
+        ++p;
+    }
+
+    double result;
+    if( !PointCloudParser::parseNumber( p, value.end, result ) )
+    {
+        throw std::runtime_error( "Malformed point coordinate." );
+    }
+
+    while( p != value.end && isPointCloudParserSpace( *p ) )
+    {
+        ++p;
+    }
+    if( p != value.end )
+    {
+        throw std::runtime_error( "Malformed point coordinate." );
+    }
+    return result;
+}
+
+
+/** \brief  Parses all \c point elements within \f$[\mathrm{begin}, \mathrm{end})\f$.
+  */
+static void parsePointCloudParserXmlChunk( const char* begin, const char* end, PointCloud::PointList& points )
+{
+    const static char POINT_TAG[] = "<point";
+    const std::size_t POINT_TAG_LENGTH = sizeof( POINT_TAG ) - 1;
+
+    const char* p = begin;
+    while( ( p = std::find( p, end, '<' ) ) != end )
+    {
+        if( static_cast< std::size_t >( end - p ) <= POINT_TAG_LENGTH
+            || std::memcmp( p, POINT_TAG, POINT_TAG_LENGTH ) != 0
+            || !( isPointCloudParserSpace( p[ POINT_TAG_LENGTH ] ) || p[ POINT_TAG_LENGTH ] == '/' || p[ POINT_TAG_LENGTH ] == '>' ) )
+        {
+            ++p;
+            continue;
+        }
+        p += POINT_TAG_LENGTH;
+
+        double xyz[ 3 ];
+        bool found[ 3 ] = { false, false, false };
+
+        PointCloudParserRange name, value;
+        while( nextPointCloudParserAttribute( p, end, name, value ) )
+        {
+            if( name.end - name.begin == 1 && *name.begin >= 'x' && *name.begin <= 'z' )
+            {
+                const unsigned int axis = *name.begin - 'x';
+                xyz[ axis ] = parsePointCloudParserCoordinate( value );
+                found[ axis ] = true;
+            }
+        }
+        if( !found[ 0 ] || !found[ 1 ] || !found[ 2 ] )
+        {
+            throw std::runtime_error( "Point misses a coordinate." );
+        }
+
+        points.push_back( PointCloud::Point( xyz[ 0 ], xyz[ 1 ], xyz[ 2 ] ) );
+    }
+}
+
+
+/** \brief  Parses all lines within \f$[\mathrm{begin}, \mathrm{end})\f$.
+  */
+static void parsePointCloudParserTextChunk( const char* begin, const char* end, PointCloud::PointList& points )
+{
+    const char* p = begin;
+    while( p != end )
+    {
+        const char* const lineEnd = std::find( p, end, '\n' );
+
+        double xyz[ 3 ];
+        unsigned int axis = 0;
+        for( ;; )
+        {
+            while( p != lineEnd && ( *p == ' ' || *p == '\t' || *p == '\r' || *p == ',' || *p == ';' ) )
+            {
+                ++p;
+            }
+            if( p == lineEnd )
+            {
+                break;
+            }
+            if( axis == 3 || !PointCloudParser::parseNumber( p, lineEnd, xyz[ axis ] ) )
+            {
+                throw std::runtime_error( "Malformed line within point cloud." );
+            }
+            ++axis;
+        }
+
+        /* Empty lines are skipped.
+         */
+        if( axis == 3 )
+        {
+            points.push_back( PointCloud::Point( xyz[ 0 ], xyz[ 1 ], xyz[ 2 ] ) );
+        }
+        else
+        if( axis != 0 )
+        {
+            throw std::runtime_error( "Point misses a coordinate." );
+        }
+
+        p = lineEnd == end ? end : lineEnd + 1;
+    }
+}
+
+
+static QString decodePointCloudParserText( const PointCloudParserRange& range )
+{
+    QString text = QString::fromUtf8( range.begin, static_cast< int >( range.end - range.begin ) );
+    text.replace( "&lt;", "<" ).replace( "&gt;", ">" ).replace( "&quot;", "\"" ).replace( "&apos;", "'" ).replace( "&amp;", "&" );
+    return text;
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudParser
+// ----------------------------------------------------------------------------------
+
+bool PointCloudParser::parseNumber( const char*& begin, const char* end, double& value )
+{
+    const static double POWERS_OF_TEN[] =
+        { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11
+        , 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* p = begin;
+    const bool negative = p != end && *p == '-';
+    if( p != end && ( *p == '-' || *p == '+' ) )
+    {
+        ++p;
+    }
+
+ // read up to 19 significant digits
+
+    uint64_t mantissa = 0;
+    unsigned int digits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+
+    for( ; p != end && *p >= '0' && *p <= '9'; ++p )
+    {
+        const unsigned int digit = *p - '0';
+        anyDigit = true;
+        if( digits < 19 )
+        {
+            if( mantissa != 0 || digit != 0 )
+            {
+                mantissa = mantissa * 10 + digit;
+                ++digits;
+            }
+        }
+        else
+        {
+            ++exponent;
+        }
+    }
+
+    if( p != end && *p == '.' )
+    {
+        for( ++p; p != end && *p >= '0' && *p <= '9'; ++p )
+        {
+            const unsigned int digit = *p - '0';
+            anyDigit = true;
+            if( digits < 19 )
+            {
+                if( mantissa != 0 || digit != 0 )
+                {
+                    mantissa = mantissa * 10 + digit;
+                    ++digits;
+                }
+                --exponent;
+            }
+        }
+    }
+
+    if( !anyDigit )
+    {
+        return false;
+    }
+
+ // read the exponent, if there is one
+
+    if( p != end && ( *p == 'e' || *p == 'E' ) )
+    {
+        const char* q = p + 1;
+        const bool negativeExponent = q != end && *q == '-';
+        if( q != end && ( *q == '-' || *q == '+' ) )
+        {
+            ++q;
+        }
+        if( q != end && *q >= '0' && *q <= '9' )
+        {
+            int explicitExponent = 0;
+            for( ; q != end && *q >= '0' && *q <= '9'; ++q )
+            {
+                explicitExponent = std::min( explicitExponent * 10 + ( *q - '0' ), 100000 );
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            p = q;
+        }
+    }
+
+ // scale, exactly if both the mantissa and the power of ten are representable
+
+    double result = static_cast< double >( mantissa );
+    if( mantissa != 0 )
+    {
+        if( mantissa <= ( uint64_t( 1 ) << 53 ) && exponent >= -22 && exponent <= 22 )
+        {
+            result = exponent >= 0 ? result * POWERS_OF_TEN[ exponent ] : result / POWERS_OF_TEN[ -exponent ];
+        }
+        else
+        {
+            result *= std::pow( 10., exponent );
+        }
+    }
+
+    value = negative ? -result : result;
+    begin = p;
+    return true;
+}
+
+
+void PointCloudParser::parseText( const char* begin, const char* end, PointCloud::PointList& points )
+{
+    const std::vector< const char* > bounds = splitPointCloudParserInput( begin, end, countPointCloudParserChunks( begin, end ), '\n', true );
+    parsePointCloudParserChunks( bounds, points, &parsePointCloudParserTextChunk );
+}
+
+
+void PointCloudParser::parseXmlPoints( const char* begin, const char* end, PointCloud::PointList& points )
+{
+    const std::vector< const char* > bounds = splitPointCloudParserInput( begin, end, countPointCloudParserChunks( begin, end ), '<', false );
+    parsePointCloudParserChunks( bounds, points, &parsePointCloudParserXmlChunk );
+}
+
+
+std::vector< PointCloud* > PointCloudParser::loadXml( QFile& file, Record::Server& server )
+{
+    const static char CLOUD_TAG[] = "<cloud";
+    const static char CLOUD_END_TAG[] = "</cloud";
+    const std::size_t CLOUD_TAG_LENGTH = sizeof( CLOUD_TAG ) - 1;
+
+    const PointCloudParserInput input( file );
+
+    struct Cloud
+    {
+        QString name;
+        PointCloud::Unit unit;
+        PointCloud::Domain domain;
+        PointCloud::PointList points;
+    };
+    std::vector< Cloud > clouds;
+
+    const char* p = input.begin;
+    for( ;; )
+    {
+        p = std::search( p, input.end, CLOUD_TAG, CLOUD_TAG + CLOUD_TAG_LENGTH );
+        if( p == input.end )
+        {
+            break;
+        }
+        p += CLOUD_TAG_LENGTH;
+        if( p != input.end && !isPointCloudParserSpace( *p ) && *p != '/' && *p != '>' )
+        {
+            continue;
+        }
+
+     // read the attributes of the cloud
+
+        clouds.push_back( Cloud() );
+        Cloud& cloud = clouds.back();
+        cloud.domain = PointCloud::unknown;
+
+        bool hasUnit = false;
+        PointCloudParserRange name, value;
+        while( nextPointCloudParserAttribute( p, input.end, name, value ) )
+        {
+            if( name.equals( "name" ) )
+            {
+                cloud.name = decodePointCloudParserText( value );
+            }
+            else
+            if( name.equals( "format" ) )
+            {
+                hasUnit = true;
+                if( value.equals( "volumeunits" ) || value.equals( "modelunits" ) )
+                {
+                    cloud.unit = PointCloud::volumeUnits;
+                }
+                else
+                if( value.equals( "millimeters" ) )
+                {
+                    cloud.unit = PointCloud::millimeters;
+                }
+                else
+                {
+                    throw std::runtime_error( "Unknown point cloud format." );
+                }
+            }
+            else
+            if( name.equals( "source" ) )
+            {
+                if( value.equals( "tracking" ) )
+                {
+                    cloud.domain = PointCloud::trackingSide;
+                }
+                else
+                if( value.equals( "data" ) )
+                {
+                    cloud.domain = PointCloud::dataSide;
+                }
+            }
+        }
+        if( !hasUnit )
+        {
+            throw std::runtime_error( "Point cloud format is missing." );
+        }
+
+        /* Empty clouds may be closed immediately.
+         */
+        if( *p == '/' )
+        {
+            ++p;
+            continue;
+        }
+        ++p;
+
+     // parse the points of the cloud in parallel
+
+        const char* const cloudEnd = std::search( p, input.end, CLOUD_END_TAG, CLOUD_END_TAG + sizeof( CLOUD_END_TAG ) - 1 );
+        if( cloudEnd == input.end )
+        {
+            throw std::runtime_error( "Unterminated cloud element." );
+        }
+
+        parseXmlPoints( p, cloudEnd, cloud.points );
+
+        p = cloudEnd;
+    }
+
+    if( clouds.empty() )
+    {
+        throw std::runtime_error( "No point cloud found." );
+    }
+
+ // create the clouds once all of them were parsed
+
+    std::vector< PointCloud* > result;
+    for( auto cloud = clouds.begin(); cloud != clouds.end(); ++cloud )
+    {
+        result.push_back( new PointCloud( server, cloud->unit, cloud->domain, cloud->name.toStdString() ) );
+        result.back()->getList().swap( cloud->points );
+    }
+    return result;
+}
+
+
+PointCloud* PointCloudParser::loadText( QFile& file, Record::Server& server, PointCloud::Unit unit )
+{
+    PointCloud::PointList points;
+    {
+        const PointCloudParserInput input( file );
+        parseText( input.begin, input.end, points );
+    }
+
+    PointCloud* const cloud = new PointCloud( server, unit, PointCloud::unknown, QFileInfo( file ).completeBaseName().toStdString() );
+    cloud->getList().swap( points );
+    return cloud;
+}
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "Server.h"
+#include "PointCloud.h"
+#include <vector>
+
+class QFile;
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudParser
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads \c *.xml and \c *.txt point clouds in parallel.
+  *
+  * The file is memory-mapped and split into chunks at element or line boundaries.
+  * The chunks are parsed concurrently and their points are concatenated in order.
+  * Numbers are parsed by \ref parseNumber, which does not allocate.
+  */
+class PointCloudParser
+{
+
+public:
+
+    /** \brief  Reads all \c cloud elements from the XML file \a file, as written by
+      *         \ref PointCloudsController::savePointCloud.
+      *
+      * \throws std::runtime_error  if the file is malformed. No cloud is created in
+      *                             this case.
+      */
+    static std::vector< PointCloud* > loadXml( QFile& file, Record::Server& server );
+
+    /** \brief  Reads the text file \a file, which holds three whitespace-separated
+      *         coordinates per line, into a cloud of \a unit.
+      *
+      * \throws std::runtime_error  if the file is malformed.
+      */
+    static PointCloud* loadText( QFile& file, Record::Server& server, PointCloud::Unit unit );
+
+
+    /** \brief  Appends the points of the text within \f$[\mathrm{begin}, \mathrm{end})\f$
+      *         to \a points.
+      *
+      * Each non-empty line must hold three coordinates, which are separated by
+      * whitespace, commas or semicolons.
+      *
+      * \throws std::runtime_error  if some line is malformed.
+      */
+    static void parseText( const char* begin, const char* end, PointCloud::PointList& points );
+
+    /** \brief  Appends the points of the \c point elements within
+      *         \f$[\mathrm{begin}, \mathrm{end})\f$ to \a points.
+      *
+      * The range is expected to be the content of some \c cloud element.
+      *
+      * \throws std::runtime_error  if some point is malformed.
+      */
+    static void parseXmlPoints( const char* begin, const char* end, PointCloud::PointList& points );
+
+
+    /** \brief  Parses the number at \a begin, stopping at \a end, and advances
+      *         \a begin behind it.
+      *
+      * Decimal numbers with up to 19 significant digits, an optional fraction and an
+      * optional exponent are accepted. Numbers with at most 15 significant digits and
+      * a small exponent are rounded correctly.
+      *
+      * \returns \c false if there is no number at \a begin.
+      */
+    static bool parseNumber( const char*& begin, const char* end, double& value );
+
+}; // PointCloudParser
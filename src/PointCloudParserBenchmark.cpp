@@ -0,0 +1,300 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+/* Times the PointCloudParser against the QXmlSimpleReader and QTextStream based
+ * readers it replaced, on generated clouds which are written like
+ * PointCloudsController::savePointCloud writes them.
+ *
+ * Usage: PointCloudParserBenchmark [points]
+ *
+ * This file is not part of the application. It is built as a separate target if
+ * the BUILD_BENCHMARK option is enabled.
+ */
+
+#include "PointCloudParser.h"
+#include <QBuffer>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QXmlDefaultHandler>
+#include <QXmlSimpleReader>
+#include <QXmlStreamWriter>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+
+
+/** \brief  Holds how often each reader is timed, the best run is reported.
+  */
+const static unsigned int POINT_CLOUD_PARSER_BENCHMARK_RUNS = 3;
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudParserBenchmarkHandler
+// ----------------------------------------------------------------------------------
+
+/** \brief  Reads the \c point elements like the SAX parser did, which was used by
+  *         \ref PointCloudsController::loadPointCloud before \ref PointCloudParser.
+  */
+class PointCloudParserBenchmarkHandler : public QXmlDefaultHandler
+{
+
+public:
+
+    explicit PointCloudParserBenchmarkHandler( PointCloud::PointList& points )
+        : points( points )
+    {
+    }
+
+    virtual bool startElement( const QString&, const QString& localName, const QString&, const QXmlAttributes& attributes ) override
+    {
+        if( localName != "point" )
+        {
+            return true;
+        }
+
+        bool ok;
+
+        const double x = attributes.value( "x" ).toDouble( &ok );
+        if( !ok )
+        {
+            return false;
+        }
+
+        const double y = attributes.value( "y" ).toDouble( &ok );
+        if( !ok )
+        {
+            return false;
+        }
+
+        const double z = attributes.value( "z" ).toDouble( &ok );
+        if( !ok )
+        {
+            return false;
+        }
+
+        points.push_back( PointCloud::Point( x, y, z ) );
+        return true;
+    }
+
+private:
+
+    PointCloud::PointList& points;
+
+}; // PointCloudParserBenchmarkHandler
+
+
+
+// ----------------------------------------------------------------------------------
+// PointCloudParserBenchmark
+// ----------------------------------------------------------------------------------
+
+static PointCloud::PointList generatePointCloudParserBenchmarkPoints( unsigned int count )
+{
+    std::srand( 42 );
+
+    PointCloud::PointList points;
+    points.reserve( count );
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        const double x = 500. * std::rand() / RAND_MAX - 250;
+        const double y = 500. * std::rand() / RAND_MAX - 250;
+        const double z = 500. * std::rand() / RAND_MAX - 250;
+        points.push_back( PointCloud::Point( x, y, z ) );
+    }
+    return points;
+}
+
+
+static QByteArray writePointCloudParserBenchmarkXml( const PointCloud::PointList& points )
+{
+    QByteArray data;
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::WriteOnly );
+
+    QXmlStreamWriter xml( &buffer );
+    xml.setAutoFormatting( true );
+    xml.writeStartDocument();
+    xml.writeStartElement( "cloud" );
+    xml.writeAttribute( "name", "benchmark" );
+    xml.writeAttribute( "format", "millimeters" );
+    for( auto p = points.begin(); p != points.end(); ++p )
+    {
+        xml.writeStartElement( "point" );
+        xml.writeAttribute( "x", QString::number( p->x() ) );
+        xml.writeAttribute( "y", QString::number( p->y() ) );
+        xml.writeAttribute( "z", QString::number( p->z() ) );
+        xml.writeEndElement();
+    }
+    xml.writeEndElement();
+    xml.writeEndDocument();
+
+    return data;
+}
+
+
+static QByteArray writePointCloudParserBenchmarkText( const PointCloud::PointList& points )
+{
+    QByteArray data;
+    QTextStream stream( &data, QIODevice::WriteOnly );
+    for( auto p = points.begin(); p != points.end(); ++p )
+    {
+        stream << p->x() << "\t" << p->y() << "\t" << p->z() << "\n";
+    }
+    stream.flush();
+
+    return data;
+}
+
+
+/** \brief  Tells the largest coordinate difference between \a actual and
+  *         \a expected, or throws if their sizes differ.
+  */
+static double comparePointCloudParserBenchmarkPoints( const PointCloud::PointList& actual, const PointCloud::PointList& expected )
+{
+    if( actual.size() != expected.size() )
+    {
+        throw std::runtime_error( "Point counts differ." );
+    }
+
+    double maxError = 0;
+    for( std::size_t i = 0; i < actual.size(); ++i )
+    {
+        maxError = std::max( maxError, ( actual[ i ] - expected[ i ] ).cwiseAbs().maxCoeff() );
+    }
+    return maxError;
+}
+
+
+/** \brief  Runs \a read for \ref POINT_CLOUD_PARSER_BENCHMARK_RUNS times, prints the
+  *         best time and compares the points of the last run to \a expected.
+  */
+static void timePointCloudParserBenchmark
+    ( const char* label
+    , const PointCloud::PointList& expected
+    , const std::function< void( PointCloud::PointList& ) >& read )
+{
+    qint64 bestTime = -1;
+    PointCloud::PointList points;
+    for( unsigned int run = 0; run < POINT_CLOUD_PARSER_BENCHMARK_RUNS; ++run )
+    {
+        PointCloud::PointList().swap( points );
+
+        QElapsedTimer timer;
+        timer.start();
+        read( points );
+        const qint64 time = timer.elapsed();
+
+        bestTime = bestTime < 0 ? time : std::min( bestTime, time );
+    }
+
+    const double error = comparePointCloudParserBenchmarkPoints( points, expected );
+    const double pointsPerSecond = bestTime > 0 ? 1000. * points.size() / bestTime : 0;
+
+    std::cout << "  " << label << ": " << bestTime << " ms, "
+              << static_cast< unsigned long >( pointsPerSecond ) << " points/s, "
+              << "max. error " << error << std::endl;
+}
+
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        const unsigned int count = argc > 1 ? static_cast< unsigned int >( std::atol( argv[ 1 ] ) ) : 1000000;
+
+        const PointCloud::PointList points = generatePointCloudParserBenchmarkPoints( count );
+
+        /* The reference is what the files hold, since the coordinates are written
+         * with six significant digits.
+         */
+        PointCloud::PointList expected;
+        expected.reserve( points.size() );
+        for( auto p = points.begin(); p != points.end(); ++p )
+        {
+            expected.push_back( PointCloud::Point
+                ( QString::number( p->x() ).toDouble()
+                , QString::number( p->y() ).toDouble()
+                , QString::number( p->z() ).toDouble() ) );
+        }
+
+     // XML
+
+        const QByteArray xml = writePointCloudParserBenchmarkXml( points );
+        std::cout << "XML, " << count << " points, " << xml.size() << " bytes" << std::endl;
+
+        timePointCloudParserBenchmark( "QXmlSimpleReader", expected, [&]( PointCloud::PointList& out )
+            {
+                QBuffer buffer;
+                buffer.setData( xml );
+                buffer.open( QIODevice::ReadOnly );
+
+                QXmlInputSource source( &buffer );
+                PointCloudParserBenchmarkHandler handler( out );
+                QXmlSimpleReader reader;
+                reader.setContentHandler( &handler );
+                reader.setErrorHandler( &handler );
+                if( !reader.parse( source ) )
+                {
+                    throw std::runtime_error( "QXmlSimpleReader failed." );
+                }
+            }
+        );
+
+        timePointCloudParserBenchmark( "PointCloudParser", expected, [&]( PointCloud::PointList& out )
+            {
+                const char* const data = xml.constData();
+                const int cloudBegin = xml.indexOf( '>', xml.indexOf( "<cloud" ) ) + 1;
+                const int cloudEnd = xml.lastIndexOf( "</cloud" );
+                PointCloudParser::parseXmlPoints( data + cloudBegin, data + cloudEnd, out );
+            }
+        );
+
+     // text
+
+        const QByteArray text = writePointCloudParserBenchmarkText( points );
+        std::cout << "Text, " << count << " points, " << text.size() << " bytes" << std::endl;
+
+        timePointCloudParserBenchmark( "QTextStream", expected, [&]( PointCloud::PointList& out )
+            {
+                QTextStream stream( text, QIODevice::ReadOnly );
+                double x, y, z;
+                for( stream.skipWhiteSpace(); !stream.atEnd(); stream.skipWhiteSpace() )
+                {
+                    stream >> x >> y >> z;
+                    if( stream.status() != QTextStream::Ok )
+                    {
+                        throw std::runtime_error( "QTextStream failed." );
+                    }
+                    out.push_back( PointCloud::Point( x, y, z ) );
+                }
+            }
+        );
+
+        timePointCloudParserBenchmark( "PointCloudParser", expected, [&]( PointCloud::PointList& out )
+            {
+                PointCloudParser::parseText( text.constData(), text.constData() + text.size(), out );
+            }
+        );
+    }
+    catch( const std::exception& ex )
+    {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
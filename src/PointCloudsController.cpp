@@ -13,6 +13,9 @@
 #include "PointCloudsComponent.h"
 #include "PointCloudsClient.h"
 #include "PointCloud.h"
+#include "PointCloudFile.h"
+#include "PointCloudParser.h"
+#include "PointCloudDecimation.h"
 #include "EmbeddablePlacer.h"
 #include "PointCloud3D.h"
 #include "CarnaContextClient.h"
@@ -33,7 +36,7 @@
 #include <QInputDialog>
 #include <QProgressDialog>
 #include <QApplication>
-#include <QXmlSimpleReader>
+#include <QFileInfo>
 #include <QPushButton>
 #include <QXmlStreamWriter>
 
@@ -118,6 +121,7 @@ PointCloudsController::PointCloudsController( Record::Server& server, PointCloud
     , cloudBuilding    ( new QAction( "From &3D Objects" , this ) )
     , object3dCreation ( new QAction( "Create 3D &Object", this ) )
     , point3dCreation  ( new QAction( "Create 3D &Points", this ) )
+    , cloudDecimation  ( new QAction( "&Decimate..."     , this ) )
 #ifndef NO_CRA
     , recorderWindow( nullptr )
 #endif
@@ -158,6 +162,7 @@ PointCloudsController::PointCloudsController( Record::Server& server, PointCloud
 #endif
     acquireMenu->addAction( cloudExtracting );
     acquireMenu->addAction( cloudBuilding );
+    acquireMenu->addAction( cloudDecimation );
     acquireMenu->addSeparator();
     acquireMenu->addAction( object3dCreation );
     acquireMenu->addAction( point3dCreation );
@@ -179,6 +184,7 @@ PointCloudsController::PointCloudsController( Record::Server& server, PointCloud
     connect( cloudBuilding   , SIGNAL( triggered() ), this, SLOT( createFrom3dObjects() ) );
     connect( object3dCreation, SIGNAL( triggered() ), this, SLOT(      create3dObject() ) );
     connect( point3dCreation , SIGNAL( triggered() ), this, SLOT(      create3dPoints() ) );
+    connect( cloudDecimation , SIGNAL( triggered() ), this, SLOT(  decimatePointCloud() ) );
 
     pointCloudSelectionChanged();
 }
@@ -362,19 +368,13 @@ void PointCloudsController::savePointCloud()
     if( fileExtension == "bin" )
     {
 
-        QDataStream stream( &file );
-        stream << QString::fromStdString( cloud->getName() );
-        stream << ( cloud->getFormat() == PointCloud::volumeUnits );
-        stream << static_cast< unsigned int >( cloud->getList().size() );
-        for( PointCloud::PointList::const_iterator it  = cloud->getList().begin();
-            it != cloud->getList().end();
-            ++it )
+        try
         {
-            const PointCloud::Point& p = *it;
-
-            stream << p.x() << p.y() << p.z();
-
-            progress.setValue( it - cloud->getList().begin() );
+            PointCloudFile::save( file, *cloud );
+        }
+        catch( const std::exception& ex )
+        {
+            QMessageBox::critical( this, "Save Point Cloud", QString::fromStdString( ex.what() ) );
         }
 
     }
@@ -396,7 +396,7 @@ void PointCloudsController::loadPointCloud()
             ( this
             , "Load Point Cloud"
             , ""
-            , "XML files and binary dumps (*.xml *.bin);;XML files (*.xml);;Binary dumps (*.bin)"
+            , "Point clouds (*.xml *.txt *.bin);;XML files (*.xml);;Text dumps (*.txt);;Binary dumps (*.bin)"
             , 0
             , QFileDialog::ReadOnly
             | QFileDialog::HideNameFilterDetails );
@@ -423,196 +423,62 @@ void PointCloudsController::loadPointCloud()
         if( fileExtension == "xml" )
         {
 
-            QXmlSimpleReader xmlReader;
-            QXmlInputSource xmlSource( &file );
-
-            class SaxParser : public QXmlDefaultHandler
-            {
-
-            public:
-
-                SaxParser( Record::Server& server, const QFile& file, QWidget* modalParent )
-                    : cloud( nullptr )
-                    , server( server )
-                    , file( file )
-                    , progress( QFileInfo( file ).fileName(), "", 0, file.size(), modalParent )
-                {
-                    progress.setWindowTitle( "Reading points" );
-                    progress.setWindowModality( Qt::WindowModal );
-                    progress.setCancelButton( nullptr );
-                }
-
-                virtual bool startElement( const QString& namespaceURI, const QString& localName, const QString& qName, const QXmlAttributes& attributes )
-                {
-                    if( localName == "cloud" )
-                    {
-                        if( cloud )
-                        {
-                            return false;
-                        }
-
-                        PointCloud::Unit format;
-                        const QString& format_str = attributes.value( "format" );
-                        if( format_str == "volumeunits" || format_str == "modelunits" )
-                        {
-                            format = PointCloud::volumeUnits;
-                        }
-                        else
-                        if( format_str == "millimeters" )
-                        {
-                            format = PointCloud::millimeters;
-                        }
-                        else
-                        {
-                            return false;
-                        }
-
-                        const QString& source_str = attributes.value( "source" );
-                        PointCloud::Domain source = PointCloud::unknown;
-                        if( source_str == "tracking" )
-                        {
-                            source = PointCloud::trackingSide;
-                        }
-                        else
-                        if( source_str == "data" )
-                        {
-                            source = PointCloud::dataSide;
-                        }
-
-                        const QString name = attributes.value( "name" );
-                        cloud = new PointCloud( server, format, source, name.toStdString() );
-                    }
-                    else
-                    if( localName == "point" )
-                    {
-                        if( !cloud )
-                        {
-                            return false;
-                        }
-
-                        const QString str_x = attributes.value( "x" );
-                        const QString str_y = attributes.value( "y" );
-                        const QString str_z = attributes.value( "z" );
-
-                        bool ok;
-
-                        const double x = str_x.toDouble( &ok );
-                        if( !ok )
-                        {
-                            return false;
-                        }
-
-                        const double y = str_y.toDouble( &ok );
-                        if( !ok )
-                        {
-                            return false;
-                        }
-
-                        const double z = str_z.toDouble( &ok );
-                        if( !ok )
-                        {
-                            return false;
-                        }
-
-                        cloud->getList().push_back( PointCloud::Point( x, y, z ) );
-                    }
-
-                    return true;
-                }
-
-                virtual bool endElement( const QString& namespaceURI, const QString& localName, const QString& qName )
-                {
-                    if( localName == "cloud" )
-                    {
-                        if( !cloud )
-                        {
-                            return false;
-                        }
-
-                        cloud = nullptr;
-                    }
-
-                    progress.setValue( file.pos() );
-
-                    return true;
-                }
-
-            private:
-
-                PointCloud* cloud;
-
-                Record::Server& server;
-
-                const QFile& file;
-
-                QProgressDialog progress;
-
-            }; // Handler
-
-            SaxParser parser( server, file, this );
-            xmlReader.setContentHandler( &parser );
-            xmlReader.setErrorHandler( &parser );
-
             QApplication::setOverrideCursor( Qt::WaitCursor );
 
             try
             {
-                if( !xmlReader.parse( xmlSource ) )
-                {
-                    QMessageBox::critical( this, "Load Point Cloud", "Unexpected file format." );
-                }
+                PointCloudParser::loadXml( file, server );
             }
-            catch( const std::logic_error& ex )
+            catch( const std::exception& ex )
             {
-                std::stringstream ss;
-                ss << "Logical Exception: " << ex.what();
-                QMessageBox::critical( this, "Load Point Cloud", QString::fromStdString( ss.str() ) );
+                QMessageBox::critical( this, "Load Point Cloud", QString::fromStdString( ex.what() ) );
             }
 
             QApplication::restoreOverrideCursor();
 
         }
         else
-        if( fileExtension == "bin" )
+        if( fileExtension == "txt" )
         {
-            QDataStream stream( &file );
-
-            QApplication::setOverrideCursor( Qt::WaitCursor );
-
-            QString name;
-            stream >> name;
 
-            bool isModelUnits;
-            stream >> isModelUnits;
+            /* Text dumps do not tell the units of the points.
+             */
+            QStringList units;
+            units << "Millimeters" << "Volume units";
 
-            unsigned int count;
-            stream >> count;
-
-            PointCloud* const cloud = new PointCloud( server, isModelUnits ? PointCloud::volumeUnits : PointCloud::millimeters, PointCloud::unknown, name.toStdString() );
-
-            QProgressDialog progress( QFileInfo( file ).fileName(), "Cancel", 0, count, this );
-            progress.setWindowTitle( "Reading points" );
-            progress.setWindowModality( Qt::WindowModal );
+            bool ok;
+            const QString unit = QInputDialog::getItem( this, "Load Point Cloud", "Units of " + QFileInfo( file ).fileName() + ":", units, 0, false, &ok );
+            if( !ok )
+            {
+                continue;
+            }
 
-            cloud->getList().resize( count );
+            QApplication::setOverrideCursor( Qt::WaitCursor );
 
-            for( unsigned int i = 0; i < count; ++i )
+            try
+            {
+                PointCloudParser::loadText( file, server, unit == units[ 0 ] ? PointCloud::millimeters : PointCloud::volumeUnits );
+            }
+            catch( const std::exception& ex )
             {
-                if( progress.wasCanceled() )
-                {
-                    cloud->getList().resize( i );
-                    break;
-                }
+                QMessageBox::critical( this, "Load Point Cloud", QString::fromStdString( ex.what() ) );
+            }
 
-                double x, y, z;
-            
-                stream >> x;
-                stream >> y;
-                stream >> z;
+            QApplication::restoreOverrideCursor();
 
-                cloud->getList()[ i ] = PointCloud::Point( x, y, z );
+        }
+        else
+        if( fileExtension == "bin" )
+        {
+            QApplication::setOverrideCursor( Qt::WaitCursor );
 
-                progress.setValue( i );
+            try
+            {
+                PointCloudFile::load( file, server );
+            }
+            catch( const std::exception& ex )
+            {
+                QMessageBox::critical( this, "Load Point Cloud", QString::fromStdString( ex.what() ) );
             }
 
             QApplication::restoreOverrideCursor();
@@ -932,4 +798,65 @@ void PointCloudsController::pointCloudSelectionChanged()
     cloudDetails->setEnabled( someCloudSelected );
     object3dCreation->setEnabled( someCloudSelected );
     point3dCreation->setEnabled( someCloudSelected );
+    cloudDecimation->setEnabled( someCloudSelected );
+}
+
+
+void PointCloudsController::decimatePointCloud()
+{
+    PointCloud* const cloud = getSelectedPointCloud();
+
+    if( !cloud )
+    {
+        return;
+    }
+
+    QStringList methods;
+    methods << "Voxel grid (average per cell)" << "Poisson disk (minimum spacing)";
+
+    bool ok;
+    const QString method = QInputDialog::getItem( this, "Decimate Point Cloud", "Method:", methods, 0, false, &ok );
+    if( !ok )
+    {
+        return;
+    }
+    const bool voxelGrid = ( method == methods[ 0 ] );
+
+    const double spacing = QInputDialog::getDouble
+        ( this
+        , "Decimate Point Cloud"
+        , voxelGrid ? "Cell size (mm):" : "Minimum spacing (mm):"
+        , 1., 0.01, 1000., 2, &ok );
+    if( !ok )
+    {
+        return;
+    }
+
+    PointCloud* const decimated = new PointCloud( *cloud, cloud->getName() + " (decimated)" );
+    decimated->convert( PointCloud::millimeters, this );
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    try
+    {
+        PointCloud::PointList points = voxelGrid
+            ? PointCloudDecimation::voxelGrid  ( decimated->getList(), spacing )
+            : PointCloudDecimation::poissonDisk( decimated->getList(), spacing );
+        decimated->getList().swap( points );
+    }
+    catch( const std::exception& ex )
+    {
+        QApplication::restoreOverrideCursor();
+        delete decimated;
+        QMessageBox::critical( this, "Decimate Point Cloud", QString::fromStdString( ex.what() ) );
+        return;
+    }
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox::information
+        ( this
+        , "Decimate Point Cloud"
+        , QString( "Point cloud '%1' has been created with %2 of %3 points." )
+            .arg( QString::fromStdString( decimated->getName() ) )
+            .arg( decimated->getList().size() )
+            .arg( cloud->getList().size() ) );
 }
@@ -105,6 +105,7 @@ private:
     QAction* const cloudBuilding;   ///< \brief  Opens a new \ref PointCloudCreator "point cloud composer".
     QAction* const object3dCreation;///< \brief  Creates a new \ref PointCloud3D "visual representation" of the selected point cloud.
     QAction* const point3dCreation; ///< \brief  Creates one \c Carna::base::view::Point3D instance for each point within the selected point cloud.
+    QAction* const cloudDecimation; ///< \brief  Creates a \ref PointCloudDecimation "decimated" copy of the selected point cloud.
 
 #ifndef NO_CRA
     /** \brief	References the \ref PointRecorder "point recorder dialog" if it is open or is \c nullptr.
@@ -214,4 +215,11 @@ private slots:
       */
     void createFrom3dObjects();
 
+    /** \brief  Creates a \ref PointCloudDecimation "decimated" copy of the selected point
+      *         cloud, using the method and spacing prompted from the user.
+      *
+      * The copy is specified in millimeters.
+      */
+    void decimatePointCloud();
+
 }; // PointCloudsController
@@ -0,0 +1,200 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "RunLengthMask.h"
+#include "PackedMask.h"
+#include "Slabs.h"
+#include <Carna/base/CarnaException.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+
+
+// ----------------------------------------------------------------------------------
+// RunLengthMask
+// ----------------------------------------------------------------------------------
+
+RunLengthMask::RunLengthMask( const PackedMask& mask )
+    : size( mask.size )
+{
+    CARNA_ASSERT( size.x <= std::numeric_limits< uint16_t >::max() );
+
+    build( [&]( unsigned int y, unsigned int z, std::vector< Run >& rowRuns )
+        {
+            mask.visitSpans( y, z, [&]( unsigned int x0, unsigned int x1 )
+                {
+                    Run run;
+                    run.x0 = static_cast< uint16_t >( x0 );
+                    run.x1 = static_cast< uint16_t >( x1 );
+                    rowRuns.push_back( run );
+                }
+            );
+        }
+    );
+}
+
+
+RunLengthMask::RunLengthMask( const Carna::base::model::BufferedMaskAdapter::BinaryMask& mask )
+    : size( mask.size )
+{
+    CARNA_ASSERT( size.x <= std::numeric_limits< uint16_t >::max() );
+
+    build( [&]( unsigned int y, unsigned int z, std::vector< Run >& rowRuns )
+        {
+            for( unsigned int x = 0; x < size.x; )
+            {
+                while( x < size.x && !mask( x, y, z ) )
+                {
+                    ++x;
+                }
+                if( x == size.x )
+                {
+                    break;
+                }
+
+                Run run;
+                run.x0 = static_cast< uint16_t >( x );
+                while( x < size.x && mask( x, y, z ) )
+                {
+                    ++x;
+                }
+                run.x1 = static_cast< uint16_t >( x );
+                rowRuns.push_back( run );
+            }
+        }
+    );
+}
+
+
+template< typename RowScanner >
+void RunLengthMask::build( const RowScanner& scanRow )
+{
+    const Slabs slabs( size.z );
+    std::vector< std::vector< Run > > slabRuns( slabs.count() );
+    std::vector< std::vector< unsigned int > > slabRowOffsets( slabs.count() );
+
+    slabs.process( [&]( unsigned int slab, unsigned int z0, unsigned int z1 )
+        {
+            std::vector< Run >& runs = slabRuns[ slab ];
+            std::vector< unsigned int >& rowOffsets = slabRowOffsets[ slab ];
+            rowOffsets.reserve( ( z1 - z0 ) * size.y );
+
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                rowOffsets.push_back( runs.size() );
+                scanRow( y, z, runs );
+            }
+        }
+    );
+
+ // concatenate the slabs
+
+    std::size_t runsCount = 0;
+    for( unsigned int slab = 0; slab < slabs.count(); ++slab )
+    {
+        runsCount += slabRuns[ slab ].size();
+    }
+
+    runs.reserve( runsCount + 1 );
+    rowOffsets.reserve( static_cast< std::size_t >( size.y ) * size.z + 1 );
+
+    for( unsigned int slab = 0; slab < slabs.count(); ++slab )
+    {
+        const unsigned int offset = runs.size();
+        const std::vector< unsigned int >& offsets = slabRowOffsets[ slab ];
+        for( auto row = offsets.begin(); row != offsets.end(); ++row )
+        {
+            rowOffsets.push_back( offset + *row );
+        }
+        runs.insert( runs.end(), slabRuns[ slab ].begin(), slabRuns[ slab ].end() );
+
+        std::vector< Run >().swap( slabRuns[ slab ] );
+    }
+
+    rowOffsets.push_back( runs.size() );
+
+    const Run sentinel = { 0, 0 };
+    runs.push_back( sentinel );
+}
+
+
+bool RunLengthMask::test( unsigned int x, unsigned int y, unsigned int z ) const
+{
+    const Run* const first = rowBegin( y, z );
+    const Run* const last  = rowEnd( y, z );
+
+    /* Find the first run which starts after 'x', the run before it is the only one
+     * which may cover 'x'.
+     */
+    const Run* const next = std::upper_bound( first, last, x,
+        []( unsigned int value, const Run& run )->bool
+        {
+            return value < run.x0;
+        }
+    );
+
+    return next != first && x < ( next - 1 )->x1;
+}
+
+
+unsigned long RunLengthMask::count() const
+{
+    unsigned long n = 0;
+    for( std::size_t i = 0; i + 1 < runs.size(); ++i )
+    {
+        n += runs[ i ].x1 - runs[ i ].x0;
+    }
+    return n;
+}
+
+
+std::size_t RunLengthMask::memorySize() const
+{
+    return runs.capacity() * sizeof( Run ) + rowOffsets.capacity() * sizeof( unsigned int );
+}
+
+
+Carna::base::model::BufferedMaskAdapter::BinaryMask* RunLengthMask::toBinaryMask() const
+{
+    typedef Carna::base::model::BufferedMaskAdapter::BinaryMask BinaryMask;
+    std::unique_ptr< BinaryMask > mask( new BinaryMask( size ) );
+
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            BinaryMask& out = *mask;
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                unsigned int x = 0;
+                for( const Run* run = rowBegin( y, z ); run != rowEnd( y, z ); ++run )
+                {
+                    for( ; x < run->x0; ++x )
+                    {
+                        out( x, y, z ) = 0;
+                    }
+                    for( ; x < run->x1; ++x )
+                    {
+                        out( x, y, z ) = 1;
+                    }
+                }
+                for( ; x < size.x; ++x )
+                {
+                    out( x, y, z ) = 0;
+                }
+            }
+        }
+    );
+
+    return mask.release();
+}
@@ -0,0 +1,133 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/model/BufferedMaskAdapter.h>
+#include <vector>
+#include <cstdint>
+
+class PackedMask;
+
+
+
+// ----------------------------------------------------------------------------------
+// RunLengthMask
+// ----------------------------------------------------------------------------------
+
+/** \brief  Binary mask which stores the runs of set voxels row by row.
+  *
+  * Requires memory proportional to the number of runs rather than the number of
+  * voxels, which suits sparse masks like segmentations well.
+  */
+class RunLengthMask
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Defines the run of set voxels \f$[x_0, x_1)\f$ within some row.
+      */
+    struct Run
+    {
+        uint16_t x0, x1;
+    };
+
+
+    /** \brief  Instantiates from \a mask.
+      */
+    explicit RunLengthMask( const PackedMask& mask );
+
+    /** \brief  Instantiates from \a mask.
+      */
+    explicit RunLengthMask( const Carna::base::model::BufferedMaskAdapter::BinaryMask& mask );
+
+
+    /** \brief  Holds the mask's size in voxels.
+      */
+    const Carna::base::Vector3ui size;
+
+
+    /** \brief  Tells whether the voxel \f$(x, y, z)\f$ is set.
+      */
+    bool test( unsigned int x, unsigned int y, unsigned int z ) const;
+
+    /** \brief  Tells the number of set voxels.
+      */
+    unsigned long count() const;
+
+    /** \brief  Tells the number of runs.
+      */
+    std::size_t runsCount() const
+    {
+        return runs.size() - 1;
+    }
+
+    /** \brief  Tells the number of bytes occupied by the runs and the row index.
+      */
+    std::size_t memorySize() const;
+
+    /** \brief  References the first run of the row \f$(y, z)\f$.
+      */
+    const Run* rowBegin( unsigned int y, unsigned int z ) const
+    {
+        return &runs.front() + rowOffsets[ static_cast< std::size_t >( z ) * size.y + y ];
+    }
+
+    /** \brief  References the run after the last one of the row \f$(y, z)\f$.
+      */
+    const Run* rowEnd( unsigned int y, unsigned int z ) const
+    {
+        return &runs.front() + rowOffsets[ static_cast< std::size_t >( z ) * size.y + y + 1 ];
+    }
+
+    /** \brief  Invokes \a visit with \f$(x_0, x_1)\f$ for each run within the row
+      *         \f$(y, z)\f$, in ascending order.
+      */
+    template< typename SpanVisitor >
+    void visitSpans( unsigned int y, unsigned int z, SpanVisitor visit ) const
+    {
+        const std::size_t row = static_cast< std::size_t >( z ) * size.y + y;
+        for( unsigned int i = rowOffsets[ row ]; i < rowOffsets[ row + 1 ]; ++i )
+        {
+            visit( runs[ i ].x0, runs[ i ].x1 );
+        }
+    }
+
+    /** \brief  Creates a \c BinaryMask of the same content.
+      */
+    Carna::base::model::BufferedMaskAdapter::BinaryMask* toBinaryMask() const;
+
+
+private:
+
+    /** \brief  Holds the runs of all rows in memory order.
+      *
+      * A sentinel element is kept at the end, so that rows can always be referenced.
+      */
+    std::vector< Run > runs;
+
+    /** \brief  Maps the row \f$(y, z)\f$ to its first run at \f$z \cdot h + y\f$.
+      *
+      * Holds one additional element which marks the end of the last row.
+      */
+    std::vector< unsigned int > rowOffsets;
+
+    /** \brief  Collects the runs of each row through \a scanRow, which appends the
+      *         runs of the row \f$(y, z)\f$ to the supplied vector.
+      */
+    template< typename RowScanner >
+    void build( const RowScanner& scanRow );
+
+}; // RunLengthMask
@@ -105,7 +105,7 @@ private:
 
     /** \brief	Computes the position of a voxel within the \ref data "voxel buffer".
       */
-    unsigned int getIndex( unsigned int x, unsigned int y, unsigned int z )
+    unsigned int getIndex( unsigned int x, unsigned int y, unsigned int z ) const
     {
         return z * size.x * size.y + y * size.x + x;
     }
@@ -10,12 +10,11 @@
  */
 
 #include "Segmentation.h"
-#include "BinaryVolumeMask.h"
+#include "PackedMask.h"
 #include <Carna/base/model/Scene.h>
 #include <Carna/base/model/Volume.h>
 #include <Carna/base/model/Object3D.h>
 #include <Carna/base/CarnaException.h>
-#include <TRTK/RegionGrowing3D.hpp>
 #include <QApplication>
 #include <QDebug>
 
@@ -28,45 +27,53 @@
 Segmentation::Segmentation( const Carna::base::model::Scene& model
                           , const Carna::base::model::Object3D& seedPointObject
                           , int huv0
-                          , int huv1 )
-    : mask( Carna::base::Vector3ui( model.volume().size ) )
+                          , int huv1
+                          , FloodFill::Connectivity connectivity )
 {
-    BinaryVolumeMask binaryVolumeMask( huv0, huv1, model.volume() );
+    const Carna::base::Vector3ui& size = model.volume().size;
 
-    TRTK::RegionGrowing3D< bool
-                         , MaskType::VoxelType
-                         , BinaryVolumeMask& > regionGrowing3D
-            ( binaryVolumeMask
-            , model.volume().size.x
-            , model.volume().size.y
-            , model.volume().size.z );
+    QApplication::setOverrideCursor( Qt::WaitCursor );
 
-    regionGrowing3D.setNeighborhoodSize( 2 );
+    const Carna::base::Vector3ui seedPoint = getSeedVoxel( model, seedPointObject );
 
-    QApplication::setOverrideCursor( Qt::WaitCursor );
+    // write spans straight into the packed mask
 
-    TRTK::Coordinate< unsigned > seedPoint( 0, 0, 0 );
-    seedPoint.x() = unsigned( seedPointObject.position().toVolumeUnits().x() * ( model.volume().size.x - 1 ) + 0.5 );
-    seedPoint.y() = unsigned( seedPointObject.position().toVolumeUnits().y() * ( model.volume().size.y - 1 ) + 0.5 );
-    seedPoint.z() = unsigned( seedPointObject.position().toVolumeUnits().z() * ( model.volume().size.z - 1 ) + 0.5 );
+    /* The flood fill reports its spans in no particular order, so they are collected
+     * in a packed mask first and compacted into runs afterwards.
+     */
+    PackedMask packedMask( size );
 
-    regionGrowing3D.compute( seedPoint );
+    const FloodFill floodFill( model.volume(), huv0, huv1, connectivity );
+    const unsigned long maskedCount = floodFill.compute( seedPoint,
+        [&]( unsigned int y, unsigned int z, unsigned int x0, unsigned int x1 )
+        {
+            packedMask.fill( y, z, x0, x1 );
+        }
+    );
 
-    if( !regionGrowing3D.getRegions().empty() )
+    mask.reset( new MaskType( packedMask ) );
+
+    if( maskedCount > 0 )
     {
-        const unsigned int maskedCount = regionGrowing3D.getRegions()[ 0 ].size();
-        const unsigned int voxelsCount = model.volume().size.x * model.volume().size.y * model.volume().size.z;
-        const unsigned int maskedRatio = unsigned( ( maskedCount / static_cast< double >( voxelsCount ) ) * 100 + 0.5 );
+        const double voxelsCount = static_cast< double >( size.x ) * size.y * size.z;
+        const unsigned int maskedRatio = unsigned( ( maskedCount / voxelsCount ) * 100 + 0.5 );
 
         qDebug() << "Segmentation: " << maskedRatio << "% have been masked.";
     }
 
+    QApplication::restoreOverrideCursor();
+}
+
 
-    // fetch mask
+Carna::base::Vector3ui Segmentation::getSeedVoxel( const Carna::base::model::Scene& model
+                                                 , const Carna::base::model::Object3D& seedPointObject )
+{
+    const Carna::base::Vector3ui& size = model.volume().size;
 
-    std::copy( regionGrowing3D.getLabelMask()
-             , regionGrowing3D.getLabelMask() + ( mask.getData().size() - 1 )
-             , mask.getData().begin() );
+    Carna::base::Vector3ui seedPoint;
+    seedPoint.x = unsigned( seedPointObject.position().toVolumeUnits().x() * ( size.x - 1 ) + 0.5 );
+    seedPoint.y = unsigned( seedPointObject.position().toVolumeUnits().y() * ( size.y - 1 ) + 0.5 );
+    seedPoint.z = unsigned( seedPointObject.position().toVolumeUnits().z() * ( size.z - 1 ) + 0.5 );
 
-    QApplication::restoreOverrideCursor();
+    return seedPoint;
 }
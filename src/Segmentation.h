@@ -13,7 +13,9 @@
 
 #include <Carna/Carna.h>
 #include <Carna/base/noncopyable.h>
-#include "ScalarField3ui.h"
+#include "RunLengthMask.h"
+#include "FloodFill.h"
+#include <memory>
 
 class PointCloud;
 
@@ -23,6 +25,12 @@ class PointCloud;
 // Segmentation
 // ----------------------------------------------------------------------------------
 
+/** \brief  Masks the voxels within an HUV range which are connected to some seed.
+  *
+  * Segmentations usually cover a small part of the volume, hence the result is kept
+  * as a \ref RunLengthMask. Consumers which scan the mask word-wise create a
+  * \ref PackedMask from it.
+  */
 class Segmentation
 {
 
@@ -30,23 +38,30 @@ class Segmentation
 
 public:
 
-    typedef ScalarField3ui< unsigned short > MaskType;
+    typedef RunLengthMask MaskType;
 
 
     Segmentation( const Carna::base::model::Scene&
                 , const Carna::base::model::Object3D& seedPoint
                 , int huv0
-                , int huv1 );
+                , int huv1
+                , FloodFill::Connectivity connectivity = FloodFill::vertices );
 
 
     const MaskType& getMask() const
     {
-        return mask;
+        return *mask;
     }
 
 
+    /** \brief  Tells the voxel which is closest to \a seedPoint.
+      */
+    static Carna::base::Vector3ui getSeedVoxel( const Carna::base::model::Scene&
+                                              , const Carna::base::model::Object3D& seedPoint );
+
+
 private:
 
-    MaskType mask;
+    std::unique_ptr< MaskType > mask;
 
 }; // Segmentation
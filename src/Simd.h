@@ -0,0 +1,26 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+/** \file   Simd.h
+  * \brief  Defines \c DICOMVIEWER_SSE2 if SSE2 intrinsics are available.
+  *
+  * Code which uses the intrinsics must provide a scalar fallback for the case that
+  * \c DICOMVIEWER_SSE2 is not defined.
+  */
+
+#if defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) || defined( __SSE2__ )
+    #ifndef DICOMVIEWER_SSE2
+        #define DICOMVIEWER_SSE2
+    #endif
+    #include <emmintrin.h>
+#endif
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/base/noncopyable.h>
+#include <QThread>
+#include <QFuture>
+#include <QtConcurrentRun>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <vector>
+
+
+
+// ----------------------------------------------------------------------------------
+// Slabs
+// ----------------------------------------------------------------------------------
+
+/** \brief  Partitions \f$[0, \mathrm{extent})\f$ into contiguous slabs and processes
+  *         them concurrently.
+  *
+  * Volumes are stored z-major, hence partitioning the z-axis yields slabs which are
+  * contiguous in memory. The number of slabs is bounded by
+  * \c QThread::idealThreadCount and by \a minimumSlabSize.
+  */
+class Slabs
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Processes the slab with index \a slab which covers \f$[\mathrm{begin}, \mathrm{end})\f$.
+      */
+    typedef std::function< void( unsigned int slab, unsigned int begin, unsigned int end ) > Job;
+
+
+    /** \brief  Instantiates.
+      */
+    explicit Slabs( unsigned int extent, unsigned int minimumSlabSize = 1 )
+    {
+        const unsigned int maxSlabs = std::max( 1u, extent / std::max( 1u, minimumSlabSize ) );
+        const unsigned int slabs = std::min( maxSlabs, static_cast< unsigned int >( std::max( 1, QThread::idealThreadCount() ) ) );
+
+        bounds.resize( slabs + 1 );
+        for( unsigned int slab = 0; slab <= slabs; ++slab )
+        {
+            bounds[ slab ] = static_cast< unsigned int >( ( static_cast< unsigned long long >( extent ) * slab ) / slabs );
+        }
+    }
+
+
+    /** \brief  Tells the number of slabs.
+      */
+    unsigned int count() const
+    {
+        return bounds.size() - 1;
+    }
+
+    /** \brief  Tells the first index covered by \a slab.
+      */
+    unsigned int begin( unsigned int slab ) const
+    {
+        return bounds[ slab ];
+    }
+
+    /** \brief  Tells the index after the last one covered by \a slab.
+      */
+    unsigned int end( unsigned int slab ) const
+    {
+        return bounds[ slab + 1 ];
+    }
+
+    /** \brief  Tells the partitioned extent.
+      */
+    unsigned int extent() const
+    {
+        return bounds.back();
+    }
+
+
+    /** \brief  Runs \a job once for each slab and blocks until all of them have finished.
+      *
+      * The first slab is processed by the calling thread. If any invocation throws,
+      * the first exception is re-thrown after all slabs have finished.
+      */
+    void process( const Job& job ) const
+    {
+        std::vector< QFuture< void > > futures;
+        for( unsigned int slab = 1; slab < count(); ++slab )
+        {
+            const unsigned int first = begin( slab );
+            const unsigned int last  = end( slab );
+            std::function< void() > processSlab = [&job, slab, first, last]()
+            {
+                job( slab, first, last );
+            };
+            futures.push_back( QtConcurrent::run( processSlab ) );
+        }
+
+        std::exception_ptr failure;
+        bool failed = false;
+        try
+        {
+            job( 0, begin( 0 ), end( 0 ) );
+        }
+        catch( ... )
+        {
+            failure = std::current_exception();
+            failed = true;
+        }
+
+        for( auto future = futures.begin(); future != futures.end(); ++future )
+        {
+            try
+            {
+                future->waitForFinished();
+            }
+            catch( ... )
+            {
+                if( !failed )
+                {
+                    failure = std::current_exception();
+                    failed = true;
+                }
+            }
+        }
+
+        if( failed )
+        {
+            std::rethrow_exception( failure );
+        }
+    }
+
+
+private:
+
+    /** \brief  Holds \f$\mathrm{count}+1\f$ ascending slab boundaries.
+      */
+    std::vector< unsigned int > bounds;
+
+}; // Slabs
@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "Server.h"
+#include <memory>
+
+class VolumeStatistics;
+
+
+
+// ----------------------------------------------------------------------------------
+// Statistics
+// ----------------------------------------------------------------------------------
+
+/** \brief	Defines the volume statistics service.
+  *
+  * The statistics are computed once per loaded dataset.
+  *
+  * \see    \ref Record::Server
+  */
+class Statistics : public Record::GenericService< Statistics >
+{
+
+public:
+
+    /** \brief	References the statistics of the loaded volume.
+      *
+      * Waits until the statistics have been computed.
+      */
+    virtual std::shared_ptr< const VolumeStatistics > volumeStatistics() const = 0;
+
+}; // Statistics
+
+
+template< >
+const std::string Record::GenericService< Statistics >::serviceID = "Statistics";
@@ -0,0 +1,43 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "Statistics.h"
+
+
+
+// ----------------------------------------------------------------------------------
+// StatisticsClient
+// ----------------------------------------------------------------------------------
+
+/** \brief	Defines the volume statistics service client.
+  *
+  * \see    \ref Record::Server
+  */
+class StatisticsClient : public Record::Client< Statistics >
+{
+
+public:
+    
+    /** \copydoc Record::Client::Client
+      */
+    StatisticsClient( Record::Server& server )
+        : Client( server )
+    {
+    }
+
+    virtual std::shared_ptr< const VolumeStatistics > volumeStatistics() const override
+    {
+        return destination.volumeStatistics();
+    }
+
+}; // StatisticsClient
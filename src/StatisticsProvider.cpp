@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "StatisticsProvider.h"
+#include "VolumeStatistics.h"
+#include <Carna/base/model/Volume.h>
+#include <QtConcurrentRun>
+#include <functional>
+
+
+
+// ----------------------------------------------------------------------------------
+// StatisticsProvider
+// ----------------------------------------------------------------------------------
+
+StatisticsProvider::StatisticsProvider( Record::Server& server, const Carna::base::model::Volume& volume )
+    : Provider( server )
+{
+    /* The statistics may have been computed while the volume was loaded already.
+     */
+    const std::shared_ptr< const VolumeStatistics > loaded = VolumeStatistics::find( volume );
+
+    std::function< std::shared_ptr< const VolumeStatistics >() > computeStatistics
+        = [&volume, loaded]()->std::shared_ptr< const VolumeStatistics >
+    {
+        return loaded.get() != nullptr ? loaded : VolumeStatistics::acquire( volume );
+    };
+    statistics = QtConcurrent::run( computeStatistics );
+}
+
+
+StatisticsProvider::~StatisticsProvider()
+{
+    try
+    {
+        statistics.waitForFinished();
+    }
+    catch( ... )
+    {
+    }
+}
+
+
+std::shared_ptr< const VolumeStatistics > StatisticsProvider::volumeStatistics() const
+{
+    return statistics.result();
+}
@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "Statistics.h"
+#include <Carna/Carna.h>
+#include <QFuture>
+
+
+
+// ----------------------------------------------------------------------------------
+// StatisticsProvider
+// ----------------------------------------------------------------------------------
+
+/** \brief	Defines the volume statistics service provider.
+  *
+  * Starts computing the statistics in the background as soon as it is instantiated.
+  *
+  * \see    \ref Record::Server
+  */
+class StatisticsProvider : public Record::Provider< Statistics >
+{
+
+public:
+
+    /** \copydoc Record::Provider::Provider
+      */
+    StatisticsProvider( Record::Server& server, const Carna::base::model::Volume& volume );
+
+    /** \brief  Waits for the computation to finish, if it still runs.
+      */
+    virtual ~StatisticsProvider();
+
+
+    virtual std::shared_ptr< const VolumeStatistics > volumeStatistics() const override;
+
+
+private:
+
+    QFuture< std::shared_ptr< const VolumeStatistics > > statistics;
+
+}; // StatisticsProvider
@@ -10,8 +10,10 @@
  */
 
 #include "SurfaceExtraction.h"
-#include <TRTK/SurfaceExtraction3D.hpp>
+#include "CarnaContextClient.h"
+#include "Slabs.h"
 #include <Carna/base/model/Position.h>
+#include <Carna/base/model/Scene.h>
 #include <QProgressDialog>
 #include <QFuture>
 #include <QtConcurrentRun>
@@ -19,21 +21,100 @@
 
 
 
+/** \brief  Writes those bits of the row \f$(y, z)\f$ to \a boundary, whose voxels are
+  *         set but have at least one unset face-neighbor.
+  *
+  * Voxels beyond the volume are treated as unset, so that the surface is closed.
+  */
+static void computeSurfaceExtractionBoundaryRow( const PackedMask& mask
+                                               , unsigned int y
+                                               , unsigned int z
+                                               , PackedMask::Word* boundary )
+{
+    const Carna::base::Vector3ui& size = mask.size;
+    const PackedMask::Word* const center = mask.row( y, z );
+    const PackedMask::Word* const lower  = y > 0          ? mask.row( y - 1, z ) : nullptr;
+    const PackedMask::Word* const upper  = y + 1 < size.y ? mask.row( y + 1, z ) : nullptr;
+    const PackedMask::Word* const back   = z > 0          ? mask.row( y, z - 1 ) : nullptr;
+    const PackedMask::Word* const front  = z + 1 < size.z ? mask.row( y, z + 1 ) : nullptr;
+
+    /* Padding bits are never set, hence the last voxel of each row is compared against
+     * an unset right neighbor automatically.
+     */
+    const unsigned int TOP_BIT = PackedMask::WORD_BITS - 1;
+    for( unsigned int w = 0; w < mask.rowWords; ++w )
+    {
+        const PackedMask::Word word = center[ w ];
+        if( word == 0 )
+        {
+            boundary[ w ] = 0;
+            continue;
+        }
+
+        const PackedMask::Word left  = ( word << 1 ) | ( w > 0 ? center[ w - 1 ] >> TOP_BIT : 0 );
+        const PackedMask::Word right = ( word >> 1 ) | ( w + 1 < mask.rowWords ? center[ w + 1 ] << TOP_BIT : 0 );
+
+        PackedMask::Word interior = word & left & right;
+        interior &= lower ? lower[ w ] : 0;
+        interior &= upper ? upper[ w ] : 0;
+        interior &= back  ? back [ w ] : 0;
+        interior &= front ? front[ w ] : 0;
+
+        boundary[ w ] = word & ~interior;
+    }
+}
+
+
+
 // ----------------------------------------------------------------------------------
 // SurfaceExtraction
 // ----------------------------------------------------------------------------------
 
 SurfaceExtraction::SurfaceExtraction( QProgressDialog& progress
                                     , Record::Server& server
-                                    , const Segmentation::MaskType& segmentationMask )
-    : cloud( new PointCloud( server, PointCloud::volumeUnits ) )
+                                    , const PackedMask& segmentationMask )
+    : cloud( new PointCloud( server, PointCloud::millimeters ) )
 {
-    const Carna::base::Vector3ui& size = segmentationMask.getSize();
+    const Carna::base::model::Scene& model = CarnaContextClient( server ).model();
+    const Carna::base::Vector3ui& size = segmentationMask.size;
 
-    typedef TRTK::SurfaceExtraction3D< Segmentation::MaskType::VoxelType > MySurfaceExtraction3D;
-    MySurfaceExtraction3D surfaceExtraction3D( &( segmentationMask.getData().front() ), size.x, size.y, size.z );
+    /* Each slab scans its rows in memory order and collects its surface points into a
+     * chunk of its own. The chunks are concatenated once all slabs are done.
+     */
+    const Slabs slabs( size.z );
+    std::vector< PointCloud::PointList > chunks( slabs.count() );
 
-    std::function< void() > extractSurface = [&](){ surfaceExtraction3D.compute(); };
+    std::function< void() > extractSurface = [&]()
+    {
+        slabs.process( [&]( unsigned int slab, unsigned int z0, unsigned int z1 )
+            {
+                PointCloud::PointList& chunk = chunks[ slab ];
+                std::vector< PackedMask::Word > boundary( segmentationMask.rowWords );
+                Carna::base::model::Position position( model );
+
+                for( unsigned int z = z0; z < z1; ++z )
+                for( unsigned int y = 0; y < size.y; ++y )
+                {
+                    computeSurfaceExtractionBoundaryRow( segmentationMask, y, z, &boundary.front() );
+
+                    for( unsigned int w = 0; w < segmentationMask.rowWords; ++w )
+                    {
+                        for( PackedMask::Word bits = boundary[ w ]; bits != 0; bits &= bits - 1 )
+                        {
+                            const unsigned int x = w * PackedMask::WORD_BITS + PackedMask::countTrailingZeros( bits );
+
+                            position.setVolumeUnits( Carna::base::Vector
+                                ( size.x > 1 ? static_cast< double >( x ) / ( size.x - 1 ) : 0.
+                                , size.y > 1 ? static_cast< double >( y ) / ( size.y - 1 ) : 0.
+                                , size.z > 1 ? static_cast< double >( z ) / ( size.z - 1 ) : 0. ) );
+
+                            chunk.push_back( position.toMillimeters() );
+                        }
+                    }
+                }
+            }
+        );
+    };
     QFuture< void > extraction = QtConcurrent::run( extractSurface );
 
     QFutureWatcher< void > watcher;
@@ -41,37 +122,23 @@ SurfaceExtraction::SurfaceExtraction( QProgressDialog& progress
     QObject::connect( &watcher, SIGNAL( finished() ), &progress, SLOT( reset() ) );
     progress.exec();
 
-    // fetch point cloud
-
-    progress.setWindowTitle( "Surface Extraction" );
-    progress.setLabelText( "Fetching point cloud..." );
-    progress.setWindowModality( Qt::WindowModal );
-    progress.setCancelButton( nullptr );
-    progress.setValue( 0 );
-    progress.setMaximum( size.x - 1 );
-    progress.show();
+    /* Rethrows exceptions from the extraction.
+     */
+    extraction.waitForFinished();
 
-    const MySurfaceExtraction3D::data_type* surfaceData = surfaceExtraction3D.getSurface();
+ // fetch point cloud
 
-    for( unsigned int x = 0; x < size.x; ++x )
+    std::size_t pointsCount = 0;
+    for( auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk )
     {
-        for( unsigned int y = 0; y < size.y; ++y )
-        for( unsigned int z = 0; z < size.z; ++z )
-        {
-            const unsigned short mask_val = surfaceData[ z * size.x * size.y + y * size.x + x ];
-
-            // process _FIRST_ surface
-
-            if( mask_val == 1 )
-            {
-                const double ms_x = static_cast< double >( x ) / ( size.x - 1 );
-                const double ms_y = static_cast< double >( y ) / ( size.y - 1 );
-                const double ms_z = static_cast< double >( z ) / ( size.z - 1 );
-
-                cloud->getList().push_back( PointCloud::Point( ms_x, ms_y, ms_z ) );
-            }
-        }
+        pointsCount += chunk->size();
+    }
 
-        progress.setValue( x );
+    PointCloud::PointList& points = cloud->getList();
+    points.reserve( pointsCount );
+    for( auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk )
+    {
+        points.insert( points.end(), chunk->begin(), chunk->end() );
+        PointCloud::PointList().swap( *chunk );
     }
 }
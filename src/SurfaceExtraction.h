@@ -12,7 +12,7 @@
 #pragma once
 
 #include "Server.h"
-#include "Segmentation.h"
+#include "PackedMask.h"
 #include "PointCloud.h"
 
 class QProgressDialog;
@@ -23,6 +23,12 @@ class QProgressDialog;
 // SurfaceExtraction
 // ----------------------------------------------------------------------------------
 
+/** \brief  Creates a point cloud from the boundary voxels of some mask.
+  *
+  * A set voxel is a boundary voxel if any of its six face-neighbors is unset or lies
+  * beyond the volume. The mask is scanned word-wise in memory order, slab-parallel.
+  * The points are specified in \ref PointCloud::millimeters "millimeters".
+  */
 class SurfaceExtraction
 {
 
@@ -30,7 +36,7 @@ class SurfaceExtraction
 
 public:
 
-    SurfaceExtraction( QProgressDialog& progress, Record::Server& server, const Segmentation::MaskType& );
+    SurfaceExtraction( QProgressDialog& progress, Record::Server& server, const PackedMask& );
 
 
     const PointCloud& getPointCloud() const
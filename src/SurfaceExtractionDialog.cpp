@@ -11,10 +11,21 @@
 
 #include "SurfaceExtractionDialog.h"
 #include "SurfaceExtraction.h"
+#include "MeshExportJob.h"
+#include "Segmentation.h"
+#include "IncrementalSegmentation.h"
+#include "ConnectedComponents.h"
+#include "PackedMask.h"
 #include "CarnaContextClient.h"
 #include <Carna/base/qt/Object3DChooser.h>
+#include <Carna/base/model/Scene.h>
+#include <Carna/base/model/Volume.h>
+#include <Carna/base/model/Position.h>
 #include <QFormLayout>
 #include <QSpinBox>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QLabel>
 #include <QPushButton>
 #include <QProgressDialog>
 #include <QMessageBox>
@@ -22,6 +33,57 @@
 #include <QFuture>
 #include <QtConcurrentRun>
 #include <QFutureWatcher>
+#include <QTimer>
+#include <algorithm>
+
+
+
+/** \brief  Creates a polyline which outlines the voxels from \a min to \a max.
+  */
+static Carna::base::view::Polyline* createSurfaceExtractionPreviewBox
+    ( Carna::base::model::Scene& model
+    , const Carna::base::Vector3ui& min
+    , const Carna::base::Vector3ui& max )
+{
+    const Carna::base::Vector3ui& size = model.volume().size;
+    const double x[ 2 ] = { min.x / double( size.x - 1 ), max.x / double( size.x - 1 ) };
+    const double y[ 2 ] = { min.y / double( size.y - 1 ), max.y / double( size.y - 1 ) };
+    const double z[ 2 ] = { min.z / double( size.z - 1 ), max.z / double( size.z - 1 ) };
+
+    /* A single strip, which passes some edges twice, covers all twelve edges.
+     */
+    const static unsigned int CORNERS = 16;
+    const static unsigned int corners[ CORNERS ] = { 0, 1, 3, 2, 0, 4, 5, 1, 5, 7, 3, 7, 6, 2, 6, 4 };
+
+    Carna::base::view::Polyline* const box = new Carna::base::view::Polyline( model, Carna::base::view::Polyline::lineStrip );
+    for( unsigned int i = 0; i < CORNERS; ++i )
+    {
+        const unsigned int corner = corners[ i ];
+        ( *box ) << Carna::base::model::Position::fromVolumeUnits( model, x[ corner & 1 ], y[ ( corner >> 1 ) & 1 ], z[ corner >> 2 ] );
+    }
+    return box;
+}
+
+
+static void reportSurfaceExtraction( QWidget* parent, const SurfaceExtraction& surface )
+{
+    std::stringstream ss;
+    ss << "Point cloud '" << surface.getPointCloud().getName() << "' has been created.";
+
+    if( surface.getPointCloud().getList().empty() )
+    {
+        ss << std::endl << std::endl << "The point cloud is empty.";
+
+        QMessageBox::warning( parent, "Surface Extraction", QString::fromStdString( ss.str() ) );
+    }
+    else
+    {
+        ss << std::endl << std::endl << "The point cloud consists of ";
+        ss << surface.getPointCloud().getList().size() << " points.";
+
+        QMessageBox::information( parent, "Surface Extraction", QString::fromStdString( ss.str() ) );
+    }
+}
 
 
 
@@ -35,6 +97,12 @@ SurfaceExtractionDialog::SurfaceExtractionDialog( Record::Server& server, QWidge
     , seedPointSelector( new Carna::base::qt::Object3DChooser( CarnaContextClient( server ).model() ) )
     , sbHuv0( new QSpinBox() )
     , sbHuv1( new QSpinBox() )
+    , cbConnectivity( new QComboBox() )
+    , cbLivePreview( new QCheckBox( "Live preview" ) )
+    , laRegionSize( new QLabel( "-" ) )
+    , sbComponents( new QSpinBox() )
+    , previewTimer( new QTimer( this ) )
+    , previewOutdated( false )
 {
     QFormLayout* form = new QFormLayout();
     this->setLayout( form );
@@ -55,14 +123,178 @@ SurfaceExtractionDialog::SurfaceExtractionDialog( Record::Server& server, QWidge
     sbHuv1->setMaximum( MAX_HUV );
     sbHuv1->setValue  ( MAX_HUV );
 
+    form->addRow( "Connectivity:", cbConnectivity );
+
+    cbConnectivity->addItem(  "6 (faces)"   , static_cast< int >( FloodFill::faces    ) );
+    cbConnectivity->addItem( "18 (edges)"   , static_cast< int >( FloodFill::edges    ) );
+    cbConnectivity->addItem( "26 (vertices)", static_cast< int >( FloodFill::vertices ) );
+    cbConnectivity->setCurrentIndex( 2 );
+
+    form->addRow( cbLivePreview );
+    form->addRow( "Region size:", laRegionSize );
+
+    /* The preview is updated once the settings have not changed for a moment, so
+     * that stepping through the HUV range does not block the GUI on every step.
+     */
+    previewTimer->setSingleShot( true );
+    previewTimer->setInterval( 250 );
+    connect( previewTimer, SIGNAL( timeout() ), this, SLOT( updatePreview() ) );
+    connect( &previewWorker, SIGNAL( finished() ), this, SLOT( previewUpdated() ) );
+
+    connect( sbHuv0, SIGNAL( valueChanged( int ) ), this, SLOT( schedulePreview() ) );
+    connect( sbHuv1, SIGNAL( valueChanged( int ) ), this, SLOT( schedulePreview() ) );
+    connect( cbConnectivity, SIGNAL( currentIndexChanged( int ) ), this, SLOT( schedulePreview() ) );
+    connect( cbLivePreview, SIGNAL( toggled( bool ) ), this, SLOT( schedulePreview() ) );
+    connect( seedPointSelector, SIGNAL( selectionChanged() ), this, SLOT( schedulePreview() ) );
+
     QPushButton* const buExtract = new QPushButton( "Extract surface" );
     connect( buExtract, SIGNAL( clicked() ), this, SLOT( run() ) );
     form->addRow( buExtract );
+
+    QPushButton* const buExportMesh = new QPushButton( "Export mesh..." );
+    connect( buExportMesh, SIGNAL( clicked() ), this, SLOT( exportMesh() ) );
+    form->addRow( buExportMesh );
+
+    sbComponents->setMinimum( 1 );
+    sbComponents->setMaximum( 1000 );
+    sbComponents->setValue  ( 1 );
+    form->addRow( "Largest components:", sbComponents );
+
+    QPushButton* const buExtractComponents = new QPushButton( "Extract largest components" );
+    connect( buExtractComponents, SIGNAL( clicked() ), this, SLOT( runLargestComponents() ) );
+    form->addRow( buExtractComponents );
 }
 
 
 SurfaceExtractionDialog::~SurfaceExtractionDialog()
 {
+    previewWorker.waitForFinished();
+}
+
+
+FloodFill::Connectivity SurfaceExtractionDialog::connectivity() const
+{
+    return static_cast< FloodFill::Connectivity >( cbConnectivity->itemData( cbConnectivity->currentIndex() ).toInt() );
+}
+
+
+bool SurfaceExtractionDialog::isPreviewCurrent() const
+{
+    if( preview.get() == nullptr || !seedPointSelector->isObject3DSelected() )
+    {
+        return false;
+    }
+
+    const Carna::base::Vector3ui seed = Segmentation::getSeedVoxel
+        ( CarnaContextClient( server ).model(), seedPointSelector->selectedObject3D() );
+
+    return preview->seed.x == seed.x
+        && preview->seed.y == seed.y
+        && preview->seed.z == seed.z
+        && preview->connectivity == connectivity()
+        && preview->huv0() == sbHuv0->value()
+        && preview->huv1() == sbHuv1->value();
+}
+
+
+void SurfaceExtractionDialog::schedulePreview()
+{
+    previewTimer->start();
+}
+
+
+void SurfaceExtractionDialog::updatePreview()
+{
+    /* The running update is followed by another one, since the settings have
+     * changed meanwhile.
+     */
+    if( previewWorker.isRunning() )
+    {
+        previewOutdated = true;
+        return;
+    }
+
+    previewBox.reset();
+
+    if( !cbLivePreview->isChecked() || !seedPointSelector->isObject3DSelected() )
+    {
+        preview.reset();
+        laRegionSize->setText( "-" );
+        return;
+    }
+
+    const Carna::base::model::Scene& model = CarnaContextClient( server ).model();
+    const Carna::base::Vector3ui seed = Segmentation::getSeedVoxel( model, seedPointSelector->selectedObject3D() );
+    const FloodFill::Connectivity connectivity = this->connectivity();
+    const int huv0 = sbHuv0->value();
+    const int huv1 = sbHuv1->value();
+
+ // restart the session if anything but the HUV range has changed
+
+    const bool restart = preview.get() == nullptr
+        || preview->seed.x != seed.x
+        || preview->seed.y != seed.y
+        || preview->seed.z != seed.z
+        || preview->connectivity != connectivity;
+
+    if( restart )
+    {
+        preview.reset();
+    }
+
+ // update the session on a worker thread, so that the GUI stays responsive
+
+    laRegionSize->setText( "Updating..." );
+
+    const Carna::base::model::Volume* const volume = &model.volume();
+    std::function< void() > update = [this, restart, volume, seed, connectivity, huv0, huv1]()
+    {
+        try
+        {
+            if( restart )
+            {
+                preview.reset( new IncrementalSegmentation( *volume, seed, connectivity ) );
+            }
+            preview->update( huv0, huv1 );
+        }
+        catch( const std::bad_alloc& )
+        {
+            preview.reset();
+        }
+    };
+    previewWorker.setFuture( QtConcurrent::run( update ) );
+}
+
+
+void SurfaceExtractionDialog::previewUpdated()
+{
+    if( previewOutdated )
+    {
+        previewOutdated = false;
+        updatePreview();
+        return;
+    }
+
+    if( preview.get() == nullptr )
+    {
+        laRegionSize->setText( "-" );
+        return;
+    }
+
+    Carna::base::model::Scene& model = CarnaContextClient( server ).model();
+    const Carna::base::Vector3ui& size = model.volume().size;
+    const double voxelsCount = static_cast< double >( size.x ) * size.y * size.z;
+    laRegionSize->setText( QString( "%1 voxels (%2%)" )
+        .arg( preview->count() )
+        .arg( 100 * preview->count() / voxelsCount, 0, 'f', 1 ) );
+
+ // outline the region
+
+    Carna::base::Vector3ui min, max;
+    if( preview->bounds( min, max ) )
+    {
+        previewBox.reset( createSurfaceExtractionPreviewBox( model, min, max ) );
+    }
 }
 
 
@@ -77,6 +309,7 @@ void SurfaceExtractionDialog::run()
 
     const int huv0 = sbHuv0->value();
     const int huv1 = sbHuv1->value();
+    const FloodFill::Connectivity connectivity = this->connectivity();
 
     if( huv1 <= huv0 )
     {
@@ -91,6 +324,21 @@ void SurfaceExtractionDialog::run()
     status.setCancelButton( nullptr );
     status.setWindowTitle( "Surface Extraction" );
 
+ // reuse the region of the live preview, if it is up to date
+
+    previewWorker.waitForFinished();
+    if( isPreviewCurrent() )
+    {
+        status.setLabelText( "Performing surface extraction..." );
+
+        SurfaceExtraction surface( status, server, preview->region() );
+
+        QApplication::restoreOverrideCursor();
+
+        reportSurfaceExtraction( this, surface );
+        return;
+    }
+
  // perform segmentation
 
     status.setLabelText( "Performing segmentation..." );
@@ -100,7 +348,7 @@ void SurfaceExtractionDialog::run()
     {
         try
         {
-            return new Segmentation( CarnaContextClient( server ).model(), seedPoint, huv0, huv1 );
+            return new Segmentation( CarnaContextClient( server ).model(), seedPoint, huv0, huv1, connectivity );
         }
         catch( const std::bad_alloc& ex )
         {
@@ -130,30 +378,103 @@ void SurfaceExtractionDialog::run()
 
         status.setLabelText( "Performing surface extraction..." );
 
-        SurfaceExtraction surface( status, server, segmentation.result()->getMask() );
+        std::unique_ptr< const Segmentation > result( segmentation.result() );
+        const PackedMask mask( result->getMask() );
+        result.reset();
 
-     // finish
+        SurfaceExtraction surface( status, server, mask );
 
-        delete segmentation.result();
+     // finish
 
         QApplication::restoreOverrideCursor();
 
-        std::stringstream ss;
-        ss << "Point cloud '" << surface.getPointCloud().getName() << "' has been created.";
+        reportSurfaceExtraction( this, surface );
 
-        if( surface.getPointCloud().getList().empty() )
+        CARNA_ASSERT( errors.str().empty() );
+    }
+    catch( const QtConcurrent::UnhandledException& )
+    {
+        const std::string errors_str = errors.str();
+        if( errors_str.empty() )
         {
-            ss << std::endl << std::endl << "The point cloud is empty.";
-
-            QMessageBox::warning( this, "Surface Extraction", QString::fromStdString( ss.str() ) );
+            throw;
         }
         else
         {
-            ss << std::endl << std::endl << "The point cloud consists of ";
-            ss << surface.getPointCloud().getList().size() << " points.";
+            throw std::runtime_error( errors_str );
+        }
+    }
+}
+
 
-            QMessageBox::information( this, "Surface Extraction", QString::fromStdString( ss.str() ) );
+void SurfaceExtractionDialog::runLargestComponents()
+{
+    const int huv0 = sbHuv0->value();
+    const int huv1 = sbHuv1->value();
+    const FloodFill::Connectivity connectivity = this->connectivity();
+    const unsigned int componentsCount = sbComponents->value();
+
+    if( huv1 <= huv0 )
+    {
+        QMessageBox::critical( this, "Surface Extraction", "The minimal HU value must be lesser than the maximal HU value." );
+        return;
+    }
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+
+    QProgressDialog status( "Labelling connected components...", "", 0, 0, this );
+    status.setWindowModality( Qt::WindowModal );
+    status.setCancelButton( nullptr );
+    status.setWindowTitle( "Surface Extraction" );
+
+ // perform labelling
+
+    std::stringstream errors;
+    std::function< PackedMask*() > computeMask = [&]()->PackedMask*
+    {
+        try
+        {
+            const ConnectedComponents components
+                ( CarnaContextClient( server ).model().volume(), huv0, huv1, connectivity );
+            return components.keepLargest( componentsCount );
+        }
+        catch( const std::bad_alloc& ex )
+        {
+            errors << "Not enough memory to finish operation.";
+            const std::string ex_msg( ex.what() );
+            if( !ex_msg.empty() )
+            {
+                errors << std::endl << std::endl << ex_msg;
+            }
+            throw;
+        }
+        catch( const std::exception& ex )
+        {
+            errors << ex.what();
+            throw;
         }
+    };
+    QFuture< PackedMask* > mask = QtConcurrent::run( computeMask );
+    try
+    {
+        QFutureWatcher< PackedMask* > watcher;
+        watcher.setFuture( mask );
+        connect( &watcher, SIGNAL( finished() ), &status, SLOT( reset() ) );
+        status.exec();
+
+        const std::unique_ptr< PackedMask > result( mask.result() );
+
+     // perform surface extraction
+
+        status.setLabelText( "Performing surface extraction..." );
+
+        SurfaceExtraction surface( status, server, *result );
+
+     // finish
+
+        QApplication::restoreOverrideCursor();
+
+        reportSurfaceExtraction( this, surface );
 
         CARNA_ASSERT( errors.str().empty() );
     }
@@ -170,3 +491,38 @@ void SurfaceExtractionDialog::run()
         }
     }
 }
+
+
+void SurfaceExtractionDialog::exportMesh()
+{
+    if( !seedPointSelector->isObject3DSelected() )
+    {
+        QMessageBox::critical( this, "Export Mesh", "No seed point selected." );
+        return;
+    }
+    const Carna::base::model::Object3D& seedPoint = seedPointSelector->selectedObject3D();
+
+    const int huv0 = sbHuv0->value();
+    const int huv1 = sbHuv1->value();
+    const FloodFill::Connectivity connectivity = this->connectivity();
+
+    if( huv1 <= huv0 )
+    {
+        QMessageBox::critical( this, "Export Mesh", "The minimal HU value must be lesser than the maximal HU value." );
+        return;
+    }
+
+    const Carna::base::model::Scene* const model = &CarnaContextClient( server ).model();
+    const Carna::base::model::Object3D* const seed = &seedPoint;
+    const Carna::base::Vector spacing( model->spacingX(), model->spacingY(), model->spacingZ() );
+
+    /* The segmentation is performed by the job, whose progress dialog blocks this
+     * dialog and the seed point meanwhile.
+     */
+    MeshExportJob::run( this, "Export Mesh", [model, seed, huv0, huv1, connectivity]()->std::shared_ptr< const PackedMask >
+        {
+            const Segmentation segmentation( *model, *seed, huv0, huv1, connectivity );
+            return std::shared_ptr< const PackedMask >( new PackedMask( segmentation.getMask() ) );
+        }
+        , spacing );
+}
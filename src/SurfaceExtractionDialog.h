@@ -12,10 +12,19 @@
 #pragma once
 
 #include "Server.h"
+#include "FloodFill.h"
 #include <Carna/Carna.h>
+#include <Carna/base/view/Polyline.h>
 #include <QWidget>
+#include <QFutureWatcher>
+#include <memory>
 
 class QSpinBox;
+class QComboBox;
+class QCheckBox;
+class QLabel;
+class QTimer;
+class IncrementalSegmentation;
 
 
 
@@ -56,9 +65,70 @@ private:
 
     QSpinBox* const sbHuv1;
 
+    QComboBox* const cbConnectivity;
+
+    QCheckBox* const cbLivePreview;
+
+    QLabel* const laRegionSize;
+
+    QSpinBox* const sbComponents;
+
+    /** \brief  Holds the segmentation which is updated while the HUV range is tuned.
+      */
+    std::unique_ptr< IncrementalSegmentation > preview;
+
+    /** \brief  Delays \ref updatePreview until the settings stop changing.
+      */
+    QTimer* const previewTimer;
+
+    /** \brief  Outlines the bounding box of the \ref preview region in the views.
+      */
+    std::unique_ptr< Carna::base::view::Polyline > previewBox;
+
+    /** \brief  Runs the update of the \ref preview in the background.
+      *
+      * The \ref preview must not be accessed while the worker is running.
+      */
+    QFutureWatcher< void > previewWorker;
+
+    /** \brief  Tells whether the settings have changed during the running update.
+      */
+    bool previewOutdated;
+
+
+    FloodFill::Connectivity connectivity() const;
+
+    /** \brief  Tells whether \ref preview matches the current seed point, HUV range
+      *         and connectivity.
+      */
+    bool isPreviewCurrent() const;
+
 
 private slots:
 
     void run();
 
+    /** \brief  Extracts the surface of the largest connected components within the
+      *         HUV range, without any seed point.
+      */
+    void runLargestComponents();
+
+    /** \brief  Writes the mesh of the segmentation to a file in the background.
+      */
+    void exportMesh();
+
+    /** \brief  Restarts the \ref previewTimer.
+      */
+    void schedulePreview();
+
+    /** \brief  Starts updating the \ref preview in the background, if the live
+      *         preview is enabled.
+      */
+    void updatePreview();
+
+    /** \brief  Updates the displayed region size and the \ref previewBox once the
+      *         \ref preview was updated.
+      */
+    void previewUpdated();
+
 }; // SurfaceExtractionDialog
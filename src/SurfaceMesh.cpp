@@ -0,0 +1,533 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "SurfaceMesh.h"
+#include "PackedMask.h"
+#include "Slabs.h"
+#include <Carna/base/CarnaException.h>
+#include <QIODevice>
+#include <QAtomicInt>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+
+
+
+/** \brief  Holds the vertices and their cells of the cell z-slab \f$[k_0, k_1)\f$.
+  */
+struct SurfaceMeshSlab
+{
+    /** \brief  References the vertex of the cell at \a x within some cell row.
+      */
+    struct Cell
+    {
+        uint32_t x;
+        uint32_t vertex;
+    };
+
+    std::vector< SurfaceMesh::Vertex > vertices;
+
+    std::vector< Cell > cells;
+
+    /** \brief  Maps the cell row \f$(j, k)\f$ to its first cell at \f$(k - k_0) \cdot (h + 1) + j\f$.
+      */
+    std::vector< uint32_t > rowOffsets;
+
+    /** \brief  Holds the index of the first vertex of this slab within the mesh.
+      */
+    uint32_t firstVertex;
+};
+
+
+/** \brief  References the row \f$(y, z)\f$ of \a mask, or \c nullptr if it lies beyond.
+  */
+static const PackedMask::Word* surfaceMeshRow( const PackedMask& mask, int y, int z )
+{
+    if( y < 0 || z < 0 || y >= static_cast< int >( mask.size.y ) || z >= static_cast< int >( mask.size.z ) )
+    {
+        return nullptr;
+    }
+    else
+    {
+        return mask.row( y, z );
+    }
+}
+
+
+static bool surfaceMeshTest( const PackedMask& mask, int x, int y, int z )
+{
+    if( x < 0 || x >= static_cast< int >( mask.size.x ) )
+    {
+        return false;
+    }
+    const PackedMask::Word* const row = surfaceMeshRow( mask, y, z );
+    return row != nullptr && ( ( row[ x / PackedMask::WORD_BITS ] >> ( x % PackedMask::WORD_BITS ) ) & 1 ) != 0;
+}
+
+
+/** \brief  Tells the word \a w of \a row, which may be \c nullptr or shorter than \a w.
+  */
+static PackedMask::Word surfaceMeshWord( const PackedMask& mask, const PackedMask::Word* row, unsigned int w )
+{
+    return row != nullptr && w < mask.rowWords ? row[ w ] : 0;
+}
+
+
+/** \brief  Places the vertex of the cell \f$(i, j, k)\f$, which covers the voxels
+  *         \f$[i - 1, i] \times [j - 1, j] \times [k - 1, k]\f$.
+  */
+static SurfaceMesh::Vertex surfaceMeshPlaceVertex( const PackedMask& mask
+                                                 , int i, int j, int k
+                                                 , const Carna::base::Vector& spacing )
+{
+    bool corners[ 2 ][ 2 ][ 2 ];
+    for( int dz = 0; dz < 2; ++dz )
+    for( int dy = 0; dy < 2; ++dy )
+    for( int dx = 0; dx < 2; ++dx )
+    {
+        corners[ dz ][ dy ][ dx ] = surfaceMeshTest( mask, i - 1 + dx, j - 1 + dy, k - 1 + dz );
+    }
+
+    double sx = 0, sy = 0, sz = 0;
+    unsigned int crossings = 0;
+    for( int a = 0; a < 2; ++a )
+    for( int b = 0; b < 2; ++b )
+    {
+        if( corners[ a ][ b ][ 0 ] != corners[ a ][ b ][ 1 ] )
+        {
+            sx += 0.5; sy += b; sz += a;
+            ++crossings;
+        }
+        if( corners[ a ][ 0 ][ b ] != corners[ a ][ 1 ][ b ] )
+        {
+            sx += b; sy += 0.5; sz += a;
+            ++crossings;
+        }
+        if( corners[ 0 ][ a ][ b ] != corners[ 1 ][ a ][ b ] )
+        {
+            sx += b; sy += a; sz += 0.5;
+            ++crossings;
+        }
+    }
+    CARNA_ASSERT( crossings > 0 );
+
+    SurfaceMesh::Vertex vertex;
+    vertex.x = static_cast< float >( ( i - 1 + sx / crossings ) * spacing.x() );
+    vertex.y = static_cast< float >( ( j - 1 + sy / crossings ) * spacing.y() );
+    vertex.z = static_cast< float >( ( k - 1 + sz / crossings ) * spacing.z() );
+    return vertex;
+}
+
+
+static void appendSurfaceMeshUInt32( std::vector< char >& buffer, uint32_t value )
+{
+    buffer.push_back( static_cast< char >(   value         & 0xFF ) );
+    buffer.push_back( static_cast< char >( ( value >>  8 ) & 0xFF ) );
+    buffer.push_back( static_cast< char >( ( value >> 16 ) & 0xFF ) );
+    buffer.push_back( static_cast< char >( ( value >> 24 ) & 0xFF ) );
+}
+
+
+static void appendSurfaceMeshFloat( std::vector< char >& buffer, float value )
+{
+    uint32_t bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+    appendSurfaceMeshUInt32( buffer, bits );
+}
+
+
+static void appendSurfaceMeshVertex( std::vector< char >& buffer, const SurfaceMesh::Vertex& vertex )
+{
+    appendSurfaceMeshFloat( buffer, vertex.x );
+    appendSurfaceMeshFloat( buffer, vertex.y );
+    appendSurfaceMeshFloat( buffer, vertex.z );
+}
+
+
+static void writeSurfaceMeshBuffer( QIODevice& out, std::vector< char >& buffer )
+{
+    if( !buffer.empty() && out.write( &buffer.front(), buffer.size() ) != static_cast< qint64 >( buffer.size() ) )
+    {
+        throw std::runtime_error( "Failed writing mesh." );
+    }
+    buffer.clear();
+}
+
+
+const static std::size_t SURFACE_MESH_BLOCK_SIZE = 1 << 20;
+
+
+
+// ----------------------------------------------------------------------------------
+// SurfaceMesh
+// ----------------------------------------------------------------------------------
+
+SurfaceMesh::SurfaceMesh( const PackedMask& mask, const Carna::base::Vector& spacing, const Progress& progress )
+{
+    compute( mask, spacing, progress );
+}
+
+
+SurfaceMesh::SurfaceMesh( const Carna::base::model::BufferedMaskAdapter::BinaryMask& mask, const Carna::base::Vector& spacing, const Progress& progress )
+{
+    compute( PackedMask( mask ), spacing, progress );
+}
+
+
+void SurfaceMesh::compute( const PackedMask& mask, const Carna::base::Vector& spacing, const Progress& progress )
+{
+    const Carna::base::Vector3ui& size = mask.size;
+    const unsigned int TOP_BIT = PackedMask::WORD_BITS - 1;
+
+    /* Each pass reports every finished z-layer of cells.
+     */
+    const double layersCount = 2. * ( size.z + 1 );
+    QAtomicInt layersDone( 0 );
+    QAtomicInt aborted( 0 );
+    const auto finishLayer = [&]()->bool
+    {
+        if( aborted != 0 )
+        {
+            return false;
+        }
+        const int layers = layersDone.fetchAndAddOrdered( 1 ) + 1;
+        if( progress && !progress( layers / layersCount ) )
+        {
+            aborted.fetchAndStoreOrdered( 1 );
+            return false;
+        }
+        return true;
+    };
+
+    /* A row of cells is one longer than a row of voxels.
+     */
+    const unsigned int cellWords = size.x / PackedMask::WORD_BITS + 1;
+
+ // place the vertices of the cells [0, size.z]
+
+    const Slabs cellSlabs( size.z + 1 );
+    std::vector< SurfaceMeshSlab > slabs( cellSlabs.count() );
+
+    cellSlabs.process( [&]( unsigned int slab, unsigned int k0, unsigned int k1 )
+        {
+            SurfaceMeshSlab& out = slabs[ slab ];
+            out.rowOffsets.reserve( ( k1 - k0 ) * ( size.y + 1 ) + 1 );
+
+            for( unsigned int k = k0; k < k1; ++k )
+            {
+                for( unsigned int j = 0; j <= size.y; ++j )
+                {
+                    out.rowOffsets.push_back( out.cells.size() );
+
+                    const int y = static_cast< int >( j ) - 1;
+                    const int z = static_cast< int >( k ) - 1;
+                    const PackedMask::Word* const rows[ 4 ] =
+                    {
+                        surfaceMeshRow( mask, y    , z     ),
+                        surfaceMeshRow( mask, y + 1, z     ),
+                        surfaceMeshRow( mask, y    , z + 1 ),
+                        surfaceMeshRow( mask, y + 1, z + 1 )
+                    };
+
+                    PackedMask::Word previousAny = 0;
+                    PackedMask::Word previousAll = 0;
+                    for( unsigned int w = 0; w < cellWords; ++w )
+                    {
+                        PackedMask::Word any = 0;
+                        PackedMask::Word all = ~PackedMask::Word( 0 );
+                        for( unsigned int r = 0; r < 4; ++r )
+                        {
+                            const PackedMask::Word word = surfaceMeshWord( mask, rows[ r ], w );
+                            any |= word;
+                            all &= word;
+                        }
+
+                        /* The cell i covers the voxels i - 1 and i of each row.
+                         */
+                        const PackedMask::Word cellAny = any | ( any << 1 ) | ( previousAny >> TOP_BIT );
+                        const PackedMask::Word cellAll = all & ( ( all << 1 ) | ( previousAll >> TOP_BIT ) );
+                        previousAny = any;
+                        previousAll = all;
+
+                        for( PackedMask::Word active = cellAny & ~cellAll; active != 0; active &= active - 1 )
+                        {
+                            const unsigned int i = w * PackedMask::WORD_BITS + PackedMask::countTrailingZeros( active );
+                            const SurfaceMeshSlab::Cell cell = { i, static_cast< uint32_t >( out.vertices.size() ) };
+                            out.cells.push_back( cell );
+                            out.vertices.push_back( surfaceMeshPlaceVertex( mask, i, j, k, spacing ) );
+                        }
+                    }
+                }
+
+                if( !finishLayer() )
+                {
+                    return;
+                }
+            }
+            out.rowOffsets.push_back( out.cells.size() );
+        }
+    );
+
+    if( aborted != 0 )
+    {
+        return;
+    }
+
+    std::size_t verticesCount = 0;
+    for( auto slab = slabs.begin(); slab != slabs.end(); ++slab )
+    {
+        CARNA_ASSERT( verticesCount + slab->vertices.size() <= std::numeric_limits< uint32_t >::max() );
+        slab->firstVertex = static_cast< uint32_t >( verticesCount );
+        verticesCount += slab->vertices.size();
+    }
+
+    const auto vertexAt = [&]( unsigned int i, unsigned int j, unsigned int k )->uint32_t
+    {
+        unsigned int slab = 0;
+        while( k >= cellSlabs.end( slab ) )
+        {
+            ++slab;
+        }
+        const SurfaceMeshSlab& in = slabs[ slab ];
+        const std::size_t row = static_cast< std::size_t >( k - cellSlabs.begin( slab ) ) * ( size.y + 1 ) + j;
+
+        SurfaceMeshSlab::Cell key = { i, 0 };
+        const auto cell = std::lower_bound( in.cells.begin() + in.rowOffsets[ row ]
+                                          , in.cells.begin() + in.rowOffsets[ row + 1 ]
+                                          , key
+                                          , []( const SurfaceMeshSlab::Cell& c1, const SurfaceMeshSlab::Cell& c2 )
+                                            {
+                                                return c1.x < c2.x;
+                                            }
+                                          );
+
+        CARNA_ASSERT( cell != in.cells.begin() + in.rowOffsets[ row + 1 ] && cell->x == i );
+        return in.firstVertex + cell->vertex;
+    };
+
+ // create the faces of the voxel pairs, where the upper voxel lies at z in [0, size.z]
+
+    const Slabs faceSlabs( size.z + 1 );
+    std::vector< std::vector< Triangle > > chunks( faceSlabs.count() );
+
+    faceSlabs.process( [&]( unsigned int slab, unsigned int t0, unsigned int t1 )
+        {
+            std::vector< Triangle >& out = chunks[ slab ];
+
+            /* Adds the quad (v0, v1, v2, v3), reversed if 'flip' is set.
+             */
+            const auto addQuad = [&]( uint32_t v0, uint32_t v1, uint32_t v2, uint32_t v3, bool flip )
+            {
+                if( flip )
+                {
+                    std::swap( v1, v3 );
+                }
+                const Triangle triangle1 = { { v0, v1, v2 } };
+                const Triangle triangle2 = { { v0, v2, v3 } };
+                out.push_back( triangle1 );
+                out.push_back( triangle2 );
+            };
+
+            for( unsigned int t = t0; t < t1; ++t )
+            {
+                const int z = static_cast< int >( t );
+
+             // pairs along x and y within the voxel slice z
+
+                if( t < size.z )
+                {
+                    for( unsigned int y = 0; y < size.y; ++y )
+                    {
+                        const PackedMask::Word* const row = surfaceMeshRow( mask, y, z );
+                        PackedMask::Word previous = 0;
+                        for( unsigned int w = 0; w < cellWords; ++w )
+                        {
+                            const PackedMask::Word word = surfaceMeshWord( mask, row, w );
+                            const PackedMask::Word lower = ( word << 1 ) | ( previous >> TOP_BIT );
+                            previous = word;
+
+                            /* The bit i is set if the voxels i - 1 and i differ.
+                             */
+                            for( PackedMask::Word changes = word ^ lower; changes != 0; changes &= changes - 1 )
+                            {
+                                const unsigned int bit = PackedMask::countTrailingZeros( changes );
+                                const unsigned int i = w * PackedMask::WORD_BITS + bit;
+                                addQuad( vertexAt( i, y    , t     )
+                                       , vertexAt( i, y + 1, t     )
+                                       , vertexAt( i, y + 1, t + 1 )
+                                       , vertexAt( i, y    , t + 1 )
+                                       , ( ( lower >> bit ) & 1 ) == 0 );
+                            }
+                        }
+                    }
+
+                    for( int y = -1; y < static_cast< int >( size.y ); ++y )
+                    {
+                        const PackedMask::Word* const row0 = surfaceMeshRow( mask, y    , z );
+                        const PackedMask::Word* const row1 = surfaceMeshRow( mask, y + 1, z );
+                        for( unsigned int w = 0; w < mask.rowWords; ++w )
+                        {
+                            const PackedMask::Word lower = surfaceMeshWord( mask, row0, w );
+                            for( PackedMask::Word changes = lower ^ surfaceMeshWord( mask, row1, w ); changes != 0; changes &= changes - 1 )
+                            {
+                                const unsigned int bit = PackedMask::countTrailingZeros( changes );
+                                const unsigned int x = w * PackedMask::WORD_BITS + bit;
+                                addQuad( vertexAt( x    , y + 1, t     )
+                                       , vertexAt( x    , y + 1, t + 1 )
+                                       , vertexAt( x + 1, y + 1, t + 1 )
+                                       , vertexAt( x + 1, y + 1, t     )
+                                       , ( ( lower >> bit ) & 1 ) == 0 );
+                            }
+                        }
+                    }
+                }
+
+             // pairs along z between the voxel slices z - 1 and z
+
+                for( unsigned int y = 0; y < size.y; ++y )
+                {
+                    const PackedMask::Word* const row0 = surfaceMeshRow( mask, y, z - 1 );
+                    const PackedMask::Word* const row1 = surfaceMeshRow( mask, y, z     );
+                    for( unsigned int w = 0; w < mask.rowWords; ++w )
+                    {
+                        const PackedMask::Word lower = surfaceMeshWord( mask, row0, w );
+                        for( PackedMask::Word changes = lower ^ surfaceMeshWord( mask, row1, w ); changes != 0; changes &= changes - 1 )
+                        {
+                            const unsigned int bit = PackedMask::countTrailingZeros( changes );
+                            const unsigned int x = w * PackedMask::WORD_BITS + bit;
+                            addQuad( vertexAt( x    , y    , t )
+                                   , vertexAt( x + 1, y    , t )
+                                   , vertexAt( x + 1, y + 1, t )
+                                   , vertexAt( x    , y + 1, t )
+                                   , ( ( lower >> bit ) & 1 ) == 0 );
+                        }
+                    }
+                }
+
+                if( !finishLayer() )
+                {
+                    return;
+                }
+            }
+        }
+    );
+
+    if( aborted != 0 )
+    {
+        return;
+    }
+
+ // concatenate the slabs
+
+    meshVertices.reserve( verticesCount );
+    for( auto slab = slabs.begin(); slab != slabs.end(); ++slab )
+    {
+        meshVertices.insert( meshVertices.end(), slab->vertices.begin(), slab->vertices.end() );
+        std::vector< Vertex >().swap( slab->vertices );
+    }
+
+    std::size_t trianglesCount = 0;
+    for( auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk )
+    {
+        trianglesCount += chunk->size();
+    }
+    meshTriangles.reserve( trianglesCount );
+    for( auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk )
+    {
+        meshTriangles.insert( meshTriangles.end(), chunk->begin(), chunk->end() );
+        std::vector< Triangle >().swap( *chunk );
+    }
+}
+
+
+void SurfaceMesh::saveStl( QIODevice& out ) const
+{
+    CARNA_ASSERT( meshTriangles.size() <= std::numeric_limits< uint32_t >::max() );
+
+    std::vector< char > buffer( 80, 0 );
+    const char* const HEADER = "binary STL";
+    std::copy( HEADER, HEADER + std::strlen( HEADER ), buffer.begin() );
+    appendSurfaceMeshUInt32( buffer, static_cast< uint32_t >( meshTriangles.size() ) );
+
+    for( auto triangle = meshTriangles.begin(); triangle != meshTriangles.end(); ++triangle )
+    {
+        const Vertex& a = meshVertices[ triangle->vertices[ 0 ] ];
+        const Vertex& b = meshVertices[ triangle->vertices[ 1 ] ];
+        const Vertex& c = meshVertices[ triangle->vertices[ 2 ] ];
+
+        const float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+        const float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+        Vertex normal = { uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx };
+        const float length = std::sqrt( normal.x * normal.x + normal.y * normal.y + normal.z * normal.z );
+        if( length > 0 )
+        {
+            normal.x /= length;
+            normal.y /= length;
+            normal.z /= length;
+        }
+
+        appendSurfaceMeshVertex( buffer, normal );
+        appendSurfaceMeshVertex( buffer, a );
+        appendSurfaceMeshVertex( buffer, b );
+        appendSurfaceMeshVertex( buffer, c );
+        buffer.push_back( 0 );
+        buffer.push_back( 0 );
+
+        if( buffer.size() >= SURFACE_MESH_BLOCK_SIZE )
+        {
+            writeSurfaceMeshBuffer( out, buffer );
+        }
+    }
+    writeSurfaceMeshBuffer( out, buffer );
+}
+
+
+void SurfaceMesh::savePly( QIODevice& out ) const
+{
+    std::stringstream header;
+    header << "ply" << std::endl
+           << "format binary_little_endian 1.0" << std::endl
+           << "element vertex " << meshVertices.size() << std::endl
+           << "property float x" << std::endl
+           << "property float y" << std::endl
+           << "property float z" << std::endl
+           << "element face " << meshTriangles.size() << std::endl
+           << "property list uchar uint vertex_indices" << std::endl
+           << "end_header" << std::endl;
+
+    const std::string headerString = header.str();
+    std::vector< char > buffer( headerString.begin(), headerString.end() );
+
+    for( auto vertex = meshVertices.begin(); vertex != meshVertices.end(); ++vertex )
+    {
+        appendSurfaceMeshVertex( buffer, *vertex );
+        if( buffer.size() >= SURFACE_MESH_BLOCK_SIZE )
+        {
+            writeSurfaceMeshBuffer( out, buffer );
+        }
+    }
+
+    for( auto triangle = meshTriangles.begin(); triangle != meshTriangles.end(); ++triangle )
+    {
+        buffer.push_back( 3 );
+        appendSurfaceMeshUInt32( buffer, triangle->vertices[ 0 ] );
+        appendSurfaceMeshUInt32( buffer, triangle->vertices[ 1 ] );
+        appendSurfaceMeshUInt32( buffer, triangle->vertices[ 2 ] );
+        if( buffer.size() >= SURFACE_MESH_BLOCK_SIZE )
+        {
+            writeSurfaceMeshBuffer( out, buffer );
+        }
+    }
+    writeSurfaceMeshBuffer( out, buffer );
+}
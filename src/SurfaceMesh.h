@@ -0,0 +1,131 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Transformation.h>
+#include <Carna/base/model/BufferedMaskAdapter.h>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+class PackedMask;
+class QIODevice;
+
+
+
+// ----------------------------------------------------------------------------------
+// SurfaceMesh
+// ----------------------------------------------------------------------------------
+
+/** \brief  Triangle mesh of the surface of some binary mask, extracted by surface nets.
+  *
+  * The mask is divided into cells of \f$2 \times 2 \times 2\f$ voxels. Each cell whose
+  * voxels are not all equal yields one vertex, which is placed at the average of the
+  * midpoints of those cell edges that cross the surface. Each pair of face-adjacent
+  * voxels which differ yields one quad, which connects the vertices of the four cells
+  * sharing the pair. Hence each vertex is shared by all of its faces and the mesh is
+  * closed. Voxels beyond the mask are treated as unset.
+  *
+  * The faces are oriented counter-clockwise when seen from outside. Vertices are
+  * specified in millimeters.
+  *
+  * Both passes, the placement of the vertices and the creation of the faces, are done
+  * for multiple z-slabs concurrently.
+  *
+  * The extraction reports its progress through an optional \ref Progress callback,
+  * which may also abort it.
+  */
+class SurfaceMesh
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Defines the position of a vertex.
+      */
+    struct Vertex
+    {
+        float x, y, z;
+    };
+
+    /** \brief  References three vertices by their indices.
+      */
+    struct Triangle
+    {
+        uint32_t vertices[ 3 ];
+    };
+
+
+    /** \brief  Is told the completed fraction of the extraction and returns whether
+      *         it shall go on.
+      *
+      * Invoked concurrently by the worker threads. Once it returns \c false, the
+      * extraction stops and leaves the mesh empty.
+      */
+    typedef std::function< bool( double ) > Progress;
+
+
+    /** \brief  Extracts the mesh of \a mask, whose voxels are \a spacing millimeters
+      *         apart.
+      */
+    SurfaceMesh( const PackedMask& mask, const Carna::base::Vector& spacing, const Progress& progress = Progress() );
+
+    /** \brief  Extracts the mesh of \a mask, whose voxels are \a spacing millimeters
+      *         apart.
+      */
+    SurfaceMesh( const Carna::base::model::BufferedMaskAdapter::BinaryMask& mask, const Carna::base::Vector& spacing, const Progress& progress = Progress() );
+
+
+    /** \brief  References the vertices.
+      */
+    const std::vector< Vertex >& vertices() const
+    {
+        return meshVertices;
+    }
+
+    /** \brief  References the triangles.
+      */
+    const std::vector< Triangle >& triangles() const
+    {
+        return meshTriangles;
+    }
+
+
+    /** \brief  Writes the mesh as binary STL.
+      *
+      * The file is written block-wise, so that it is never held in memory as a whole.
+      *
+      * \throws std::runtime_error  if writing fails.
+      */
+    void saveStl( QIODevice& out ) const;
+
+    /** \brief  Writes the mesh as binary little-endian PLY.
+      *
+      * The file is written block-wise, so that it is never held in memory as a whole.
+      *
+      * \throws std::runtime_error  if writing fails.
+      */
+    void savePly( QIODevice& out ) const;
+
+
+private:
+
+    std::vector< Vertex > meshVertices;
+
+    std::vector< Triangle > meshTriangles;
+
+    void compute( const PackedMask& mask, const Carna::base::Vector& spacing, const Progress& progress );
+
+}; // SurfaceMesh
@@ -0,0 +1,259 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "VolumeCache.h"
+#include "NativeDumpProcessor.h"
+#include <Carna/base/model/Scene.h>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+
+
+static const char* const VOLUME_CACHE_SUFFIX = ".nvd";
+
+static const qint64 VOLUME_CACHE_DEFAULT_CAPACITY = qint64( 4096 ) << 20;
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeCache
+// ----------------------------------------------------------------------------------
+
+VolumeCache::VolumeCache()
+{
+    QSettings settings( QSettings::IniFormat, QSettings::UserScope, "mediTEC", "DICOM Viewer" );
+    settings.beginGroup( "VolumeCache" );
+
+    const QString defaultDirectory = QDesktopServices::storageLocation( QDesktopServices::DataLocation ) + "/volume-cache";
+
+    enabled        = settings.value( "enabled", true ).toBool();
+    cacheDirectory = settings.value( "directory", defaultDirectory ).toString();
+    cacheCapacity  = settings.value( "capacity", VOLUME_CACHE_DEFAULT_CAPACITY ).toLongLong();
+}
+
+
+QString VolumeCache::key( const QStringList& fileNames, double spacingZ )
+{
+    QStringList files = fileNames;
+    files.sort();
+
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    for( auto fileName = files.begin(); fileName != files.end(); ++fileName )
+    {
+        const QFileInfo file( *fileName );
+        hash.addData( file.absoluteFilePath().toUtf8() );
+        hash.addData( QByteArray::number( file.size() ) );
+        hash.addData( QByteArray::number( file.lastModified().toMSecsSinceEpoch() ) );
+    }
+    hash.addData( QByteArray::number( spacingZ, 'g', 17 ) );
+
+    return QString::fromAscii( hash.result().toHex() );
+}
+
+
+void VolumeCache::setEnabled( bool enabled )
+{
+    this->enabled = enabled;
+}
+
+
+void VolumeCache::setDirectory( const QString& directory )
+{
+    cacheDirectory = directory;
+}
+
+
+void VolumeCache::setCapacity( qint64 bytes )
+{
+    cacheCapacity = std::max< qint64 >( bytes, 0 );
+    evict( QString() );
+}
+
+
+void VolumeCache::saveSettings() const
+{
+    QSettings settings( QSettings::IniFormat, QSettings::UserScope, "mediTEC", "DICOM Viewer" );
+    settings.beginGroup( "VolumeCache" );
+
+    settings.setValue( "enabled", enabled );
+    settings.setValue( "directory", cacheDirectory );
+    settings.setValue( "capacity", cacheCapacity );
+}
+
+
+QString VolumeCache::entryFileName( const QString& key ) const
+{
+    return cacheDirectory + "/" + key + VOLUME_CACHE_SUFFIX;
+}
+
+
+QString VolumeCache::indexFileName() const
+{
+    return cacheDirectory + "/index.ini";
+}
+
+
+qint64 VolumeCache::size() const
+{
+    const QFileInfoList entries = QDir( cacheDirectory ).entryInfoList( QStringList() << ( QString( "*" ) + VOLUME_CACHE_SUFFIX ), QDir::Files );
+
+    qint64 bytes = 0;
+    for( auto entry = entries.begin(); entry != entries.end(); ++entry )
+    {
+        bytes += entry->size();
+    }
+    return bytes;
+}
+
+
+void VolumeCache::clear()
+{
+    const QFileInfoList entries = QDir( cacheDirectory ).entryInfoList( QStringList() << ( QString( "*" ) + VOLUME_CACHE_SUFFIX ), QDir::Files );
+
+    QSettings index( indexFileName(), QSettings::IniFormat );
+    for( auto entry = entries.begin(); entry != entries.end(); ++entry )
+    {
+        /* Entries which are currently mapped cannot be removed on every platform.
+         */
+        if( QFile::remove( entry->absoluteFilePath() ) )
+        {
+            index.remove( entry->completeBaseName() );
+        }
+    }
+}
+
+
+void VolumeCache::touch( const QString& key )
+{
+    QSettings index( indexFileName(), QSettings::IniFormat );
+    index.setValue( key, QDateTime::currentMSecsSinceEpoch() );
+}
+
+
+Carna::base::model::Scene* VolumeCache::load( const QString& key )
+{
+    if( !enabled || !QFile::exists( entryFileName( key ) ) )
+    {
+        return nullptr;
+    }
+
+    Carna::base::model::Scene* model;
+    try
+    {
+        model = NativeDumpProcessor::map( entryFileName( key ) );
+    }
+    catch( const std::exception& )
+    {
+        /* The entry is damaged, hence it is replaced by the caller.
+         */
+        QFile::remove( entryFileName( key ) );
+        return nullptr;
+    }
+
+    touch( key );
+    return model;
+}
+
+
+bool VolumeCache::store( const QString& key, const Carna::base::model::Scene& model, const Progress& progress )
+{
+    return store
+        ( key
+        , model.volume()
+        , Carna::base::Vector( model.spacingX(), model.spacingY(), model.spacingZ() )
+        , model.recommendedVoidThreshold()
+        , progress );
+}
+
+
+bool VolumeCache::store( const QString& key
+                       , const Carna::base::model::Volume& volume
+                       , const Carna::base::Vector& spacing
+                       , int voidThreshold
+                       , const Progress& progress )
+{
+    if( !enabled || !QDir().mkpath( cacheDirectory ) )
+    {
+        return false;
+    }
+
+ // write to a temporary file first, so that no partial entry is ever found
+
+    const QString fileName = entryFileName( key );
+    QFile file( fileName + ".tmp" );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        return false;
+    }
+
+    const bool complete = NativeDumpProcessor::write( file, volume, spacing, voidThreshold, progress );
+    file.close();
+
+    QFile::remove( fileName );
+    if( !complete || !file.rename( fileName ) )
+    {
+        file.remove();
+        return false;
+    }
+
+    touch( key );
+
+ // make room
+
+    evict( key );
+    return true;
+}
+
+
+void VolumeCache::evict( const QString& keep )
+{
+    const QFileInfoList entries = QDir( cacheDirectory ).entryInfoList( QStringList() << ( QString( "*" ) + VOLUME_CACHE_SUFFIX ), QDir::Files );
+
+    QSettings index( indexFileName(), QSettings::IniFormat );
+
+    /* Entries without a recorded use are treated as used when they were written.
+     */
+    std::vector< std::pair< qint64, QFileInfo > > candidates;
+    qint64 bytes = 0;
+    for( auto entry = entries.begin(); entry != entries.end(); ++entry )
+    {
+        bytes += entry->size();
+        if( entry->completeBaseName() != keep )
+        {
+            const qint64 lastUse = index.value( entry->completeBaseName(), entry->lastModified().toMSecsSinceEpoch() ).toLongLong();
+            candidates.push_back( std::make_pair( lastUse, *entry ) );
+        }
+    }
+
+    std::sort( candidates.begin(), candidates.end(),
+        []( const std::pair< qint64, QFileInfo >& a, const std::pair< qint64, QFileInfo >& b )->bool
+        {
+            return a.first < b.first;
+        }
+    );
+
+    for( auto candidate = candidates.begin(); candidate != candidates.end() && bytes > cacheCapacity; ++candidate )
+    {
+        if( QFile::remove( candidate->second.absoluteFilePath() ) )
+        {
+            bytes -= candidate->second.size();
+            index.remove( candidate->second.completeBaseName() );
+        }
+    }
+}
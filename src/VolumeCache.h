@@ -0,0 +1,150 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Transformation.h>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeCache
+// ----------------------------------------------------------------------------------
+
+/** \brief  Keeps converted volumes on disk, so that reopening some DICOM series does
+  *         not require to parse its slices again.
+  *
+  * Each entry is a \ref NativeDumpProcessor "native volume dump", which is mapped
+  * when the entry is loaded. The entries are identified by \ref key and evicted in
+  * least-recently-used order once the cache grows beyond its \ref capacity.
+  *
+  * The settings are read from the user's application settings on construction and
+  * written back by \ref saveSettings.
+  */
+class VolumeCache
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Instantiates with the settings the user has saved.
+      */
+    VolumeCache();
+
+
+    /** \brief  Tells the key of the volume converted from the given files.
+      *
+      * The key changes whenever any of the files is moved, resized or modified.
+      */
+    static QString key( const QStringList& fileNames, double spacingZ );
+
+
+    /** \brief  Tells whether volumes are cached.
+      */
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    void setEnabled( bool enabled );
+
+    /** \brief  Tells the directory which holds the entries.
+      */
+    const QString& directory() const
+    {
+        return cacheDirectory;
+    }
+
+    void setDirectory( const QString& directory );
+
+    /** \brief  Tells the number of bytes the entries may occupy.
+      */
+    qint64 capacity() const
+    {
+        return cacheCapacity;
+    }
+
+    /** \brief  Sets the number of bytes the entries may occupy and evicts the least
+      *         recently used entries until it is met.
+      */
+    void setCapacity( qint64 bytes );
+
+    /** \brief  Writes the settings to the user's application settings.
+      */
+    void saveSettings() const;
+
+
+    /** \brief  Tells the number of bytes the entries currently occupy.
+      */
+    qint64 size() const;
+
+    /** \brief  Removes all entries which are not in use.
+      */
+    void clear();
+
+
+    /** \brief  Returns the model cached as \a key or \c nullptr if there is none.
+      */
+    Carna::base::model::Scene* load( const QString& key );
+
+    /** \brief  Is told the written fraction of an entry and returns whether writing
+      *         shall go on.
+      */
+    typedef std::function< bool( double ) > Progress;
+
+    /** \brief  Caches \a model as \a key and evicts the least recently used entries
+      *         until the capacity is met.
+      *
+      * Has no user interface, so that it may run on a worker thread, e.g. through a
+      * \ref VolumeCacheJob. Returns \c false if the entry could not be written or
+      * \a progress stopped it.
+      */
+    bool store( const QString& key, const Carna::base::model::Scene& model, const Progress& progress );
+
+    /** \brief  Caches \a volume, whose voxels are \a spacing millimeters apart, with
+      *         the given \a voidThreshold as \a key, like \ref store does with some
+      *         scene.
+      */
+    bool store( const QString& key
+              , const Carna::base::model::Volume& volume
+              , const Carna::base::Vector& spacing
+              , int voidThreshold
+              , const Progress& progress );
+
+
+private:
+
+    bool enabled;
+
+    QString cacheDirectory;
+
+    qint64 cacheCapacity;
+
+    QString entryFileName( const QString& key ) const;
+
+    QString indexFileName() const;
+
+    /** \brief  Records that \a key was used just now.
+      */
+    void touch( const QString& key );
+
+    /** \brief  Removes the least recently used entries except \a keep until the
+      *         capacity is met.
+      */
+    void evict( const QString& keep );
+
+}; // VolumeCache
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "VolumeCacheJob.h"
+#include "VolumeRows.h"
+#include "Slabs.h"
+#include <Carna/base/model/Scene.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <cstring>
+
+
+
+/** \brief  Copies the voxels of \a volume slab-parallel.
+  */
+static Carna::base::model::UInt16Volume* copyVolumeCacheJobVolume( const Carna::base::model::Volume& volume )
+{
+    const Carna::base::Vector3ui& size = volume.size;
+    std::unique_ptr< Carna::base::model::UInt16Volume > result( new Carna::base::model::UInt16Volume( size ) );
+    if( size.x * size.y * size.z == 0 )
+    {
+        return result.release();
+    }
+
+    const VolumeRows rows( volume );
+    VolumeRows::Voxel* const target = &result->getBuffer().front();
+
+    const Slabs slabs( size.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            std::vector< VolumeRows::Voxel > scratch;
+            for( unsigned int z = z0; z < z1; ++z )
+            for( unsigned int y = 0; y < size.y; ++y )
+            {
+                std::memcpy
+                    ( target + ( y + static_cast< unsigned long >( z ) * size.y ) * size.x
+                    , rows.row( y, z, scratch )
+                    , size.x * sizeof( VolumeRows::Voxel ) );
+            }
+        }
+    );
+
+    return result.release();
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeCacheJob
+// ----------------------------------------------------------------------------------
+
+VolumeCacheJob::VolumeCacheJob( const QString& key, const Carna::base::model::Scene& model )
+    : key( key )
+    , volume( copyVolumeCacheJobVolume( model.volume() ) )
+    , spacing( model.spacingX(), model.spacingY(), model.spacingZ() )
+    , voidThreshold( model.recommendedVoidThreshold() )
+{
+}
+
+
+VolumeCacheJob::~VolumeCacheJob()
+{
+    cancelAndWait();
+}
+
+
+void VolumeCacheJob::process()
+{
+    /* The cache is optional, hence failing to fill it is no error.
+     */
+    try
+    {
+        cache.store( key, *volume, spacing, voidThreshold, [this]( double fraction )->bool
+            {
+                reportProgress( fraction );
+                return !isCanceled();
+            }
+        );
+    }
+    catch( ... )
+    {
+    }
+}
+
+
+void VolumeCacheJob::finish()
+{
+    emit finished();
+}
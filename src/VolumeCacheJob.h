@@ -0,0 +1,81 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "BackgroundJob.h"
+#include "VolumeCache.h"
+#include <Carna/Carna.h>
+#include <Carna/base/Transformation.h>
+#include <QString>
+#include <memory>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeCacheJob
+// ----------------------------------------------------------------------------------
+
+/** \brief  Writes some scene to the \ref VolumeCache in the background.
+  *
+  * The job writes from a copy of the scene's volume, so that the scene can be handed
+  * out right away and its owner may delete it at any time. The copy is released
+  * together with the job, which deletes itself once the worker has finished.
+  * Canceling the job only skips the caching, since the cache is optional.
+  */
+class VolumeCacheJob : public BackgroundJob
+{
+
+    Q_OBJECT
+
+public:
+
+    /** \brief  Instantiates a job which caches \a model as \a key.
+      *
+      * Copies the volume of \a model, which is not referenced afterwards.
+      */
+    VolumeCacheJob( const QString& key, const Carna::base::model::Scene& model );
+
+    /** \brief  Cancels the job and waits until the worker has finished.
+      */
+    virtual ~VolumeCacheJob();
+
+
+signals:
+
+    /** \brief  Tells that the worker has finished, whether the volume was cached or
+      *         not.
+      */
+    void finished();
+
+
+private:
+
+    const QString key;
+
+    VolumeCache cache;
+
+    const std::unique_ptr< const Carna::base::model::Volume > volume;
+
+    const Carna::base::Vector spacing;
+
+    const int voidThreshold;
+
+    /** \brief  Invokes \ref VolumeCache::store. Canceling the job stops writing and
+      *         removes the partial entry.
+      */
+    virtual void process() override;
+
+    /** \brief  Notifies about the end of the job.
+      */
+    virtual void finish() override;
+
+}; // VolumeCacheJob
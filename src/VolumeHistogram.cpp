@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "VolumeHistogram.h"
+#include <Carna/base/CarnaException.h>
+#include <algorithm>
+#include <cmath>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeHistogram
+// ----------------------------------------------------------------------------------
+
+VolumeHistogram::VolumeHistogram( const std::vector< unsigned long >& bins )
+    : cumulative( BINS + 1, 0 )
+{
+    CARNA_ASSERT( bins.size() == BINS );
+
+    for( unsigned int bin = 0; bin < BINS; ++bin )
+    {
+        cumulative[ bin + 1 ] = cumulative[ bin ] + bins[ bin ];
+    }
+}
+
+
+unsigned long VolumeHistogram::count( int huv0, int huv1 ) const
+{
+    huv0 = std::max( huv0, -1024 );
+    huv1 = std::min( huv1,  3071 );
+    if( huv1 < huv0 )
+    {
+        return 0;
+    }
+    else
+    {
+        return cumulative[ huv1 + 1025 ] - cumulative[ huv0 + 1024 ];
+    }
+}
+
+
+int VolumeHistogram::percentile( double fraction ) const
+{
+    const double target = std::ceil( std::min( std::max( fraction, 0. ), 1. ) * sum() );
+    const unsigned long rank = std::max( 1ul, static_cast< unsigned long >( target ) );
+
+    /* Finds the first bin whose prefix sum, including itself, reaches the rank.
+     */
+    const auto bin = std::lower_bound( cumulative.begin() + 1, cumulative.end(), rank );
+    if( bin == cumulative.end() )
+    {
+        return 3071;
+    }
+    else
+    {
+        return static_cast< int >( bin - cumulative.begin() ) - 1 - 1024;
+    }
+}
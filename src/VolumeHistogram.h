@@ -0,0 +1,78 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <vector>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeHistogram
+// ----------------------------------------------------------------------------------
+
+/** \brief  Counts the voxels of some volume per HUV.
+  *
+  * The bins are collected by \ref VolumeStatistics.
+  *
+  * Only the prefix sums of the bins are kept, so that the number of voxels within any
+  * HUV range is computed in constant time and any percentile in logarithmic time.
+  */
+class VolumeHistogram
+{
+
+public:
+
+    /** \brief  Holds the number of bins, one for each HUV within \f$[-1024, 3071]\f$.
+      */
+    const static unsigned int BINS = 4096;
+
+
+    /** \brief  Instantiates from the number of voxels per HUV, where \a bins holds the
+      *         count of \f$\mathrm{huv}\f$ at \f$\mathrm{huv} + 1024\f$.
+      */
+    explicit VolumeHistogram( const std::vector< unsigned long >& bins );
+
+
+    /** \brief  Tells the number of voxels with \a huv.
+      */
+    unsigned long count( int huv ) const
+    {
+        return cumulative[ huv + 1025 ] - cumulative[ huv + 1024 ];
+    }
+
+    /** \brief  Tells the number of voxels within \f$[\mathrm{huv}_0, \mathrm{huv}_1]\f$.
+      *
+      * The range is clamped to \f$[-1024, 3071]\f$.
+      */
+    unsigned long count( int huv0, int huv1 ) const;
+
+    /** \brief  Tells the total number of voxels.
+      */
+    unsigned long sum() const
+    {
+        return cumulative.back();
+    }
+
+    /** \brief  Tells the smallest HUV, so that at least the given \a fraction of all
+      *         voxels is less or equal.
+      */
+    int percentile( double fraction ) const;
+
+
+private:
+
+    /** \brief  Holds the number of voxels less than \f$i - 1024\f$ at \f$i\f$.
+      */
+    std::vector< unsigned long > cumulative;
+
+}; // VolumeHistogram
@@ -10,12 +10,64 @@
  */
 
 #include "VolumeNormalizer.h"
+#include "CroppedVolume.h"
+#include "StatisticsClient.h"
+#include "VolumeStatistics.h"
 #include <Carna/base/model/Scene.h>
 #include <Carna/base/model/Volume.h>
-#include <Carna/base/model/UInt16Volume.h>
 #include <Carna/base/CarnaException.h>
-#include <QProgressDialog>
 #include <QApplication>
+#include <algorithm>
+#include <memory>
+
+
+
+/** \brief  References the volume of some model and owns that model.
+  */
+class VolumeNormalizerSource : public Carna::base::Association< const Carna::base::model::Volume >
+{
+
+public:
+
+    explicit VolumeNormalizerSource( Carna::base::model::Scene* model )
+        : Carna::base::Association< const Carna::base::model::Volume >( &model->volume() )
+        , model( model )
+    {
+    }
+
+private:
+
+    const std::unique_ptr< Carna::base::model::Scene > model;
+
+}; // VolumeNormalizerSource
+
+
+
+/** \brief  Sets \f$[\mathrm{min}, \mathrm{max}]\f$ to \f$[\mathrm{first}, \mathrm{last}]\f$,
+  *         grown around its center until it spans at least \a minimalSize voxels
+  *         beyond \a min, but without exceeding \f$[0, \mathrm{size})\f$.
+  *
+  * If \a first is negative, the grown range is centered within \f$[0, \mathrm{size})\f$.
+  */
+static void fitVolumeNormalizerExtent( int first, int last, unsigned int size, unsigned int minimalSize
+                                     , unsigned int& min, unsigned int& max )
+{
+    if( first < 0 )
+    {
+        first = last = static_cast< int >( size / 2 );
+    }
+
+    const int deficit = static_cast< int >( minimalSize ) - ( last - first );
+    if( deficit > 0 )
+    {
+        first -= deficit / 2;
+        last  += deficit - deficit / 2;
+    }
+
+    const int shift = std::max( 0, -first ) - std::max( 0, last - static_cast< int >( size ) + 1 );
+    min = static_cast< unsigned int >( std::max( 0, first + shift ) );
+    max = static_cast< unsigned int >( std::min( static_cast< int >( size ) - 1, last + shift ) );
+}
 
 
 
@@ -23,9 +75,9 @@
 // VolumeNormalizer
 // ----------------------------------------------------------------------------------
 
-VolumeNormalizer::VolumeNormalizer( const Carna::base::model::Scene& model, QWidget* parent )
+VolumeNormalizer::VolumeNormalizer( const Carna::base::model::Scene& model, Record::Server& server )
     : model( model )
-    , parent( parent )
+    , server( server )
     , threshold( -1024 )
     , minimalSize( 8 )
     , minX( 0 )
@@ -87,69 +139,50 @@ void VolumeNormalizer::compute()
     CARNA_ASSERT( -1024 <= threshold && threshold <= 3071 );
     CARNA_ASSERT( minimalSize >= 2 );
 
-    QProgressDialog status( "Shrinking...", "Abort", 0, 0, parent );
-    status.setWindowTitle( "Volume Normalization" );
-    status.setWindowModality( Qt::WindowModal );
-    status.show();
+    const Carna::base::Vector3ui& size = model.volume().size;
 
- // reset bounding box
+    /* The statistics are still computed if the volume was loaded only recently.
+     */
+    if( statistics.get() == nullptr )
+    {
+        QApplication::setOverrideCursor( Qt::WaitCursor );
+        statistics = StatisticsClient( server ).volumeStatistics();
+        QApplication::restoreOverrideCursor();
+    }
 
-    minX = minY = minZ = 0;
-    maxX = model.volume().size.x - 1;
-    maxY = model.volume().size.y - 1;
-    maxZ = model.volume().size.z - 1;
+ // find the voxels above the threshold
 
- // shrink bounding box
+    int firstX = -1, lastX = -1;
+    int firstY = -1, lastY = -1;
+    int firstZ = -1, lastZ = -1;
 
-    bool repeat;
-    do
+    for( unsigned int z = 0; z < size.z; ++z )
     {
-        repeat = false;
-
-        if( discardsSliceX( minX ) )
+        for( unsigned int y = 0; y < size.y; ++y )
         {
-            ++minX;
-            repeat = true;
+            if( statistics->rowMax( y, z ) > threshold )
+            {
+                if( firstY < 0 || static_cast< int >( y ) < firstY ) firstY = y;
+                if( static_cast< int >( y ) > lastY ) lastY = y;
+                if( firstZ < 0 ) firstZ = z;
+                lastZ = z;
+            }
         }
-        if( discardsSliceY( minY ) )
-        {
-            ++minY;
-            repeat = true;
-        }
-        if( discardsSliceZ( minZ ) )
-        {
-            ++minZ;
-            repeat = true;
-        }
-
-        if( discardsSliceX( maxX ) )
+        for( unsigned int x = 0; x < size.x; ++x )
         {
-            --maxX;
-            repeat = true;
-        }
-        if( discardsSliceY( maxY ) )
-        {
-            --maxY;
-            repeat = true;
-        }
-        if( discardsSliceZ( maxZ ) )
-        {
-            --maxZ;
-            repeat = true;
-        }
-
-        status.setValue( 0 );
-        QApplication::processEvents();
-        if( status.wasCanceled() )
-        {
-            repeat = false;
+            if( statistics->columnMax( x, z ) > threshold )
+            {
+                if( firstX < 0 || static_cast< int >( x ) < firstX ) firstX = x;
+                if( static_cast< int >( x ) > lastX ) lastX = x;
+            }
         }
     }
-    while( repeat );
 
-    CARNA_ASSERT( maxX - minX >= minimalSize );
-    CARNA_ASSERT( maxY - minY >= minimalSize );
-    CARNA_ASSERT( maxZ - minZ >= minimalSize );
+ // fit bounding box
+
+    fitVolumeNormalizerExtent( firstX, lastX, size.x, minimalSize, minX, maxX );
+    fitVolumeNormalizerExtent( firstY, lastY, size.y, minimalSize, minY, maxY );
+    fitVolumeNormalizerExtent( firstZ, lastZ, size.z, minimalSize, minZ, maxZ );
 
  // compute size loss
 
@@ -165,92 +198,20 @@ void VolumeNormalizer::compute()
 }
 
 
-bool VolumeNormalizer::discardsSliceX( const unsigned x ) const
-{
-    CARNA_ASSERT( maxX - minX >= minimalSize );
-
-    if( maxX - minX == minimalSize )
-    {
-        return false;
-    }
-
-    for( unsigned int y = minY; y <= maxY; ++y )
-    for( unsigned int z = minZ; z <= maxZ; ++z )
-    {
-        if( model.volume()( x, y, z ) > getThreshold() )
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-
-bool VolumeNormalizer::discardsSliceY( const unsigned y ) const
+Carna::base::model::Scene* VolumeNormalizer::getResult( Carna::base::model::Scene* source ) const
 {
-    CARNA_ASSERT( maxY - minY >= minimalSize );
-
-    if( maxY - minY == minimalSize )
-    {
-        return false;
-    }
-
-    for( unsigned int x = minX; x <= maxX; ++x )
-    for( unsigned int z = minZ; z <= maxZ; ++z )
-    {
-        if( model.volume()( x, y, z ) > getThreshold() )
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-
-bool VolumeNormalizer::discardsSliceZ( const unsigned z ) const
-{
-    CARNA_ASSERT( maxZ - minZ >= minimalSize );
-
-    if( maxZ - minZ == minimalSize )
-    {
-        return false;
-    }
-
-    for( unsigned int x = minX; x <= maxX; ++x )
-    for( unsigned int y = minY; y <= maxY; ++y )
-    {
-        if( model.volume()( x, y, z ) > getThreshold() )
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-
-Carna::base::model::Scene* VolumeNormalizer::getResult() const
-{
-    QApplication::setOverrideCursor( Qt::WaitCursor );
+    CARNA_ASSERT( source == &model );
 
+    const Carna::base::Vector3ui begin( minX, minY, minZ );
     const Carna::base::Vector3ui size( maxX - minX + 1, maxY - minY + 1, maxZ - minZ + 1 );
 
-    Carna::base::model::UInt16Volume* const new_volume = new Carna::base::model::UInt16Volume( size );
-
-    for( unsigned z = 0; z < size.z; ++z )
-    for( unsigned y = 0; y < size.y; ++y )
-    for( unsigned x = 0; x < size.x; ++x )
-    {
-        const short huv = model.volume()( minX + x, minY + y, minZ + z );
-        new_volume->setVoxel( x, y, z, huv );
-    }
+    CroppedVolume* const new_volume = new CroppedVolume( new VolumeNormalizerSource( source ), begin, size );
 
     Carna::base::model::Scene* const new_model = new Carna::base::model::Scene( new Carna::base::Composition< Carna::base::model::Volume >( new_volume )
                                                     , model.spacingX()
                                                     , model.spacingY()
                                                     , model.spacingZ() );
 
-    QApplication::restoreOverrideCursor();
-
     return new_model;
 }
 
@@ -13,9 +13,11 @@
 
 #include <Carna/base/noncopyable.h>
 #include <Carna/Carna.h>
+#include "Server.h"
 #include <QObject>
+#include <memory>
 
-class QWidget;
+class VolumeStatistics;
 
 
 
@@ -26,7 +28,10 @@ class QWidget;
 /** \brief  Builds a new volume from the current one while leaving out the
   *         surrounding empty space.
   *
-  * The empty space is determined by an HUV threshold.
+  * The empty space is determined by an HUV threshold. The volume is not scanned by
+  * the normalizer: The maximal HUV of each row and of each column is taken from the
+  * \ref VolumeStatistics of the loaded volume, hence the bounding box for any
+  * threshold follows without any voxel access.
   *
   * \author Leonid Kostrykin
   * \date   10.8.12
@@ -40,9 +45,9 @@ class VolumeNormalizer : public QObject
 
 public:
 
-    /** \brief	Instantiates.
+    /** \brief	Instantiates for the model which \a server provides.
       */
-    VolumeNormalizer( const Carna::base::model::Scene&, QWidget* parent = nullptr );
+    VolumeNormalizer( const Carna::base::model::Scene&, Record::Server& server );
 
     ~VolumeNormalizer();
 
@@ -51,7 +56,17 @@ public:
 
     int getMinimalSize() const;
 
-    Carna::base::model::Scene* getResult() const;
+    /** \brief  Builds the normalized model, whose volume is a \ref CroppedVolume "view"
+      *         of the bounding box within the volume of \a source, hence no voxels are
+      *         copied.
+      *
+      * Takes the ownership of \a source, which must be the model this normalizer was
+      * created for. The returned model keeps \a source alive, i.e. the memory of the
+      * whole original volume stays occupied until the returned model is deleted. To
+      * release it earlier, build a model from \ref CroppedVolume::copy and delete the
+      * returned one.
+      */
+    Carna::base::model::Scene* getResult( Carna::base::model::Scene* source ) const;
 
     double getSizeLoss() const;
 
@@ -80,7 +95,7 @@ private:
 
     const Carna::base::model::Scene& model;
 
-    QWidget* const parent;
+    Record::Server& server;
 
     signed int threshold;
 
@@ -96,11 +111,6 @@ private:
 
     double sizeLoss;
 
-
-    bool discardsSliceX( unsigned ) const;
-
-    bool discardsSliceY( unsigned ) const;
-
-    bool discardsSliceZ( unsigned ) const;
+    std::shared_ptr< const VolumeStatistics > statistics;
     
 }; // VolumeNormalizer
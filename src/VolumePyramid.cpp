@@ -0,0 +1,266 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "VolumePyramid.h"
+#include "VolumeRows.h"
+#include "Slabs.h"
+#include <Carna/base/model/Volume.h>
+#include <Carna/base/CarnaException.h>
+#include <QMutex>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+
+
+static QMutex volumePyramidCacheLock;
+
+static std::map< std::pair< const Carna::base::model::Volume*, VolumePyramid::Reduction >, std::weak_ptr< const VolumePyramid > > volumePyramidCache;
+
+
+
+/** \brief  Holds the taps of a separable reduction filter, where the output voxel
+  *         \f$i\f$ is centered at the input voxel \f$2i\f$.
+  */
+struct VolumePyramidKernel
+{
+    VolumePyramidKernel( VolumePyramid::Reduction reduction )
+    {
+        if( reduction == VolumePyramid::box )
+        {
+            const static int    boxOffsets[] = { 0, 1 };
+            const static double boxWeights[] = { 0.5, 0.5 };
+            offsets.assign( boxOffsets, boxOffsets + 2 );
+            weights.assign( boxWeights, boxWeights + 2 );
+        }
+        else
+        {
+            const static int    gaussianOffsets[] = { -2, -1, 0, 1, 2 };
+            const static double gaussianWeights[] = { 1 / 16., 4 / 16., 6 / 16., 4 / 16., 1 / 16. };
+            offsets.assign( gaussianOffsets, gaussianOffsets + 5 );
+            weights.assign( gaussianWeights, gaussianWeights + 5 );
+        }
+    }
+
+    std::vector< int > offsets;
+    std::vector< double > weights;
+
+    /** \brief  Tells the input voxel of the tap \a k for the output voxel \a i, clamped
+      *         to \f$[0, n)\f$.
+      */
+    unsigned int input( unsigned int k, unsigned int i, unsigned int n ) const
+    {
+        const int j = static_cast< int >( 2 * i ) + offsets[ k ];
+        return static_cast< unsigned int >( std::max( 0, std::min( static_cast< int >( n ) - 1, j ) ) );
+    }
+};
+
+
+/** \brief  Reduces \a source by the factor 2 along each axis.
+  */
+static Carna::base::model::UInt16Volume* reduceVolumePyramidLevel
+    ( const Carna::base::model::Volume& source
+    , const VolumePyramidKernel& kernel )
+{
+    const VolumeRows rows( source );
+    const Carna::base::Vector3ui& inSize = rows.size;
+    const Carna::base::Vector3ui outSize
+        ( std::max( 1u, ( inSize.x + 1 ) / 2 )
+        , std::max( 1u, ( inSize.y + 1 ) / 2 )
+        , std::max( 1u, ( inSize.z + 1 ) / 2 ) );
+
+    Carna::base::model::UInt16Volume* const result = new Carna::base::model::UInt16Volume( outSize );
+    VolumeRows::Voxel* const target = &result->getBuffer().front();
+    const unsigned int taps = kernel.offsets.size();
+
+    /* Each output slice is accumulated from the input slices covered by the kernel,
+     * which are reduced along x and y first. Hence no temporaries beyond a few
+     * slices are required.
+     */
+    const Slabs slabs( outSize.z );
+    slabs.process( [&]( unsigned int, unsigned int z0, unsigned int z1 )
+        {
+            std::vector< VolumeRows::Voxel > scratch;
+            std::vector< double > reducedX ( outSize.x * inSize.y );
+            std::vector< double > reducedXY( outSize.x * outSize.y );
+            std::vector< double > accumulated( outSize.x * outSize.y );
+
+            for( unsigned int z = z0; z < z1; ++z )
+            {
+                std::fill( accumulated.begin(), accumulated.end(), 0. );
+                for( unsigned int kz = 0; kz < taps; ++kz )
+                {
+                    const unsigned int inZ = kernel.input( kz, z, inSize.z );
+
+                 // reduce along x
+
+                    for( unsigned int y = 0; y < inSize.y; ++y )
+                    {
+                        const VolumeRows::Voxel* const row = rows.row( y, inZ, scratch );
+                        for( unsigned int x = 0; x < outSize.x; ++x )
+                        {
+                            double value = 0;
+                            for( unsigned int k = 0; k < taps; ++k )
+                            {
+                                value += kernel.weights[ k ] * VolumeRows::decode( row[ kernel.input( k, x, inSize.x ) ] );
+                            }
+                            reducedX[ x + y * outSize.x ] = value;
+                        }
+                    }
+
+                 // reduce along y
+
+                    for( unsigned int y = 0; y < outSize.y; ++y )
+                    for( unsigned int x = 0; x < outSize.x; ++x )
+                    {
+                        double value = 0;
+                        for( unsigned int k = 0; k < taps; ++k )
+                        {
+                            value += kernel.weights[ k ] * reducedX[ x + kernel.input( k, y, inSize.y ) * outSize.x ];
+                        }
+                        reducedXY[ x + y * outSize.x ] = value;
+                    }
+
+                 // accumulate along z
+
+                    for( unsigned int i = 0; i < accumulated.size(); ++i )
+                    {
+                        accumulated[ i ] += kernel.weights[ kz ] * reducedXY[ i ];
+                    }
+                }
+
+                VolumeRows::Voxel* const slice = target + static_cast< unsigned long >( z ) * outSize.x * outSize.y;
+                for( unsigned int i = 0; i < accumulated.size(); ++i )
+                {
+                    const int huv = static_cast< int >( std::floor( accumulated[ i ] + 0.5 ) );
+                    slice[ i ] = VolumeRows::encode( static_cast< signed short >( std::max( -1024, std::min( 3071, huv ) ) ) );
+                }
+            }
+        }
+    );
+
+    return result;
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumePyramid
+// ----------------------------------------------------------------------------------
+
+VolumePyramid::VolumePyramid( const Carna::base::model::Volume& volume, Reduction reduction )
+    : reduction( reduction )
+    , volume( volume )
+{
+    const VolumePyramidKernel kernel( reduction );
+    for( unsigned int level = 1; level < LEVELS; ++level )
+    {
+        reducedLevels[ level - 1 ].reset( reduceVolumePyramidLevel( this->level( level - 1 ), kernel ) );
+    }
+}
+
+
+std::shared_ptr< const VolumePyramid > VolumePyramid::acquire( const Carna::base::model::Volume& volume, Reduction reduction )
+{
+    QMutexLocker lock( &volumePyramidCacheLock );
+
+    /* Drop expired entries, so that the pyramids of closed volumes are not matched by
+     * volumes which are allocated at the same address later on.
+     */
+    for( auto entry = volumePyramidCache.begin(); entry != volumePyramidCache.end(); )
+    {
+        if( entry->second.expired() )
+        {
+            volumePyramidCache.erase( entry++ );
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+
+    const auto key = std::make_pair( &volume, reduction );
+    std::shared_ptr< const VolumePyramid > pyramid = volumePyramidCache[ key ].lock();
+    if( !pyramid.get() )
+    {
+        pyramid.reset( new VolumePyramid( volume, reduction ) );
+        volumePyramidCache[ key ] = pyramid;
+    }
+    return pyramid;
+}
+
+
+const Carna::base::model::Volume& VolumePyramid::level( unsigned int level ) const
+{
+    CARNA_ASSERT( level < LEVELS );
+
+    if( level == 0 )
+    {
+        return volume;
+    }
+    else
+    {
+        return *reducedLevels[ level - 1 ];
+    }
+}
+
+
+double VolumePyramid::valueAt( unsigned int level, double x, double y, double z ) const
+{
+    const Carna::base::model::Volume& source = this->level( level );
+
+    if( x < 0 || y < 0 || z < 0 || x > volume.size.x - 1 || y > volume.size.y - 1 || z > volume.size.z - 1 )
+    {
+        return -1024;
+    }
+
+ // map to the voxels of the level
+
+    const double factor = static_cast< double >( 1u << level );
+    const double center = reduction == box ? ( factor - 1 ) / 2 : 0.;
+
+    const double u[ 3 ] =
+        { std::max( 0., std::min( source.size.x - 1., ( x - center ) / factor ) )
+        , std::max( 0., std::min( source.size.y - 1., ( y - center ) / factor ) )
+        , std::max( 0., std::min( source.size.z - 1., ( z - center ) / factor ) ) };
+
+    const unsigned int n[ 3 ] = { source.size.x, source.size.y, source.size.z };
+    unsigned int i0[ 3 ], i1[ 3 ];
+    double t[ 3 ];
+    for( unsigned int axis = 0; axis < 3; ++axis )
+    {
+        i0[ axis ] = static_cast< unsigned int >( u[ axis ] );
+        i1[ axis ] = std::min( i0[ axis ] + 1, n[ axis ] - 1 );
+        t [ axis ] = u[ axis ] - i0[ axis ];
+    }
+
+ // interpolate trilinearly
+
+    double value = 0;
+    for( unsigned int corner = 0; corner < 8; ++corner )
+    {
+        const bool cx = ( corner & 1 ) != 0;
+        const bool cy = ( corner & 2 ) != 0;
+        const bool cz = ( corner & 4 ) != 0;
+
+        const double weight = ( cx ? t[ 0 ] : 1 - t[ 0 ] )
+                            * ( cy ? t[ 1 ] : 1 - t[ 1 ] )
+                            * ( cz ? t[ 2 ] : 1 - t[ 2 ] );
+        if( weight > 0 )
+        {
+            value += weight * source
+                ( cx ? i1[ 0 ] : i0[ 0 ]
+                , cy ? i1[ 1 ] : i0[ 1 ]
+                , cz ? i1[ 2 ] : i0[ 2 ] );
+        }
+    }
+    return value;
+}
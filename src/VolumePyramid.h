@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <memory>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumePyramid
+// ----------------------------------------------------------------------------------
+
+/** \brief  Holds successively halved resolutions of some volume.
+  *
+  * Level \f$0\f$ is the volume itself, while level \f$l\f$ is reduced by
+  * \f$2^l\f$ along each axis. Each level is computed from the previous one by
+  * separable filtering and decimation along \f$x\f$, \f$y\f$ and \f$z\f$, where each
+  * pass is parallelized across z-slabs.
+  *
+  * Pyramids which are shared through \ref acquire are computed only once per volume
+  * and reduction.
+  */
+class VolumePyramid
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Lists supported reduction filters.
+      */
+    enum Reduction
+    {
+        box,     ///< \brief  Averages \f$2 \times 2 \times 2\f$ voxels.
+        gaussian ///< \brief  Weights \f$5 \times 5 \times 5\f$ voxels by the binomial kernel \f$(1, 4, 6, 4, 1) / 16\f$.
+    };
+
+    /** \brief  Holds the number of levels, including the volume itself.
+      */
+    const static unsigned int LEVELS = 4;
+
+
+    /** \brief  Computes the reduced levels of \a volume.
+      */
+    VolumePyramid( const Carna::base::model::Volume& volume, Reduction reduction );
+
+
+    /** \brief  Returns the pyramid of \a volume which is shared with all other callers
+      *         that request the same \a volume and \a reduction.
+      *
+      * Concurrent callers wait until the pyramid has been computed. The volume must
+      * not be modified while the returned pyramid is referenced.
+      */
+    static std::shared_ptr< const VolumePyramid > acquire( const Carna::base::model::Volume& volume, Reduction reduction = box );
+
+
+    /** \brief  Tells the reduction filter.
+      */
+    const Reduction reduction;
+
+    /** \brief  References the level \a level.
+      */
+    const Carna::base::model::Volume& level( unsigned int level ) const;
+
+    /** \brief  Samples the level \a level trilinearly at the position \f$(x, y, z)\f$,
+      *         that is given in voxels of level \f$0\f$.
+      *
+      * Positions outside of the volume yield \f$-1024\f$.
+      */
+    double valueAt( unsigned int level, double x, double y, double z ) const;
+
+
+private:
+
+    const Carna::base::model::Volume& volume;
+
+    std::unique_ptr< Carna::base::model::UInt16Volume > reducedLevels[ LEVELS - 1 ];
+
+}; // VolumePyramid
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "VolumeRows.h"
+#include "CroppedVolume.h"
+#include "MappedVolume.h"
+#include <Carna/base/model/Volume.h>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeRows
+// ----------------------------------------------------------------------------------
+
+VolumeRows::VolumeRows( const Carna::base::model::Volume& volume )
+    : volume( volume )
+    , size( volume.size )
+    , base( nullptr )
+    , rowStride( volume.size.x )
+    , sliceStride( static_cast< unsigned long >( volume.size.x ) * volume.size.y )
+{
+    const Carna::base::model::UInt16Volume* const uint16Volume = dynamic_cast< const Carna::base::model::UInt16Volume* >( &volume );
+    if( uint16Volume != nullptr && !uint16Volume->getBuffer().empty() )
+    {
+        base = &uint16Volume->getBuffer().front();
+    }
+
+    const MappedVolume* const mappedVolume = dynamic_cast< const MappedVolume* >( &volume );
+    if( mappedVolume != nullptr )
+    {
+        base = mappedVolume->buffer();
+    }
+
+    const CroppedVolume* const croppedVolume = dynamic_cast< const CroppedVolume* >( &volume );
+    if( croppedVolume != nullptr )
+    {
+        const VolumeRows sourceRows( croppedVolume->source() );
+        if( sourceRows.isRaw() )
+        {
+            rowStride   = sourceRows.rowStride;
+            sliceStride = sourceRows.sliceStride;
+            base        = sourceRows.base + croppedVolume->begin.x
+                                          + croppedVolume->begin.y * rowStride
+                                          + croppedVolume->begin.z * sliceStride;
+        }
+    }
+}
+
+
+const VolumeRows::Voxel* VolumeRows::row( unsigned int y, unsigned int z, std::vector< Voxel >& scratch ) const
+{
+    if( base != nullptr )
+    {
+        return base + y * rowStride + z * sliceStride;
+    }
+
+    scratch.resize( size.x );
+    for( unsigned int x = 0; x < size.x; ++x )
+    {
+        scratch[ x ] = encode( volume( x, y, z ) );
+    }
+    return &scratch.front();
+}
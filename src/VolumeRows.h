@@ -0,0 +1,146 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <Carna/base/model/UInt16Volume.h>
+#include <vector>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeRows
+// ----------------------------------------------------------------------------------
+
+/** \brief  Provides row-wise access to the voxels of some volume in the
+  *         \c UInt16Volume encoding \f$v = (\mathrm{huv} + 1024) \cdot 2^4\f$.
+  *
+  * If the volume keeps its voxels in such a buffer, the rows reference that buffer
+  * directly. This also applies to a \ref MappedVolume and to a \ref CroppedVolume of
+  * such a volume, whose rows are strided. Otherwise each row is assembled within a caller-supplied scratch buffer
+  * through the virtual voxel accessor, which is only thread-safe if the volume's
+  * accessor is.
+  */
+class VolumeRows
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Holds the encoded voxel type.
+      */
+    typedef Carna::base::model::UInt16Volume::VoxelType Voxel;
+
+
+    /** \brief  Instantiates.
+      */
+    explicit VolumeRows( const Carna::base::model::Volume& volume );
+
+
+    /** \brief  References the accessed volume.
+      */
+    const Carna::base::model::Volume& volume;
+
+    /** \brief  Holds the accessed volume's size.
+      */
+    const Carna::base::Vector3ui size;
+
+
+    /** \brief  Tells whether rows reference the volume's buffer directly.
+      */
+    bool isRaw() const
+    {
+        return base != nullptr;
+    }
+
+    /** \brief  Tells the distance between two consecutive rows in voxels.
+      */
+    unsigned long rowDistance() const
+    {
+        return rowStride;
+    }
+
+    /** \brief  Tells the distance between two consecutive slices in voxels.
+      */
+    unsigned long sliceDistance() const
+    {
+        return sliceStride;
+    }
+
+    /** \brief  References the row \f$(y, z)\f$.
+      *
+      * The returned pointer is either to the volume's buffer or to \a scratch.
+      */
+    const Voxel* row( unsigned int y, unsigned int z, std::vector< Voxel >& scratch ) const;
+
+    /** \brief  Tells the encoded value of the voxel \f$(x, y, z)\f$.
+      */
+    Voxel voxel( unsigned int x, unsigned int y, unsigned int z ) const
+    {
+        if( base != nullptr )
+        {
+            return base[ x + y * rowStride + z * sliceStride ];
+        }
+        else
+        {
+            return encode( volume( x, y, z ) );
+        }
+    }
+
+
+    /** \brief  Encodes \a huv.
+      */
+    static Voxel encode( signed short huv )
+    {
+        return static_cast< Voxel >( static_cast< Voxel >( huv + 1024 ) << 4 );
+    }
+
+    /** \brief  Decodes \a voxel.
+      */
+    static signed short decode( Voxel voxel )
+    {
+        return static_cast< signed short >( ( voxel >> 4 ) - 1024 );
+    }
+
+    /** \brief  Tells the smallest encoded value which decodes to \a huv.
+      */
+    static Voxel lowerBound( int huv )
+    {
+        return static_cast< Voxel >( ( huv + 1024 ) << 4 );
+    }
+
+    /** \brief  Tells the largest encoded value which decodes to \a huv.
+      */
+    static Voxel upperBound( int huv )
+    {
+        return static_cast< Voxel >( ( ( huv + 1024 ) << 4 ) | 0xF );
+    }
+
+
+private:
+
+    /** \brief  References the first voxel of the volume's buffer or is \c nullptr.
+      */
+    const Voxel* base;
+
+    /** \brief  Holds the distance between two consecutive rows in voxels.
+      */
+    unsigned long rowStride;
+
+    /** \brief  Holds the distance between two consecutive slices in voxels.
+      */
+    unsigned long sliceStride;
+
+}; // VolumeRows
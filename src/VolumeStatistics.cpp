@@ -0,0 +1,264 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#include "VolumeStatistics.h"
+#include "VolumeRows.h"
+#include "Slabs.h"
+#include "Simd.h"
+#include <Carna/base/model/Volume.h>
+#include <QMutex>
+#include <algorithm>
+#include <map>
+#include <cmath>
+
+
+
+/** \brief  Holds the statistics of some volume, or the computation in progress.
+  */
+struct VolumeStatisticsSlot
+{
+    QMutex lock;
+    std::weak_ptr< const VolumeStatistics > statistics;
+};
+
+
+static QMutex volumeStatisticsCacheLock;
+
+static std::map< const Carna::base::model::Volume*, std::shared_ptr< VolumeStatisticsSlot > > volumeStatisticsCache;
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeStatistics
+// ----------------------------------------------------------------------------------
+
+VolumeStatistics::VolumeStatistics( const Carna::base::model::Volume& volume )
+    : recommendedVoidThreshold( -1024 )
+    , minimumHuv( -1024 )
+    , maximumHuv( -1024 )
+    , meanHuv( -1024 )
+    , huvDeviation( 0 )
+    , size( volume.size )
+    , rowMaxima( volume.size.y * volume.size.z )
+    , columnMaxima( volume.size.x * volume.size.z )
+    , sliceMaxima( volume.size.z )
+{
+    const VolumeRows rows( volume );
+
+ // collect the histogram and the maxima of the rows, columns and slices
+
+    const Slabs slabs( size.z );
+    std::vector< std::vector< unsigned long > > slabBins( slabs.count() );
+
+    slabs.process( [&]( unsigned int slab, unsigned int z0, unsigned int z1 )
+        {
+            std::vector< unsigned long >& out = slabBins[ slab ];
+            out.resize( VolumeHistogram::BINS, 0 );
+
+            std::vector< VolumeRows::Voxel > scratch;
+
+#ifdef DICOMVIEWER_SSE2
+            const __m128i offset = _mm_set1_epi16( 1024 );
+#endif
+
+            for( unsigned int z = z0; z < z1; ++z )
+            {
+                signed short* const columns = &columnMaxima[ z * size.x ];
+                std::fill( columns, columns + size.x, static_cast< signed short >( -1024 ) );
+                signed short sliceMax = -1024;
+
+                for( unsigned int y = 0; y < size.y; ++y )
+                {
+                    const VolumeRows::Voxel* const row = rows.row( y, z, scratch );
+                    signed short rowMax = -1024;
+                    unsigned int x = 0;
+
+#ifdef DICOMVIEWER_SSE2
+
+                 // decode 8 voxels at once and update the maxima
+
+                    __m128i rowMax8 = _mm_set1_epi16( -1024 );
+                    for( ; x + 8 <= size.x; x += 8 )
+                    {
+                        __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i* >( row + x ) );
+                        v = _mm_sub_epi16( _mm_srli_epi16( v, 4 ), offset );
+
+                        __m128i* const column8 = reinterpret_cast< __m128i* >( columns + x );
+                        _mm_storeu_si128( column8, _mm_max_epi16( _mm_loadu_si128( column8 ), v ) );
+                        rowMax8 = _mm_max_epi16( rowMax8, v );
+                    }
+
+                    rowMax8 = _mm_max_epi16( rowMax8, _mm_srli_si128( rowMax8, 8 ) );
+                    rowMax8 = _mm_max_epi16( rowMax8, _mm_srli_si128( rowMax8, 4 ) );
+                    rowMax8 = _mm_max_epi16( rowMax8, _mm_srli_si128( rowMax8, 2 ) );
+                    rowMax = static_cast< signed short >( _mm_extract_epi16( rowMax8, 0 ) );
+
+#endif
+
+                    for( ; x < size.x; ++x )
+                    {
+                        const signed short huv = VolumeRows::decode( row[ x ] );
+                        columns[ x ] = std::max( columns[ x ], huv );
+                        rowMax = std::max( rowMax, huv );
+                    }
+
+                    rowMaxima[ y + z * size.y ] = rowMax;
+                    sliceMax = std::max( sliceMax, rowMax );
+
+                    /* The lower four bits carry no HUV information. The row is still
+                     * cached, since the maxima were just collected from it.
+                     */
+                    for( x = 0; x < size.x; ++x )
+                    {
+                        ++out[ row[ x ] >> 4 ];
+                    }
+                }
+
+                sliceMaxima[ z ] = sliceMax;
+            }
+        }
+    );
+
+    std::vector< unsigned long > bins( VolumeHistogram::BINS, 0 );
+    for( auto slab = slabBins.begin(); slab != slabBins.end(); ++slab )
+    {
+        for( unsigned int bin = 0; bin < VolumeHistogram::BINS; ++bin )
+        {
+            bins[ bin ] += ( *slab )[ bin ];
+        }
+    }
+    volumeHistogram.reset( new VolumeHistogram( bins ) );
+
+ // derive the extrema and the moments, since each bin is one HUV wide
+
+    double total = 0;
+    double sum = 0;
+    double squaresSum = 0;
+    for( unsigned int bin = 0; bin < VolumeHistogram::BINS; ++bin )
+    {
+        if( bins[ bin ] == 0 )
+        {
+            continue;
+        }
+        if( total == 0 )
+        {
+            minimumHuv = static_cast< int >( bin ) - 1024;
+        }
+        maximumHuv = static_cast< int >( bin ) - 1024;
+
+        total      += bins[ bin ];
+        sum        += static_cast< double >( bin ) * bins[ bin ];
+        squaresSum += static_cast< double >( bin ) * bin * bins[ bin ];
+    }
+
+    if( total > 0 )
+    {
+        const double mean = sum / total;
+        meanHuv      = mean - 1024;
+        huvDeviation = std::sqrt( std::max( 0., squaresSum / total - mean * mean ) );
+    }
+
+ // choose the void threshold, which maximizes the between-class variance
+
+    double belowCount = 0;
+    double belowSum = 0;
+    double bestVariance = -1;
+    for( unsigned int bin = 0; bin + 1 < VolumeHistogram::BINS; ++bin )
+    {
+        belowCount += bins[ bin ];
+        belowSum   += static_cast< double >( bin ) * bins[ bin ];
+
+        const double aboveCount = total - belowCount;
+        if( belowCount == 0 || aboveCount == 0 )
+        {
+            continue;
+        }
+
+        const double meanDifference = belowSum / belowCount - ( sum - belowSum ) / aboveCount;
+        const double variance = belowCount * aboveCount * meanDifference * meanDifference;
+        if( variance > bestVariance )
+        {
+            bestVariance = variance;
+            recommendedVoidThreshold = static_cast< int >( bin ) - 1024;
+        }
+    }
+}
+
+
+std::shared_ptr< const VolumeStatistics > VolumeStatistics::acquire( const Carna::base::model::Volume& volume )
+{
+ // look up the slot of the volume
+
+    std::shared_ptr< VolumeStatisticsSlot > slot;
+    {
+        QMutexLocker lock( &volumeStatisticsCacheLock );
+
+        /* Drop expired slots, so that the statistics of closed volumes are not matched
+         * by volumes which are allocated at the same address later on. Slots which
+         * are referenced elsewhere are still being computed.
+         */
+        for( auto entry = volumeStatisticsCache.begin(); entry != volumeStatisticsCache.end(); )
+        {
+            if( entry->second.use_count() == 1 && entry->second->statistics.expired() )
+            {
+                volumeStatisticsCache.erase( entry++ );
+            }
+            else
+            {
+                ++entry;
+            }
+        }
+
+        std::shared_ptr< VolumeStatisticsSlot >& entry = volumeStatisticsCache[ &volume ];
+        if( !entry.get() )
+        {
+            entry.reset( new VolumeStatisticsSlot() );
+        }
+        slot = entry;
+    }
+
+ // compute the statistics, while only callers of the same volume wait
+
+    QMutexLocker lock( &slot->lock );
+
+    std::shared_ptr< const VolumeStatistics > statistics = slot->statistics.lock();
+    if( !statistics.get() )
+    {
+        statistics.reset( new VolumeStatistics( volume ) );
+        slot->statistics = statistics;
+    }
+    return statistics;
+}
+
+
+std::shared_ptr< const VolumeStatistics > VolumeStatistics::find( const Carna::base::model::Volume& volume )
+{
+    std::shared_ptr< VolumeStatisticsSlot > slot;
+    {
+        QMutexLocker lock( &volumeStatisticsCacheLock );
+
+        const auto entry = volumeStatisticsCache.find( &volume );
+        if( entry != volumeStatisticsCache.end() )
+        {
+            slot = entry->second;
+        }
+    }
+
+    /* A slot which is locked is still being computed.
+     */
+    std::shared_ptr< const VolumeStatistics > statistics;
+    if( slot.get() != nullptr && slot->lock.tryLock() )
+    {
+        statistics = slot->statistics.lock();
+        slot->lock.unlock();
+    }
+    return statistics;
+}
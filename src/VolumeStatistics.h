@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2010 - 2013 Leonid Kostrykin
+ *
+ *  Chair of Medical Engineering (mediTEC)
+ *  RWTH Aachen University
+ *  Pauwelsstr. 20
+ *  52074 Aachen
+ *  Germany
+ *
+ */
+
+#pragma once
+
+#include "VolumeHistogram.h"
+#include <Carna/Carna.h>
+#include <Carna/base/noncopyable.h>
+#include <Carna/base/Vector3.h>
+#include <memory>
+#include <vector>
+
+
+
+// ----------------------------------------------------------------------------------
+// VolumeStatistics
+// ----------------------------------------------------------------------------------
+
+/** \brief  Summarizes the voxels of some volume.
+  *
+  * Everything is derived from a single pass over the volume, which is parallelized
+  * across z-slabs: The histogram and the maximal HUV of each row, column and slice
+  * are collected, while the extrema, the moments, the percentiles and the
+  * recommended void threshold follow from the histogram.
+  *
+  * Statistics which are shared through \ref acquire are computed only once per
+  * volume.
+  */
+class VolumeStatistics
+{
+
+    NON_COPYABLE
+
+public:
+
+    /** \brief  Computes the statistics of \a volume.
+      */
+    explicit VolumeStatistics( const Carna::base::model::Volume& volume );
+
+
+    /** \brief  Returns the statistics of \a volume which are shared with all other
+      *         callers that request the same \a volume.
+      *
+      * Concurrent callers wait until the statistics have been computed. The volume
+      * must not be modified while the returned statistics are referenced.
+      */
+    static std::shared_ptr< const VolumeStatistics > acquire( const Carna::base::model::Volume& volume );
+
+    /** \brief  Returns the statistics of \a volume if they are shared already, or
+      *         \c nullptr otherwise.
+      *
+      * Never waits for statistics which are still being computed.
+      */
+    static std::shared_ptr< const VolumeStatistics > find( const Carna::base::model::Volume& volume );
+
+
+    /** \brief  References the histogram.
+      */
+    const VolumeHistogram& histogram() const
+    {
+        return *volumeHistogram;
+    }
+
+    /** \brief  Tells the smallest HUV within the volume.
+      */
+    int minimum() const
+    {
+        return minimumHuv;
+    }
+
+    /** \brief  Tells the largest HUV within the volume.
+      */
+    int maximum() const
+    {
+        return maximumHuv;
+    }
+
+    /** \brief  Tells the mean HUV.
+      */
+    double mean() const
+    {
+        return meanHuv;
+    }
+
+    /** \brief  Tells the standard deviation of the HUV.
+      */
+    double standardDeviation() const
+    {
+        return huvDeviation;
+    }
+
+    /** \brief  Tells the smallest HUV, so that at least the given \a fraction of all
+      *         voxels is less or equal.
+      */
+    int percentile( double fraction ) const
+    {
+        return volumeHistogram->percentile( fraction );
+    }
+
+    /** \brief  Tells the HUV which separates the void from the remaining voxels best.
+      *
+      * This is the threshold which maximizes the variance between the HUV classes
+      * below and above, according to Otsu's method.
+      */
+    int voidThreshold() const
+    {
+        return recommendedVoidThreshold;
+    }
+
+    /** \brief  Tells the largest HUV within the row \f$(y, z)\f$.
+      */
+    signed short rowMax( unsigned int y, unsigned int z ) const
+    {
+        return rowMaxima[ y + z * size.y ];
+    }
+
+    /** \brief  Tells the largest HUV within the column \f$(x, z)\f$.
+      */
+    signed short columnMax( unsigned int x, unsigned int z ) const
+    {
+        return columnMaxima[ x + z * size.x ];
+    }
+
+    /** \brief  Tells the largest HUV within the slice \a z.
+      */
+    signed short sliceMax( unsigned int z ) const
+    {
+        return sliceMaxima[ z ];
+    }
+
+
+private:
+
+    std::unique_ptr< VolumeHistogram > volumeHistogram;
+
+    int recommendedVoidThreshold;
+
+    int minimumHuv;
+
+    int maximumHuv;
+
+    double meanHuv;
+
+    double huvDeviation;
+
+    const Carna::base::Vector3ui size;
+
+    /** \brief  Holds the maximal HUV of each row \f$(y, z)\f$ at \f$y + z \cdot \mathrm{size}_y\f$.
+      */
+    std::vector< signed short > rowMaxima;
+
+    /** \brief  Holds the maximal HUV of each column \f$(x, z)\f$ at \f$x + z \cdot \mathrm{size}_x\f$.
+      */
+    std::vector< signed short > columnMaxima;
+
+    /** \brief  Holds the maximal HUV of each slice.
+      */
+    std::vector< signed short > sliceMaxima;
+
+}; // VolumeStatistics
@@ -10,12 +10,17 @@
  */
 
 #include "WindowingController.h"
+#include "StatisticsClient.h"
+#include "VolumeStatistics.h"
 #include <Carna/base/model/Scene.h>
 #include <QSlider>
 #include <QLabel>
+#include <QPushButton>
+#include <QApplication>
 #include <QFormLayout>
 #include <QDockWidget>
 #include <QTimer>
+#include <algorithm>
 
 
 
@@ -26,6 +31,7 @@
 WindowingController::WindowingController( Record::Server& server )
     : QWidget()
     , carna( server )
+    , server( server )
     , slWindowLevel( new QSlider( Qt::Horizontal, this ) )
     , slWindowWidth( new QSlider( Qt::Horizontal, this ) )
     , laWindowLevel( new QLabel( this ) )
@@ -43,9 +49,12 @@ WindowingController::WindowingController( Record::Server& server )
     widthParent->layout()->addWidget( slWindowWidth );
     widthParent->layout()->addWidget( laWindowWidth );
 
+    QPushButton* const buFit = new QPushButton( tr( "&Fit to Data" ) );
+
     QFormLayout* const layout = new QFormLayout();
     layout->addRow( tr( "&Window Level:" ), levelParent );
     layout->addRow( tr( "&Window Width:" ), widthParent );
+    layout->addRow( buFit );
     this->setLayout( layout );
 
     slWindowLevel->setMinimum( -1024 );
@@ -67,6 +76,7 @@ WindowingController::WindowingController( Record::Server& server )
 
     connect( slWindowLevel, SIGNAL( valueChanged( int ) ), this, SLOT( setWindowingLevel( int ) ) );
     connect( slWindowWidth, SIGNAL( valueChanged( int ) ), this, SLOT( setWindowingWidth( int ) ) );
+    connect( buFit, SIGNAL( clicked() ), this, SLOT( fitWindowing() ) );
 }
 
 
@@ -89,3 +99,19 @@ void WindowingController::setWindowingWidth( int val )
 
     carna.model().setRecommendedWindowingWidth( val );
 }
+
+
+void WindowingController::fitWindowing()
+{
+    /* The statistics are still computed if the volume was loaded only recently.
+     */
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    const std::shared_ptr< const VolumeStatistics > statistics = StatisticsClient( server ).volumeStatistics();
+    QApplication::restoreOverrideCursor();
+
+    const int huv0 = statistics->percentile( 0.01 );
+    const int huv1 = statistics->percentile( 0.99 );
+
+    slWindowLevel->setValue( ( huv0 + huv1 ) / 2 );
+    slWindowWidth->setValue( std::max( 1, huv1 - huv0 ) );
+}
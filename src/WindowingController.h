@@ -64,6 +64,11 @@ private slots:
       */
     void setWindowingWidth( int );
 
+    /** \brief  Fits the window to the HUV range between the 1st and the 99th
+      *         percentile of the volume statistics.
+      */
+    void fitWindowing();
+
 
 private:
 
@@ -71,6 +76,10 @@ private:
       */
     CarnaContextClient carna;
 
+    /** \brief  References the record service.
+      */
+    Record::Server& server;
+
 
     /** \brief  References the slider which configures windowing level.
       */